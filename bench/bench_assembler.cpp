@@ -0,0 +1,113 @@
+/* BENCH_ASSEMBLER
+ * Assembler throughput (in source lines/s) on the programs in asm/
+ *
+ * Stefan Wong 2018
+ */
+
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "corpus.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+
+/*
+ * BM_AssembleFile
+ * Assemble an already lexed source file
+ */
+static void BM_AssembleFile(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    Lexer lexer(machine.getOpTable(), filename);
+    SourceInfo src = lexer.lex();
+
+    if(src.hasError())
+    {
+        state.SkipWithError("lexer error in source");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        Assembler as(src);
+        as.assemble();
+        benchmark::DoNotOptimize(as.getNumErr());
+    }
+    state.SetItemsProcessed(state.iterations() * src.getNumLines());
+}
+BENCHMARK_CAPTURE(BM_AssembleFile, pow10, "asm/pow10.asm");
+BENCHMARK_CAPTURE(BM_AssembleFile, char_count, "asm/char_count.asm");
+BENCHMARK_CAPTURE(BM_AssembleFile, crypto, "asm/crypto.asm");
+BENCHMARK_CAPTURE(BM_AssembleFile, sentinel, "asm/sentinel.asm");
+
+/*
+ * BM_LexAssembleFile
+ * Lex then assemble a source file, either as two passes over
+ * a full SourceInfo or streamed a line at a time
+ */
+static void BM_LexAssembleFile(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    bool stream = state.range(0) ? true : false;
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table, filename);
+        state.ResumeTiming();
+
+        if(stream)
+        {
+            Assembler as;
+            as.assemble(lexer);
+            benchmark::DoNotOptimize(as.getNumErr());
+        }
+        else
+        {
+            SourceInfo src = lexer.lex();
+            Assembler as(src);
+            as.assemble();
+            benchmark::DoNotOptimize(as.getNumErr());
+        }
+    }
+    state.SetLabel(stream ? "stream" : "batch");
+}
+BENCHMARK_CAPTURE(BM_LexAssembleFile, pow10, "asm/pow10.asm")->Arg(0)->Arg(1);
+BENCHMARK_CAPTURE(BM_LexAssembleFile, sentinel, "asm/sentinel.asm")->Arg(0)->Arg(1);
+
+/*
+ * BM_AssembleParallel
+ * Assemble a generated source of range(0) lines on range(1) threads
+ */
+static void BM_AssembleParallel(benchmark::State& state)
+{
+    LC3 machine;
+    CorpusParams p;
+    initCorpusParams(p);
+    p.num_lines = state.range(0);
+    std::string text = genCorpus(p);
+    Lexer lexer(machine.getOpTable());
+    lexer.loadBuffer(text);
+    const SourceInfo& src = lexer.lex();
+
+    if(src.hasError())
+    {
+        state.SkipWithError("lexer error in generated source");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        Assembler as(src);
+        as.assembleParallel(state.range(1));
+        benchmark::DoNotOptimize(as.getNumErr());
+    }
+    state.SetItemsProcessed(state.iterations() * src.getNumLines());
+}
+BENCHMARK(BM_AssembleParallel)
+    ->ArgsProduct({{1 << 16, 1 << 20}, {1, 2, 4}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
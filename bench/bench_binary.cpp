@@ -0,0 +1,70 @@
+/* BENCH_BINARY
+ * Program save/load bandwidth
+ *
+ * Stefan Wong 2018
+ */
+
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "binary.hpp"
+
+static const std::string bench_bin_filename = "data/bench_binary_prog.bin";
+
+// Make a program with n instructions
+static Program bench_make_program(const unsigned int n)
+{
+    Program prog;
+    Instr instr;
+
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        instr.adr = (uint16_t) (0x3000 + i);
+        instr.ins = (uint16_t) (i * 0x9E37);
+        prog.add(instr);
+    }
+
+    return prog;
+}
+
+// Size of the file written by Program::save()
+static uint64_t bench_file_bytes(const unsigned int n)
+{
+    return sizeof(uint32_t) + (uint64_t) n * 2 * sizeof(uint16_t);
+}
+
+/*
+ * BM_ProgramSave
+ */
+static void BM_ProgramSave(benchmark::State& state)
+{
+    Program prog = bench_make_program(state.range(0));
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(prog.save(bench_bin_filename));
+    state.SetBytesProcessed(state.iterations() * bench_file_bytes(state.range(0)));
+}
+BENCHMARK(BM_ProgramSave)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+
+/*
+ * BM_ProgramLoad
+ */
+static void BM_ProgramLoad(benchmark::State& state)
+{
+    Program prog = bench_make_program(state.range(0));
+
+    if(prog.save(bench_bin_filename) < 0)
+    {
+        state.SkipWithError("failed to write program binary");
+        return;
+    }
+    for(auto _ : state)
+    {
+        Program read_prog;
+        benchmark::DoNotOptimize(read_prog.load(bench_bin_filename));
+    }
+    state.SetBytesProcessed(state.iterations() * bench_file_bytes(state.range(0)));
+}
+BENCHMARK(BM_ProgramLoad)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,150 @@
+/* BENCH_CHARCLASS
+ * Character classification through the lexer class table against
+ * the <cctype> calls and comparison chains it replaced, and against
+ * a full Lexer::lex() pass over the same text. The text is the
+ * programs in asm/ repeated up to the requested size.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "charclass.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+
+// Only the sources that lex cleanly at the moment
+static const char* bench_corpus_files[] = {
+    "asm/add_test.asm",
+    "asm/pow10.asm",
+    "asm/sentinel.asm"
+};
+
+/*
+ * bench_make_corpus()
+ * Repeat the sources in asm/ until there are at least min_bytes
+ */
+static std::string bench_make_corpus(const size_t min_bytes)
+{
+    std::string unit;
+    std::string corpus;
+
+    for(const char* filename : bench_corpus_files)
+    {
+        std::ifstream infile(filename);
+        std::ostringstream oss;
+        oss << infile.rdbuf();
+        unit += oss.str();
+    }
+    if(unit.size() == 0)
+        return corpus;
+    corpus.reserve(min_bytes + unit.size());
+    while(corpus.size() < min_bytes)
+        corpus += unit;
+
+    return corpus;
+}
+
+/*
+ * BM_ClassifyTable
+ * Count lines and tokens using the class table
+ */
+static void BM_ClassifyTable(benchmark::State& state)
+{
+    std::string corpus = bench_make_corpus(state.range(0));
+
+    for(auto _ : state)
+    {
+        uint64_t num_lines  = 0;
+        uint64_t num_tokens = 0;
+        bool in_token = false;
+
+        for(const char c : corpus)
+        {
+            uint8_t cls = lex_char_class(c);
+            if(cls & LEX_CC_NEWLINE)
+                num_lines++;
+            if(cls & LEX_CC_TOKEN_END)
+                in_token = false;
+            else if(!in_token)
+            {
+                in_token = true;
+                num_tokens++;
+            }
+        }
+        benchmark::DoNotOptimize(num_lines);
+        benchmark::DoNotOptimize(num_tokens);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_ClassifyTable)->RangeMultiplier(8)->Range(1 << 16, 1 << 22);
+
+/*
+ * BM_ClassifyCtype
+ * The same count using <cctype> and comparison chains
+ */
+static void BM_ClassifyCtype(benchmark::State& state)
+{
+    std::string corpus = bench_make_corpus(state.range(0));
+
+    for(auto _ : state)
+    {
+        uint64_t num_lines  = 0;
+        uint64_t num_tokens = 0;
+        bool in_token = false;
+
+        for(const char c : corpus)
+        {
+            if(c == '\n')
+                num_lines++;
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n' ||
+               c == ',' || c == ':'  || c == ';')
+                in_token = false;
+            else if(!in_token)
+            {
+                in_token = true;
+                num_tokens++;
+            }
+            benchmark::DoNotOptimize(isalnum(toupper(c)));
+        }
+        benchmark::DoNotOptimize(num_lines);
+        benchmark::DoNotOptimize(num_tokens);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_ClassifyCtype)->RangeMultiplier(8)->Range(1 << 16, 1 << 22);
+
+/*
+ * BM_LexCorpus
+ * Full lexer pass over the same text
+ */
+static void BM_LexCorpus(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string corpus = bench_make_corpus(state.range(0));
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table);
+        lexer.loadBuffer(corpus);
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lex();
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in corpus");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_LexCorpus)->RangeMultiplier(8)->Range(1 << 16, 1 << 22);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,59 @@
+/* BENCH_DISASSEMBLER
+ * Disassembler throughput (in instructions/s) on the programs in asm/
+ *
+ * Stefan Wong 2018
+ */
+
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "lc3.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+#include "disassembler.hpp"
+
+static const std::string bench_dis_filename = "data/bench_dis_prog.bin";
+
+/*
+ * BM_DisassembleFile
+ * Assemble a source file once, then disassemble the binary.
+ * Reading the binary from disk is not included in the timing.
+ */
+static void BM_DisassembleFile(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    Lexer lexer(machine.getOpTable(), filename);
+    SourceInfo src = lexer.lex();
+    uint64_t num_instr = 0;
+
+    if(src.hasError())
+    {
+        state.SkipWithError("lexer error in source");
+        return;
+    }
+    Assembler as(src);
+    as.assemble();
+    if(as.write(bench_dis_filename) < 0)
+    {
+        state.SkipWithError("failed to write program binary");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Disassembler dis;
+        dis.read(bench_dis_filename);
+        state.ResumeTiming();
+
+        dis.disassemble();
+        num_instr += dis.numSrcLines();
+    }
+    state.SetItemsProcessed(num_instr);
+}
+BENCHMARK_CAPTURE(BM_DisassembleFile, pow10, "asm/pow10.asm");
+BENCHMARK_CAPTURE(BM_DisassembleFile, char_count, "asm/char_count.asm");
+BENCHMARK_CAPTURE(BM_DisassembleFile, crypto, "asm/crypto.asm");
+BENCHMARK_CAPTURE(BM_DisassembleFile, sentinel, "asm/sentinel.asm");
+
+BENCHMARK_MAIN();
@@ -0,0 +1,137 @@
+/* BENCH_LC3
+ * Emulator throughput (in emulated MIPS) on the programs in asm/,
+ * and the cost of getting a small program from source to running
+ *
+ * Stefan Wong 2018
+ */
+
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "lc3.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+
+// Upper limit on the length of a single run
+#define BENCH_LC3_MAX_CYCLES 100000
+
+// Lex and assemble a source file into a program
+static int bench_assemble(const std::string& filename, const OpcodeTable& op_table, Program& prog)
+{
+    Lexer lexer(op_table, filename);
+    SourceInfo src = lexer.lex();
+    if(src.hasError() || src.getNumLines() == 0)
+        return -1;
+    Assembler as(src);
+    as.assemble();
+    if(as.getNumErr() > 0)
+        return -1;
+    prog = as.getProgram();
+
+    return 0;
+}
+
+/*
+ * BM_LC3Run
+ * Run the program from the start address until it halts, over
+ * and over. The MIPS counter is retired LC3 instructions per
+ * second of wall time.
+ */
+static void BM_LC3Run(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    Program prog;
+
+    if(bench_assemble(filename, machine.getOpTable(), prog) < 0)
+    {
+        state.SkipWithError("failed to assemble source");
+        return;
+    }
+    machine.loadMemProgram(prog);
+
+    for(auto _ : state)
+    {
+        machine.resetCPU();
+        machine.enable();
+        benchmark::DoNotOptimize(machine.run(BENCH_LC3_MAX_CYCLES));
+    }
+
+    LC3Stats stats = machine.getStats();
+    state.SetItemsProcessed(stats.instr_retired);
+    state.counters["MIPS"] = benchmark::Counter(
+            (double) stats.instr_retired / 1e6,
+            benchmark::Counter::kIsRate);
+    state.counters["instr_per_run"] = benchmark::Counter(
+            (double) stats.instr_retired,
+            benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_CAPTURE(BM_LC3Run, pow10, "asm/pow10.asm");
+BENCHMARK_CAPTURE(BM_LC3Run, char_count, "asm/char_count.asm");
+BENCHMARK_CAPTURE(BM_LC3Run, crypto, "asm/crypto.asm");
+BENCHMARK_CAPTURE(BM_LC3Run, sentinel, "asm/sentinel.asm");
+
+/*
+ * BM_AsmRunSnippet
+ * Assemble a small program and run it, as a test harness does for 
+ * each snippet. Either through a program which is then loaded into
+ * the machine (arg 0), or straight into the memory of the machine
+ * (arg 1).
+ */
+static void BM_AsmRunSnippet(benchmark::State& state)
+{
+    LC3 machine;
+    bool direct = state.range(0) ? true : false;
+    std::string text = 
+        "    .ORIG x3000\n"
+        "    LD R1, VAL1\n"
+        "    LD R2, VAL2\n"
+        "    AND R3, R3, #0\n"
+        "LOOP ADD R3, R3, R1\n"
+        "    ADD R2, R2, #-1\n"
+        "    BRp LOOP\n"
+        "    HALT\n"
+        "VAL1 .FILL #3\n"
+        "VAL2 .FILL #5\n"
+        "    .END\n";
+
+    for(auto _ : state)
+    {
+        Lexer lexer(machine.getOpTable());
+        lexer.loadBuffer(text);
+        Assembler as;
+        machine.resetCPU();
+        if(direct)
+        {
+            AsmImage image;
+            if(as.assemble(lexer, machine, image) < 0)
+            {
+                state.SkipWithError("failed to assemble source");
+                break;
+            }
+            machine.enable(image.entry);
+        }
+        else
+        {
+            const SourceInfo& src = lexer.lex();
+            if(src.hasError())
+            {
+                state.SkipWithError("failed to lex source");
+                break;
+            }
+            as = Assembler(lexer.takeSrcInfo());
+            as.assemble();
+            if(as.getNumErr() > 0)
+            {
+                state.SkipWithError("failed to assemble source");
+                break;
+            }
+            machine.loadMemProgram(as.getProgram());
+            machine.enable();
+        }
+        benchmark::DoNotOptimize(machine.run(BENCH_LC3_MAX_CYCLES));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AsmRunSnippet)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
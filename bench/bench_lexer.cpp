@@ -0,0 +1,338 @@
+/* BENCH_LEXER
+ * Lexer throughput (in MB/s of source) on the programs in asm/
+ *
+ * Stefan Wong 2018
+ */
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "keyword.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+
+/*
+ * BM_LexFile
+ * Lex a complete source file. Loading the file from disk
+ * is not included in the timing.
+ */
+static void BM_LexFile(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    uint64_t num_bytes = 0;
+    uint64_t num_lines = 0;
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table, filename);
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lex();
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in source");
+            break;
+        }
+        num_bytes += lexer.getSrcLength();
+        num_lines += src.getNumLines();
+    }
+    state.SetBytesProcessed(num_bytes);
+    state.counters["lines_per_sec"] = benchmark::Counter(
+            (double) num_lines, benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_LexFile, pow10, "asm/pow10.asm");
+BENCHMARK_CAPTURE(BM_LexFile, char_count, "asm/char_count.asm");
+BENCHMARK_CAPTURE(BM_LexFile, crypto, "asm/crypto.asm");
+BENCHMARK_CAPTURE(BM_LexFile, sentinel, "asm/sentinel.asm");
+
+/*
+ * BM_LoadFile
+ * Load (map) a source file into a Lexer, without lexing it
+ */
+static void BM_LoadFile(benchmark::State& state, const char* filename)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    uint64_t num_bytes = 0;
+
+    for(auto _ : state)
+    {
+        Lexer lexer(op_table);
+        lexer.loadFile(filename);
+        num_bytes += lexer.getSrcLength();
+    }
+    state.SetBytesProcessed(num_bytes);
+}
+BENCHMARK_CAPTURE(BM_LoadFile, pow10, "asm/pow10.asm");
+BENCHMARK_CAPTURE(BM_LoadFile, crypto, "asm/crypto.asm");
+
+// Tokens in roughly the proportions they turn up in source
+static const char* bench_tokens[] = {
+    "ADD", "R1", "LD", "LOOP", "BRnz", ".FILL", "x3000", "HALT",
+    "LEA", "R0", "PUTS", "#-1", ".ORIG", "AND", "JSR", "DONE"
+};
+
+/*
+ * BM_KeywordFind
+ * Classify a token with the keyword perfect hash
+ */
+static void BM_KeywordFind(benchmark::State& state)
+{
+    std::string_view tokens[16];
+    for(int i = 0; i < 16; ++i)
+        tokens[i] = bench_tokens[i];
+
+    for(auto _ : state)
+    {
+        for(const std::string_view& tok : tokens)
+            benchmark::DoNotOptimize(lex_keyword_find(tok));
+    }
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+BENCHMARK(BM_KeywordFind);
+
+/*
+ * BM_KeywordTableGet
+ * Classify a token the old way, with a string per token and a
+ * linear search through each OpcodeTable
+ */
+static void BM_KeywordTableGet(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    OpcodeTable trap_table;
+    OpcodeTable dir_table;
+    std::string_view tokens[16];
+
+    for(const Opcode& op : lc3_psuedo_op_list)
+        trap_table.add(op);
+    for(const Opcode& op : LEX_ASM_DIRECTIVE_OPCODES)
+        dir_table.add(op);
+    for(int i = 0; i < 16; ++i)
+        tokens[i] = bench_tokens[i];
+
+    for(auto _ : state)
+    {
+        for(const std::string_view& tok : tokens)
+        {
+            Opcode o;
+            dir_table.get(std::string(tok), o);
+            trap_table.get(std::string(tok), o);
+            op_table.get(std::string(tok), o);
+            benchmark::DoNotOptimize(o.opcode);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+BENCHMARK(BM_KeywordTableGet);
+
+/*
+ * BM_SymbolFind
+ * Look up every label in a table of n labels
+ */
+static void BM_SymbolFind(benchmark::State& state)
+{
+    SymbolTable sym_table;
+    std::vector<std::string> labels;
+    std::vector<Symbol> syms;
+
+    for(int n = 0; n < state.range(0); ++n)
+        labels.push_back("label_" + std::to_string(n));
+    for(unsigned int n = 0; n < labels.size(); ++n)
+    {
+        Symbol s;
+        s.label = labels[n];
+        s.addr  = (uint16_t) n;
+        syms.push_back(s);
+    }
+    sym_table.build(syms);
+
+    for(auto _ : state)
+    {
+        for(const std::string& label : labels)
+        {
+            uint16_t addr;
+            benchmark::DoNotOptimize(sym_table.find(label, addr));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * labels.size());
+}
+BENCHMARK(BM_SymbolFind)->RangeMultiplier(8)->Range(1 << 6, 1 << 16);
+
+/*
+ * bench_make_corpus()
+ * Repeat the sources that lex cleanly until there are at least
+ * min_bytes
+ */
+static std::string bench_make_corpus(const size_t min_bytes)
+{
+    const char* filenames[] = {"asm/add_test.asm", "asm/pow10.asm", "asm/sentinel.asm"};
+    std::string unit;
+    std::string corpus;
+
+    for(const char* filename : filenames)
+    {
+        std::ifstream infile(filename);
+        std::ostringstream oss;
+        oss << infile.rdbuf();
+        unit += oss.str();
+    }
+    if(unit.size() == 0)
+        return corpus;
+    corpus.reserve(min_bytes + unit.size());
+    while(corpus.size() < min_bytes)
+        corpus += unit;
+
+    return corpus;
+}
+
+/*
+ * BM_LexParallel
+ * Lex a large source with lexParallel() on some number of threads
+ */
+static void BM_LexParallel(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string corpus = bench_make_corpus(state.range(0));
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table);
+        lexer.loadBuffer(corpus);
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lexParallel(state.range(1));
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in corpus");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_LexParallel)
+    ->ArgsProduct({{1 << 20, 1 << 24}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+/*
+ * BM_LexCore
+ * Lex a large source with each scanning core (LEX_CORE_SCAN, then
+ * LEX_CORE_DFA)
+ */
+static void BM_LexCore(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string corpus = bench_make_corpus(state.range(0));
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table);
+        lexer.loadBuffer(corpus);
+        lexer.setCore(state.range(1));
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lex();
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in corpus");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_LexCore)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 24}, {LEX_CORE_SCAN, LEX_CORE_DFA}});
+
+/*
+ * BM_SourceRead
+ * Load the lexer output for a large source from a file written by
+ * SourceInfo::write(). Compare with BM_LexCore on the same size.
+ */
+static void BM_SourceRead(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string corpus = bench_make_corpus(state.range(0));
+    const std::string filename = "data/bench_source.lex";
+    Lexer lexer(op_table);
+
+    lexer.loadBuffer(corpus);
+    const SourceInfo& lex_src = lexer.lex();
+    if(lex_src.hasError() || lex_src.write(filename, &lexer.getSymTable()) < 0)
+    {
+        state.SkipWithError("failed to write lexer output");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        SourceInfo src;
+        SymbolTable syms;
+        if(src.read(filename, &syms) < 0)
+        {
+            state.SkipWithError("failed to read lexer output");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+    }
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_SourceRead)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24);
+
+/*
+ * BM_LexEdit
+ * Edit the middle of a large source and re-lex with edit(), either
+ * changing one register (0) or putting in and taking out a blank 
+ * line, which moves the line numbers of everything after it (1). 
+ * Compare with BM_LexParallel on one thread, which is a full lex 
+ * of the same corpus.
+ */
+static void BM_LexEdit(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string corpus = bench_make_corpus(state.range(0));
+    Lexer lexer(op_table);
+    SourceInfo src;
+    size_t pos;
+
+    lexer.loadBuffer(corpus);
+    src = lexer.lex();
+    pos = corpus.find(" R1", corpus.size() / 2);
+    if(src.hasError() || pos == std::string::npos)
+    {
+        state.SkipWithError("no edit site in corpus");
+        return;
+    }
+    pos++;
+    if(state.range(1) == 1)
+        pos = corpus.rfind('\n', pos) + 1;
+
+    bool flip = false;
+    for(auto _ : state)
+    {
+        LexEdit e;
+        if(state.range(1) == 0)
+            e = lexer.edit(pos, 2, flip ? "R1" : "R2");
+        else
+            e = lexer.edit(pos, flip ? 1 : 0, flip ? "" : "\n");
+        flip = !flip;
+        benchmark::DoNotOptimize(e.num_added);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LexEdit)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,135 @@
+/* BENCH_LITERAL
+ * Numeric literal parsing with lex_parse_literal() against the
+ * copy and std::stoi() it replaced, and a full lex of a source where
+ * most tokens are operands.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "literal.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+
+static const char* bench_literals[] = {
+    "#0", "#15", "#-16", "x3000", "xFFFF", "#-1", "x0F", "#255",
+    "#1000", "x1A2B", "#-32", "x7", "#12345", "xBEEF", "#31", "x100"
+};
+static const unsigned int bench_num_literals = sizeof(bench_literals) / sizeof(bench_literals[0]);
+
+/*
+ * BM_LiteralParse
+ */
+static void BM_LiteralParse(benchmark::State& state)
+{
+    std::vector<std::string_view> toks(bench_literals, bench_literals + bench_num_literals);
+
+    for(auto _ : state)
+    {
+        for(const std::string_view& t : toks)
+        {
+            LexLiteral lit = lex_parse_literal(t);
+            benchmark::DoNotOptimize(lit);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * toks.size());
+}
+BENCHMARK(BM_LiteralParse);
+
+/*
+ * BM_LiteralStoi
+ * What the lexer did before: copy the token into a string and
+ * convert the part after the prefix
+ */
+static void BM_LiteralStoi(benchmark::State& state)
+{
+    std::vector<std::string_view> toks(bench_literals, bench_literals + bench_num_literals);
+
+    for(auto _ : state)
+    {
+        for(const std::string_view& t : toks)
+        {
+            std::string arg = std::string(t);
+            int val;
+            if(t[0] == 'x' || t[0] == 'X')
+                val = std::stoi(arg.substr(1, arg.length()), nullptr, 16);
+            else
+                val = std::stoi(arg.substr(1, arg.length()));
+            benchmark::DoNotOptimize(val);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * toks.size());
+}
+BENCHMARK(BM_LiteralStoi);
+
+/*
+ * bench_make_operand_source()
+ * A source of num_lines instructions which are almost all
+ * registers and literals
+ */
+static std::string bench_make_operand_source(const unsigned int num_lines)
+{
+    std::ostringstream oss;
+
+    oss << "    .ORIG x3000" << std::endl;
+    for(unsigned int n = 0; n < num_lines; ++n)
+    {
+        switch(n % 5)
+        {
+            case 0:
+                oss << "    ADD R1, R2, #" << (int) (n % 32) - 16 << std::endl;
+                break;
+            case 1:
+                oss << "    AND R3, R3, x" << std::hex << n % 16 << std::dec << std::endl;
+                break;
+            case 2:
+                oss << "    LDR R4, R5, #" << (int) (n % 64) - 32 << std::endl;
+                break;
+            case 3:
+                oss << "    STR R6, R7, x" << std::hex << n % 32 << std::dec << std::endl;
+                break;
+            case 4:
+                oss << "    .FILL x" << std::hex << (n * 0x9E37) % 0x10000 << std::dec << std::endl;
+                break;
+        }
+    }
+    oss << "    .END" << std::endl;
+
+    return oss.str();
+}
+
+/*
+ * BM_LexOperands
+ */
+static void BM_LexOperands(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    std::string text = bench_make_operand_source(state.range(0));
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table);
+        lexer.loadBuffer(text);
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lex();
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in operand source");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LexOperands)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+
+BENCHMARK_MAIN();
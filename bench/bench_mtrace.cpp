@@ -0,0 +1,81 @@
+/* BENCH_MTRACE
+ * Cost of adding to and dumping the machine trace
+ *
+ * Stefan Wong 2018
+ */
+
+#include <vector>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "machine.hpp"
+#include "lc3.hpp"      // for LC3Proc
+
+/*
+ * BM_MTraceAdd
+ * Add one processor state per iteration (the per-cycle cost
+ * of running with the trace enabled)
+ */
+static void BM_MTraceAdd(benchmark::State& state)
+{
+    MTrace<LC3Proc> trace(state.range(0));
+    LC3Proc proc;
+
+    for(auto _ : state)
+    {
+        proc.pc++;
+        trace.add(proc);
+    }
+    benchmark::DoNotOptimize(trace.get(0));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MTraceAdd)->Arg(16)->Arg(LC3_TRACE_SIZE)->Arg(4096);
+
+/*
+ * BM_MTraceDump
+ * Dump a full trace
+ */
+static void BM_MTraceDump(benchmark::State& state)
+{
+    MTrace<LC3Proc> trace(state.range(0));
+    LC3Proc proc;
+
+    for(int t = 0; t < state.range(0); ++t)
+    {
+        proc.pc = t;
+        trace.add(proc);
+    }
+    for(auto _ : state)
+    {
+        std::vector<LC3Proc> d = trace.dump();
+        benchmark::DoNotOptimize(d.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(LC3Proc));
+}
+BENCHMARK(BM_MTraceDump)->Arg(16)->Arg(LC3_TRACE_SIZE)->Arg(4096);
+
+/*
+ * BM_MTraceDumpOrdered
+ * Dump a full trace with the most recent state first
+ */
+static void BM_MTraceDumpOrdered(benchmark::State& state)
+{
+    MTrace<LC3Proc> trace(state.range(0));
+    LC3Proc proc;
+
+    for(int t = 0; t < state.range(0); ++t)
+    {
+        proc.pc = t;
+        trace.add(proc);
+    }
+    for(auto _ : state)
+    {
+        std::vector<LC3Proc> d = trace.dumpOrdered();
+        benchmark::DoNotOptimize(d.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(LC3Proc));
+}
+BENCHMARK(BM_MTraceDumpOrdered)->Arg(16)->Arg(LC3_TRACE_SIZE)->Arg(4096);
+
+BENCHMARK_MAIN();
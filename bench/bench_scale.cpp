@@ -0,0 +1,240 @@
+/* BENCH_SCALE
+ * Lex and assemble time and peak memory on generated sources from
+ * 1K to 10M lines, and the one pass assembler against lexing and
+ * then assembling. Time per line should stay flat as the source
+ * grows; if it does not something is worse than linear.
+ *
+ * Peak memory is the most allocated at once (through operator new)
+ * while the timed part runs, above what was allocated before it
+ * started, so it is the memory the lexer or assembler needs for
+ * that source.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "corpus.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+
+// Room in front of each block for its size, keeping the alignment
+// that new promises
+#define BENCH_MEM_HEADER  16
+
+static std::atomic<size_t> bench_mem_cur(0);
+static std::atomic<size_t> bench_mem_peak(0);
+
+void* operator new(size_t size)
+{
+    char* p = (char*) std::malloc(size + BENCH_MEM_HEADER);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    *((size_t*) p) = size;
+
+    size_t cur  = bench_mem_cur.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = bench_mem_peak.load(std::memory_order_relaxed);
+    while(cur > peak && !bench_mem_peak.compare_exchange_weak(peak, cur, std::memory_order_relaxed))
+        ;
+
+    return p + BENCH_MEM_HEADER;
+}
+
+// GCC sees free() of something that came from new, not knowing
+// that this is the new it came from
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* ptr) noexcept
+{
+    if(ptr == nullptr)
+        return;
+    char* p = ((char*) ptr) - BENCH_MEM_HEADER;
+    bench_mem_cur.fetch_sub(*((size_t*) p), std::memory_order_relaxed);
+    std::free(p);
+}
+#pragma GCC diagnostic pop
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept
+{
+    operator delete(ptr);
+}
+
+/*
+ * bench_mem_reset()
+ * Start measuring the peak from here, returning what is allocated now
+ */
+static size_t bench_mem_reset(void)
+{
+    size_t cur = bench_mem_cur.load();
+    bench_mem_peak.store(cur);
+
+    return cur;
+}
+
+/*
+ * bench_corpus()
+ * Generated source with num_lines lines. Only the last one is
+ * kept, as the big ones take a while to make and a lot of memory.
+ */
+static const std::string& bench_corpus(const unsigned int num_lines)
+{
+    static std::string   text;
+    static unsigned int  text_lines = 0;
+
+    if(text_lines != num_lines)
+    {
+        CorpusParams p;
+        initCorpusParams(p);
+        p.num_lines = num_lines;
+        text = std::string();
+        text = genCorpus(p);
+        text_lines = num_lines;
+    }
+
+    return text;
+}
+
+/*
+ * BM_ScaleLex
+ */
+static void BM_ScaleLex(benchmark::State& state)
+{
+    LC3 machine;
+    OpcodeTable op_table = machine.getOpTable();
+    const std::string& text = bench_corpus(state.range(0));
+    size_t peak = 0;
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(op_table);
+        lexer.loadBuffer(text);
+        size_t base = bench_mem_reset();
+        state.ResumeTiming();
+
+        const SourceInfo& src = lexer.lex();
+        if(src.hasError())
+        {
+            state.SkipWithError("lexer error in generated source");
+            break;
+        }
+        benchmark::DoNotOptimize(src.getNumLines());
+        peak = std::max(peak, bench_mem_peak.load() - base);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["peak_MB"]         = (double) peak / (1 << 20);
+    state.counters["peak_B_per_line"] = (double) peak / state.range(0);
+}
+BENCHMARK(BM_ScaleLex)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+/*
+ * BM_ScaleAssemble
+ * Assemble an already lexed source. Each run gets its own copy
+ * of the lexer output, which is not timed.
+ */
+static void BM_ScaleAssemble(benchmark::State& state)
+{
+    LC3 machine;
+    SourceInfo src;
+    size_t peak = 0;
+    {
+        Lexer lexer(machine.getOpTable());
+        lexer.loadBuffer(bench_corpus(state.range(0)));
+        if(lexer.lex().hasError())
+        {
+            state.SkipWithError("lexer error in generated source");
+            return;
+        }
+        src = lexer.takeSrcInfo();
+    }
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        SourceInfo run_src = src;
+        size_t base = bench_mem_reset();
+        state.ResumeTiming();
+
+        Assembler as(std::move(run_src));
+        as.assemble();
+        if(as.getNumErr() > 0)
+        {
+            state.SkipWithError("assembler error in generated source");
+            break;
+        }
+        peak = std::max(peak, bench_mem_peak.load() - base);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["peak_MB"]         = (double) peak / (1 << 20);
+    state.counters["peak_B_per_line"] = (double) peak / state.range(0);
+}
+BENCHMARK(BM_ScaleAssemble)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+/*
+ * BM_ScaleLexAssemble
+ * Source to program, either in one pass with the assembler taking
+ * lines from the lexer as they come (arg 1), or by lexing the
+ * whole source and then assembling it (arg 0)
+ */
+static void BM_ScaleLexAssemble(benchmark::State& state)
+{
+    LC3 machine;
+    const std::string& text = bench_corpus(state.range(0));
+    bool one_pass = state.range(1) ? true : false;
+    size_t peak = 0;
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Lexer lexer(machine.getOpTable());
+        lexer.loadBuffer(text);
+        size_t base = bench_mem_reset();
+        state.ResumeTiming();
+
+        Assembler as;
+        if(one_pass)
+            as.assemble(lexer);
+        else
+        {
+            lexer.lex();
+            as = Assembler(lexer.takeSrcInfo());
+            as.assemble();
+        }
+        if(as.getNumErr() > 0)
+        {
+            state.SkipWithError("assembler error in generated source");
+            break;
+        }
+        peak = std::max(peak, bench_mem_peak.load() - base);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["peak_MB"]         = (double) peak / (1 << 20);
+    state.counters["peak_B_per_line"] = (double) peak / state.range(0);
+}
+BENCHMARK(BM_ScaleLexAssemble)
+    ->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+/* BENCH_SCAN
+ * Vector against scalar scanning for blanks and line ends. The text
+ * is asm/crypto.asm (which is mostly comments) repeated up to the
+ * requested size.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <benchmark/benchmark.h>
+// Modules under test
+#include "scan.hpp"
+
+static const char* bench_scan_filename = "asm/crypto.asm";
+
+/*
+ * bench_make_text()
+ * Repeat the source file until there are at least min_bytes
+ */
+static std::string bench_make_text(const size_t min_bytes)
+{
+    std::ifstream infile(bench_scan_filename);
+    std::ostringstream oss;
+    std::string text;
+
+    oss << infile.rdbuf();
+    std::string unit = oss.str();
+    if(unit.size() == 0)
+        return text;
+    text.reserve(min_bytes + unit.size());
+    while(text.size() < min_bytes)
+        text += unit;
+
+    return text;
+}
+
+/*
+ * bench_skip_all()
+ * Walk the text the way the lexer does, alternately skipping
+ * blanks and skipping to the end of the line
+ */
+template <bool vec> static uint64_t bench_skip_all(const std::string& text)
+{
+    unsigned int lines = 0;
+    size_t pos = 0;
+
+    while(pos < text.size())
+    {
+        if(vec)
+        {
+            pos = lex_scan_blank(text.data(), pos, text.size(), false, lines);
+            pos = lex_scan_line_end(text.data(), pos, text.size());
+        }
+        else
+        {
+            pos = lex_scan_blank_scalar(text.data(), pos, text.size(), false, lines);
+            pos = lex_scan_line_end_scalar(text.data(), pos, text.size());
+        }
+    }
+
+    return lines;
+}
+
+/*
+ * BM_ScanVector
+ */
+static void BM_ScanVector(benchmark::State& state)
+{
+    std::string text = bench_make_text(state.range(0));
+
+    state.SetLabel(lex_scan_impl());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(bench_skip_all<true>(text));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ScanVector)->RangeMultiplier(8)->Range(1 << 16, 1 << 22);
+
+/*
+ * BM_ScanScalar
+ */
+static void BM_ScanScalar(benchmark::State& state)
+{
+    std::string text = bench_make_text(state.range(0));
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(bench_skip_all<false>(text));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ScanScalar)->RangeMultiplier(8)->Range(1 << 16, 1 << 22);
+
+BENCHMARK_MAIN();
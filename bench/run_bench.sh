@@ -0,0 +1,21 @@
+#!/bin/bash
+# Run benchmarks, writing the results of each one as JSON 
+# into bench/results. Files are tagged with the commit so that
+# builds can be compared over time. Build with optimization for
+# meaningful numbers, eg 
+#
+#   make clean && make bench OPT=-O2 && ./bench/run_bench.sh
+
+BENCH_DIR="./bin/bench"
+OUT_DIR="./bench/results"
+TAG=$(git rev-parse --short HEAD 2>/dev/null || echo "local")
+
+mkdir -p ${OUT_DIR}
+for b in ${BENCH_DIR}/bench_*; do
+    name=$(basename $b)
+    ./$b --benchmark_out=${OUT_DIR}/${name}_${TAG}.json \
+         --benchmark_out_format=json "$@" || rc=$?
+    if [[ rc -ne 0 ]] ; then
+        exit $rc
+    fi
+done
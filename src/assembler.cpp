@@ -7,8 +7,15 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
 #include "assembler.hpp"
+#include "log.hpp"
 // TODO ; also need LC3 constants here ...
 #include "lc3.hpp"
 
@@ -74,6 +81,30 @@ void AsmLog::add(const AsmLogEntry& e)
     this->log.push_back(e);
 }
 
+/*
+ * set()
+ * Replace the entry at idx
+ */
+void AsmLog::set(const unsigned int idx, const AsmLogEntry& e)
+{
+    if(idx < this->log.size())
+        this->log[idx] = e;
+}
+
+/*
+ * append()
+ * Add all the entries of another log to the end of this one
+ */
+void AsmLog::append(const AsmLog& that)
+{
+    this->log.insert(this->log.end(), that.log.begin(), that.log.end());
+}
+
+unsigned int AsmLog::getNumEntries(void) const
+{
+    return this->log.size();
+}
+
 AsmLogEntry AsmLog::get(const unsigned int idx) const
 {
     return this->log[idx % this->log.size()];
@@ -100,12 +131,59 @@ std::string AsmLog::getString(void) const
  *
  * Assembles an LC3 binary from a SourceInfo structure 
  */
+Assembler::Assembler()
+{
+    this->str_src       = nullptr;
+    this->out           = nullptr;
+    this->out_end       = nullptr;
+    this->out_full      = false;
+    this->mem           = nullptr;
+    this->mem_size      = 0;
+    this->mem_words     = 0;
+    this->start_addr    = 0;
+    this->start_set     = false;
+    this->num_err       = 0;
+    this->verbose       = false;
+    this->cont_on_error = false;
+    this->quiet         = false;
+}
+
 Assembler::Assembler(const SourceInfo& si)
 {
     this->src_info      = si;
+    this->str_src       = nullptr;
+    this->out           = nullptr;
+    this->out_end       = nullptr;
+    this->out_full      = false;
+    this->mem           = nullptr;
+    this->mem_size      = 0;
+    this->mem_words     = 0;
+    this->start_addr    = 0;
+    this->start_set     = false;
+    this->num_err       = 0;
+    this->verbose       = false;
+    this->cont_on_error = false;
+    this->quiet         = false;
+}
+
+// Take the lines rather than copying them, for use with 
+// Lexer::takeSrcInfo()
+Assembler::Assembler(SourceInfo&& si)
+{
+    this->src_info      = std::move(si);
+    this->str_src       = nullptr;
+    this->out           = nullptr;
+    this->out_end       = nullptr;
+    this->out_full      = false;
+    this->mem           = nullptr;
+    this->mem_size      = 0;
+    this->mem_words     = 0;
+    this->start_addr    = 0;
+    this->start_set     = false;
     this->num_err       = 0;
     this->verbose       = false;
     this->cont_on_error = false;
+    this->quiet         = false;
 }
 
 Assembler::~Assembler() {}
@@ -143,6 +221,43 @@ inline uint16_t Assembler::asm_pc11(const uint16_t arg)
     return 0x0000 | (arg & 0x07FF);
 }
 
+/*
+ * emit()
+ * Output one word of the program
+ */
+inline void Assembler::emit(const Instr& i)
+{
+    if(this->mem != nullptr)
+    {
+        if(i.adr < this->mem_size)
+        {
+            this->mem[i.adr] = i.ins;
+            this->mem_words++;
+        }
+        else
+            this->memError(i.adr);
+    }
+    else if(this->out == nullptr)
+        this->program.add(i);
+    else if(this->out < this->out_end)
+        *(this->out++) = i;
+    else
+        this->out_full = true;
+}
+
+/*
+ * memError()
+ * The line being assembled has a word past the end of memory
+ */
+void Assembler::memError(const uint16_t adr)
+{
+    std::ostringstream oss;
+    oss << "Address 0x" << std::hex << std::setw(4) << std::setfill('0')
+        << adr << " is outside memory (" << std::dec << this->mem_size << " words)";
+    this->cur_log_entry.msg   = oss.str();
+    this->cur_log_entry.error = true;
+}
+
 /*
  * asm_add()
  * Assemble ADD instruction
@@ -154,8 +269,7 @@ void Assembler::asm_add(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling ADD" << std::endl;
+        LOG_DEBUG("(src line %u) assembling ADD", line.line_num);
     }
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     instr.ins = (instr.ins | this->asm_arg2(line.arg2));
@@ -166,10 +280,10 @@ void Assembler::asm_add(const LineInfo& line)
     }
     else
         instr.ins = (instr.ins | this->asm_arg3(line.arg3));
-    instr.ins  = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins  = (instr.ins | (line.opcode << 12));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -183,10 +297,9 @@ void Assembler::asm_and(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling AND" << std::endl;
+        LOG_DEBUG("(src line %u) assembling AND", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins| this->asm_arg1(line.arg1));
     instr.ins = (instr.ins| this->asm_arg2(line.arg2));
     instr.ins = (instr.ins | this->asm_arg3(line.arg3));
@@ -199,7 +312,7 @@ void Assembler::asm_and(const LineInfo& line)
         instr.ins = (instr.ins | this->asm_arg3(line.arg3));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -214,10 +327,9 @@ void Assembler::asm_br(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling BR" << std::endl;
+        LOG_DEBUG("(src line %u) assembling BR", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     offset = (line.imm == 0) ? 0 : line.imm - (line.addr + 1);
     if(offset < -LC3_OFFSET_MAX || offset > LC3_OFFSET_MAX)
     {
@@ -236,7 +348,7 @@ void Assembler::asm_br(const LineInfo& line)
     instr.ins = (instr.ins | (offset & 0x01FF));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -250,14 +362,13 @@ void Assembler::asm_jmp(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling JMP" << std::endl;
+        LOG_DEBUG("(src line %u) assembling JMP", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg2(instr.ins));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -274,8 +385,7 @@ void Assembler::asm_jsr(const LineInfo& line)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] (src line " 
-                << std::dec << line.line_num << ") assembling JSR" << std::endl;
+            LOG_DEBUG("(src line %u) assembling JSR", line.line_num);
         }
         instr.ins = (instr.ins | this->asm_pc11(instr.ins));
     }
@@ -283,15 +393,14 @@ void Assembler::asm_jsr(const LineInfo& line)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] (src line " 
-                << std::dec << line.line_num << ") assembling JSRR" << std::endl;
+            LOG_DEBUG("(src line %u) assembling JSRR", line.line_num);
         }
         instr.ins = (instr.ins | this->asm_arg2(instr.ins));
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 
 }
 
@@ -307,10 +416,9 @@ void Assembler::asm_lea(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling LEA" << std::endl;
+        LOG_DEBUG("(src line %u) assembling LEA", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     offset    = line.imm - (line.addr + 1);
     if(offset < -LC3_OFFSET_MAX || offset > LC3_OFFSET_MAX)
@@ -323,7 +431,7 @@ void Assembler::asm_lea(const LineInfo& line)
     instr.ins = (instr.ins | (offset & 0x01FF));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -338,10 +446,9 @@ void Assembler::asm_ld(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling LD" << std::endl;
+        LOG_DEBUG("(src line %u) assembling LD", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     offset = (line.imm == 0) ? 0 : line.imm - (line.addr + 1);
     if(offset < -LC3_OFFSET_MAX || offset > LC3_OFFSET_MAX)
@@ -353,7 +460,7 @@ void Assembler::asm_ld(const LineInfo& line)
     instr.ins = (instr.ins | (offset & 0x01FF));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -368,10 +475,9 @@ void Assembler::asm_ldr(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling LDR" << std::endl;
+        LOG_DEBUG("(src line %u) assembling LDR", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     instr.ins = (instr.ins | this->asm_arg2(line.arg2)); 
     offset    = (line.imm == 0) ? 0 : line.imm - (line.addr + 1);
@@ -384,7 +490,7 @@ void Assembler::asm_ldr(const LineInfo& line)
     instr.ins = (instr.ins | (offset & 0x01FF));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -398,17 +504,16 @@ void Assembler::asm_not(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling NOT" << std::endl;
+        LOG_DEBUG("(src line %u) assembling NOT", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     instr.ins = (instr.ins | this->asm_arg2(line.imm));
     // NOT Has lower 6 bits set to 1
     instr.ins = (instr.ins | 0x001F);
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -423,10 +528,9 @@ void Assembler::asm_st(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling ST" << std::endl;
+        LOG_DEBUG("(src line %u) assembling ST", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     offset = (line.imm == 0) ? 0 : line.imm - (line.addr + 1);
     if(offset < -LC3_OFFSET_MAX || offset > LC3_OFFSET_MAX)
@@ -439,7 +543,7 @@ void Assembler::asm_st(const LineInfo& line)
     instr.ins = (instr.ins | (offset & 0x01FF));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -453,16 +557,15 @@ void Assembler::asm_str(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling STR" << std::endl;
+        LOG_DEBUG("(src line %u) assembling STR", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     instr.ins = (instr.ins | this->asm_arg2(line.arg2));
     instr.ins = (instr.ins | (this->asm_of6(line.imm) & 0x003F));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -476,16 +579,15 @@ void Assembler::asm_sti(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling STI" << std::endl;
+        LOG_DEBUG("(src line %u) assembling STI", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_arg1(line.arg1));
     instr.ins = (instr.ins | this->asm_arg2(line.arg2));
     instr.ins = (instr.ins | (this->asm_of6(line.imm) & 0x003F));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
 }
 
 /*
@@ -499,14 +601,39 @@ void Assembler::asm_trap(const LineInfo& line)
     instr.ins = 0;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " 
-            << std::dec << line.line_num << ") assembling TRAP" << std::endl;
+        LOG_DEBUG("(src line %u) assembling TRAP", line.line_num);
     }
-    instr.ins = (instr.ins | (line.opcode.opcode << 12));
+    instr.ins = (instr.ins | (line.opcode << 12));
     instr.ins = (instr.ins | this->asm_in8(line.imm));
     instr.adr = line.addr;
 
-    this->program.add(instr);
+    this->emit(instr);
+}
+
+/*
+ * asm_none()
+ * Lines with nothing to encode (.END)
+ */
+void Assembler::asm_none(const LineInfo& line)
+{
+}
+
+/*
+ * asm_invalid()
+ * Lines with an opcode that can't be assembled
+ */
+void Assembler::asm_invalid(const LineInfo& line)
+{
+    std::ostringstream oss;
+    oss << "Invalid opcode 0x" << std::hex << std::setw(2)
+        << line.opcode << " (mnemonic " 
+        << std::uppercase << this->str_src->getStr(line.mnemonic) << ")";
+    this->cur_log_entry.msg = oss.str();
+    this->cur_log_entry.error = true;
+    if(this->verbose)
+    {
+        LOG_DEBUG("%s", this->cur_log_entry.msg);
+    }
 }
 
 /*
@@ -517,13 +644,12 @@ void Assembler::dir_blkw(const LineInfo& line)
 {
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " <<
-            std::dec << line.line_num << ") assembling .BLKW" << std::endl;
+        LOG_DEBUG("(src line %u) assembling .BLKW", line.line_num);
     }
 
     unsigned int addr;
     for(addr = line.addr; addr < line.addr + line.imm; addr++)
-        this->program.writeMem(addr, 0x0000);
+        this->emit({(uint16_t) addr, 0x0000});
 }
 
 /*
@@ -534,10 +660,9 @@ void Assembler::dir_fill(const LineInfo& line)
 {
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " <<
-            std::dec << line.line_num << ") assembling .FILL" << std::endl;
+        LOG_DEBUG("(src line %u) assembling .FILL", line.line_num);
     }
-    this->program.writeMem(line.addr, line.imm);
+    this->emit({line.addr, line.imm});
 }
 
 /*
@@ -548,10 +673,13 @@ void Assembler::dir_orig(const LineInfo& line)
 {
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " <<
-            std::dec << line.line_num << ") assembling .ORIG" << std::endl;
+        LOG_DEBUG("(src line %u) assembling .ORIG", line.line_num);
+    }
+    if(!this->start_set)
+    {
+        this->start_addr = line.imm;
+        this->start_set  = true;
     }
-    //this->start_addr = line.imm;
 }
 
 /*
@@ -562,121 +690,540 @@ void Assembler::dir_stringz(const LineInfo& line)
 {
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (src line " <<
-            std::dec << line.line_num << ") assembling .STRINGZ" << std::endl;
+        LOG_DEBUG("(src line %u) assembling .STRINGZ", line.line_num);
     }
     
+    std::string_view str = this->str_src->getStr(line.symbol);
     unsigned int addr, n;
     n = 0;
-    for(addr = line.addr; addr < (line.addr + line.symbol.length()); ++addr)
+    for(addr = line.addr; addr < (line.addr + str.length()); ++addr)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] writing symbol " 
-                << std::setw(2) << line.symbol[n] 
-                << " to address 0x" << std::hex << std::setw(4) 
-                << std::setfill('0') << addr << std::endl;
+            LOG_DEBUG("writing symbol %2c to address 0x%04x",
+                    str[n], addr);
         }
-        this->program.writeMem(addr, line.symbol[n]);
+        this->emit({(uint16_t) addr, (uint16_t) str[n]});
         n++;
     }
 }
 
+/*
+ * handlers
+ * Encoder for each line handler, in LINE_H_* order
+ */
+const Assembler::AsmHandler Assembler::handlers[LINE_H_MAX] = {
+    &Assembler::asm_none,           // LINE_H_NONE
+    &Assembler::asm_add,            // LINE_H_ADD
+    &Assembler::asm_and,            // LINE_H_AND
+    &Assembler::asm_br,             // LINE_H_BR
+    &Assembler::asm_jsr,            // LINE_H_JSR
+    &Assembler::asm_lea,            // LINE_H_LEA
+    &Assembler::asm_ld,             // LINE_H_LD
+    &Assembler::asm_ldr,            // LINE_H_LDR
+    &Assembler::asm_str,            // LINE_H_STR
+    &Assembler::asm_trap,           // LINE_H_TRAP
+    &Assembler::dir_blkw,           // LINE_H_BLKW
+    &Assembler::dir_fill,           // LINE_H_FILL
+    &Assembler::dir_orig,           // LINE_H_ORIG
+    &Assembler::dir_stringz,        // LINE_H_STRINGZ
+    &Assembler::asm_invalid,        // LINE_H_INVALID
+};
+
+/*
+ * encodeLine()
+ * Assemble a single directive or instruction with the encoder
+ * the lexer chose for it
+ */
+void Assembler::encodeLine(const LineInfo& line)
+{
+    // Lines read from a file may hold anything
+    uint8_t h = (line.handler < LINE_H_MAX) ? line.handler : LINE_H_INVALID;
+    (this->*handlers[h])(line);
+}
+
+/*
+ * lineSize()
+ * Most words that encodeLine() can output for a line. This has to
+ * follow encodeLine(). A line that fails outputs nothing, so it can 
+ * only be less.
+ */
+unsigned int Assembler::lineSize(const LineInfo& line) const
+{
+    if(line.error)
+        return 0;
+    switch(line.handler)
+    {
+        case LINE_H_ADD:
+        case LINE_H_AND:
+        case LINE_H_BR:
+        case LINE_H_JSR:
+        case LINE_H_LEA:
+        case LINE_H_LD:
+        case LINE_H_LDR:
+        case LINE_H_STR:
+        case LINE_H_TRAP:
+        case LINE_H_FILL:
+            return 1;
+        case LINE_H_BLKW:
+            return line.imm;
+        case LINE_H_STRINGZ:
+            return this->str_src->getStr(line.symbol).length();
+        default:
+            return 0;
+    }
+}
+
+/*
+ * assembleLine()
+ * Assemble one line and log the result. The result goes in log
+ * entry log_idx if that is set, otherwise at the end of the log.
+ * Returns false if assembly should stop here.
+ */
+bool Assembler::assembleLine(const LineInfo& line, const int log_idx)
+{
+    // Init the log info for this line
+    this->cur_log_entry.init();
+    this->cur_log_entry.line = line.line_num;
+    this->cur_log_entry.addr = line.addr;
+    if(line.error)
+    {
+        this->num_err++;
+        this->cur_log_entry.error = true;
+        this->cur_log_entry.msg = "Lexer error on line " + std::to_string(line.line_num);
+    }
+    else
+        this->encodeLine(line);
+
+    if(log_idx < 0)
+        this->log.add(this->cur_log_entry);
+    else
+        this->log.set(log_idx, this->cur_log_entry);
+    if(this->cur_log_entry.error)
+    {
+        this->num_err++;
+        if(!this->quiet)
+            std::cerr << this->cur_log_entry.msg << std::endl;
+        if(!this->cont_on_error)
+            return false;
+    }
+
+    return true;
+}
+
 /*
  * assemble()
  * Assemble the program into a memory image 
  */
 void Assembler::assemble(void)
 {
-    LineInfo cur_line;
     unsigned int num_lines, idx;
 
     this->num_err = 0;
+    this->start_addr = 0;
+    this->start_set  = false;
+    this->str_src = &this->src_info;
     num_lines = this->src_info.getNumLines();
     for(idx = 0; idx < num_lines; idx++)
     {
-        // Init the log info for this line
-        this->cur_log_entry.init();
-        // Get the current line
-        cur_line = this->src_info.get(idx);
-        this->cur_log_entry.line = cur_line.line_num;
-        this->cur_log_entry.addr = cur_line.addr;
-        if(cur_line.error)
+        if(!this->assembleLine(this->src_info.get(idx)))
+            return;
+    }
+}
+
+/*
+ * AsmChunk
+ * A run of lines for assembleParallel(), and the part of the
+ * program its output goes in
+ */
+typedef struct
+{
+    unsigned int               first;       // first line
+    unsigned int               num_lines;
+    unsigned int               slot;        // first instruction of the output
+    unsigned int               size;        // most instructions the lines can output
+    unsigned int               num_out;     // instructions actually output
+    std::unique_ptr<Assembler> as;
+    std::exception_ptr         except;
+} AsmChunk;
+
+/*
+ * assembleParallel()
+ * Every line is already resolved, so lines can be encoded in any
+ * order once it is known where their output goes. The most each 
+ * chunk can output is worked out first, and a prefix sum over that
+ * gives each chunk its place in the program. Chunks are then encoded
+ * into their places, each by its own Assembler, and the logs joined
+ * in order. A line that fails outputs less than its share, so in 
+ * that case the output is closed up afterwards.
+ */
+void Assembler::assembleParallel(const unsigned int num_threads, const unsigned int chunk_lines)
+{
+    std::vector<AsmChunk> chunks;
+    unsigned int num_lines = this->src_info.getNumLines();
+    unsigned int base, total, last, dst;
+
+    this->str_src = &this->src_info;
+    for(unsigned int first = 0; first < num_lines; first += std::max(chunk_lines, 1u))
+    {
+        chunks.emplace_back();
+        chunks.back().first     = first;
+        chunks.back().num_lines = std::min(std::max(chunk_lines, 1u), num_lines - first);
+    }
+    if(num_threads <= 1 || chunks.size() <= 1)
+    {
+        this->assemble();
+        return;
+    }
+
+    auto run_chunks = [&](const std::function<void(AsmChunk&)>& fn)
+    {
+        std::atomic<unsigned int> next_chunk(0);
+        auto worker = [&](void)
         {
-            this->num_err++;
-            this->cur_log_entry.error = true;
-            this->cur_log_entry.msg = "Lexer error on line " + std::to_string(cur_line.line_num);
-            goto LINE_END;
-        }
+            unsigned int idx;
 
-        // Handle directives 
-        if(cur_line.is_directive)
+            while((idx = next_chunk.fetch_add(1)) < chunks.size())
+            {
+                try
+                {
+                    fn(chunks[idx]);
+                }
+                catch(...)
+                {
+                    chunks[idx].except = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        unsigned int num_workers = std::min((size_t) num_threads, chunks.size());
+        for(unsigned int t = 0; t < num_workers; ++t)
+            workers.emplace_back(worker);
+        for(std::thread& w : workers)
+            w.join();
+        for(AsmChunk& c : chunks)
         {
-            if(cur_line.opcode.mnemonic == ".BLKW")
-                this->dir_blkw(cur_line);
-            else if(cur_line.opcode.mnemonic == ".FILL")
-                this->dir_fill(cur_line);
-            else if(cur_line.opcode.mnemonic == ".ORIG")
-                this->dir_orig(cur_line);
-            else if(cur_line.opcode.mnemonic == ".STRINGZ")
-                this->dir_stringz(cur_line);
-            goto LINE_END;
+            if(c.except)
+                std::rethrow_exception(c.except);
         }
+    };
 
-        // Handle opcodes 
-        switch(cur_line.opcode.opcode)
+    // Size of each chunk, then where each one starts
+    run_chunks([&](AsmChunk& c)
+    {
+        c.size = 0;
+        for(unsigned int idx = c.first; idx < c.first + c.num_lines; ++idx)
+            c.size += this->lineSize(this->src_info.get(idx));
+    });
+    base  = this->program.getNumInstr();
+    total = 0;
+    for(AsmChunk& c : chunks)
+    {
+        c.slot = base + total;
+        total += c.size;
+    }
+    this->program.resize(base + total);
+
+    // Encode 
+    Instr* data = this->program.getData();
+    run_chunks([&](AsmChunk& c)
+    {
+        c.as.reset(new Assembler());
+        Assembler& as      = *c.as;
+        as.verbose         = this->verbose;
+        as.cont_on_error   = this->cont_on_error;
+        as.quiet           = true;
+        as.str_src         = &this->src_info;
+        as.out             = data + c.slot;
+        as.out_end         = data + c.slot + c.size;
+        for(unsigned int idx = c.first; idx < c.first + c.num_lines; ++idx)
         {
-            case LC3_ADD:
-                this->asm_add(cur_line);
-                break;
-            case LC3_AND:
-                this->asm_and(cur_line);
-                break;
-            case LC3_BR:
-                this->asm_br(cur_line);
+            if(!as.assembleLine(this->src_info.get(idx)))
                 break;
-            case LC3_JSR:
-                this->asm_jsr(cur_line);
-                break;
-            case LC3_LEA:
-                this->asm_lea(cur_line);
-                break;
-            case LC3_LD:
-                this->asm_ld(cur_line);
-                break;
-            case LC3_LDR:
-                this->asm_ldr(cur_line);
-                break;
-            case LC3_STR:
-                this->asm_str(cur_line);
-                break;
-            case LC3_TRAP:
-                this->asm_trap(cur_line);
-                break;
-            default:
-                std::ostringstream oss;
-                oss << "Invalid opcode 0x" << std::hex << std::setw(2)
-                    << cur_line.opcode.opcode << " (mnemonic " 
-                    << std::uppercase << cur_line.opcode.mnemonic << ")";
-                this->cur_log_entry.msg = oss.str();
-                this->cur_log_entry.error = true;
-                if(this->verbose)
-                {
-                    std::cout << "[" << __FUNCTION__ << "] " << 
-                        this->cur_log_entry.msg << std::endl;
-                }
+        }
+        c.num_out = as.out - (data + c.slot);
+    });
+
+    // lineSize() should never be short, but if it is the output 
+    // can't be trusted
+    for(AsmChunk& c : chunks)
+    {
+        if(c.as->out_full)
+        {
+            std::cerr << "[" << __FUNCTION__ << "] output of lines " << c.first 
+                << " to " << c.first + c.num_lines - 1 << " did not fit, assembling serially" << std::endl;
+            this->program.resize(base);
+            this->assemble();
+            return;
+        }
+    }
+
+    // Assembly stops at the first error, unless we carry on after
+    // errors, so later chunks don't count
+    last = chunks.size() - 1;
+    if(!this->cont_on_error)
+    {
+        for(unsigned int n = 0; n < chunks.size(); ++n)
+        {
+            if(chunks[n].as->num_err > 0)
+            {
+                last = n;
                 break;
+            }
         }
-LINE_END:
-        this->log.add(this->cur_log_entry);
-        if(this->cur_log_entry.error)
+    }
+    this->num_err = 0;
+    dst = base;
+    for(unsigned int n = 0; n <= last; ++n)
+    {
+        AsmChunk& c = chunks[n];
+        if(dst != c.slot)
+            std::copy(data + c.slot, data + c.slot + c.num_out, data + dst);
+        dst += c.num_out;
+        this->log.append(c.as->log);
+        this->num_err += c.as->num_err;
+        if(c.as->num_err > 0)
         {
-            this->num_err++;
-            std::cerr << this->cur_log_entry.msg << std::endl;
-            if(!this->cont_on_error)
+            for(unsigned int e = 0; e < c.as->log.getNumEntries(); ++e)
+            {
+                AsmLogEntry entry = c.as->log.get(e);
+                if(entry.error)
+                    std::cerr << entry.msg << std::endl;
+            }
+        }
+    }
+    this->program.resize(dst);
+}
+
+/*
+ * addFixup()
+ * Hold a line back until the label it refers to is defined, 
+ * leaving a placeholder for it in the program and in the log
+ */
+void Assembler::addFixup(const LineInfo& line)
+{
+    std::string_view label = this->str_src->getStr(line.symbol);
+    int id = this->pending.getId(label);
+    AsmFixup f;
+
+    if(id == SYM_ID_NONE)
+    {
+        Symbol s;
+        s.addr  = 0;
+        s.label = label;
+        this->pending.add(s);
+        id = this->pending.getNumSyms() - 1;
+        this->pending_first.push_back(-1);
+        this->pending_last.push_back(-1);
+    }
+    f.line      = line;
+    f.instr_idx = this->program.getNumInstr();
+    f.log_idx   = this->log.getNumEntries();
+    f.old_word  = (this->mem != nullptr && line.addr < this->mem_size) ? this->mem[line.addr] : 0x0000;
+    f.next      = -1;
+    f.done      = false;
+    if(this->pending_last[id] < 0)
+        this->pending_first[id] = this->fixups.size();
+    else
+        this->fixups[this->pending_last[id]].next = this->fixups.size();
+    this->pending_last[id] = this->fixups.size();
+    this->fixups.push_back(f);
+
+    this->cur_log_entry.init();
+    this->cur_log_entry.line = line.line_num;
+    this->cur_log_entry.addr = line.addr;
+    this->log.add(this->cur_log_entry);
+    if(this->mem == nullptr)
+        this->program.writeMem(line.addr, 0x0000);
+    else if(line.addr < this->mem_size)
+        this->mem[line.addr] = 0x0000;
+}
+
+/*
+ * patchFixup()
+ * Assemble a line that was held back over its placeholder. If the
+ * line doesn't assemble the placeholder is taken out again. Returns 
+ * false if assembly should stop here.
+ */
+bool Assembler::patchFixup(AsmFixup& f)
+{
+    unsigned int num_instr = this->program.getNumInstr();
+    unsigned int mem_words = this->mem_words;
+    bool ok = this->assembleLine(f.line, f.log_idx);
+
+    if(this->mem != nullptr)
+    {
+        if(this->mem_words == mem_words && f.line.addr < this->mem_size)
+            this->mem[f.line.addr] = f.old_word;
+    }
+    else if(this->program.getNumInstr() > num_instr)
+    {
+        this->program.setInstr(f.instr_idx, this->program.getInstr(num_instr));
+        this->program.popInstr();
+    }
+    else
+        this->dead_instrs.push_back(f.instr_idx);
+    f.done = true;
+
+    return ok;
+}
+
+/*
+ * patchLabel()
+ * A label has just been defined, so patch every line that was 
+ * waiting on it
+ */
+bool Assembler::patchLabel(const Symbol& s)
+{
+    int id = this->pending.getId(s.label);
+
+    if(id == SYM_ID_NONE)
+        return true;
+    for(int32_t idx = this->pending_first[id]; idx >= 0; idx = this->fixups[idx].next)
+    {
+        AsmFixup& f = this->fixups[idx];
+        f.line.imm = s.addr;
+        if(!this->patchFixup(f))
+            return false;
+    }
+    this->pending_first[id] = -1;
+    this->pending_last[id]  = -1;
+
+    return true;
+}
+
+/*
+ * assembleStream()
+ * Assemble lines as they come out of the lexer, in one pass. Labels
+ * that have already been seen are filled in straight away. A line 
+ * that refers forward gets a placeholder in the program, and is 
+ * patched as soon as the lexer defines the label, so only lines 
+ * waiting on a label are held in memory. Strings are read from the
+ * lexer, so the lexer must outlive the assembly.
+ */
+void Assembler::assembleStream(Lexer& lexer)
+{
+    LineInfo cur_line;
+    uint16_t label_addr;
+    unsigned int num_syms;
+
+    this->fixups.clear();
+    this->pending.init();
+    this->pending_first.clear();
+    this->pending_last.clear();
+    lexer.begin();
+    this->str_src = &lexer.getSourceInfo();
+    num_syms = lexer.getSymTable().getNumSyms();
+
+    while(lexer.nextLine(cur_line))
+    {
+        if(cur_line.symbol != STR_ID_EMPTY && !cur_line.is_directive && !cur_line.error &&
+           !lexer.findSymbol(this->str_src->getStr(cur_line.symbol), label_addr))
+        {
+            this->addFixup(cur_line);
+        }
+        else
+        {
+            if(cur_line.symbol != STR_ID_EMPTY && !cur_line.is_directive && !cur_line.error)
+                cur_line.imm = label_addr;
+            if(!this->assembleLine(cur_line))
                 return;
         }
+
+        // Labels defined on this line 
+        const SymbolTable& syms = lexer.getSymTable();
+        for(; num_syms < syms.getNumSyms(); ++num_syms)
+        {
+            if(this->pending.getNumSyms() > 0 && !this->patchLabel(syms.get(num_syms)))
+                return;
+        }
+    }
+
+    // Anything left refers to a label that is never defined, and 
+    // is assembled as the two pass assembler would
+    for(AsmFixup& f : this->fixups)
+    {
+        if(f.done)
+            continue;
+        if(this->verbose)
+            LOG_DEBUG("symbol %s is not defined", this->str_src->getStr(f.line.symbol));
+        if(!this->patchFixup(f))
+            return;
+    }
+}
+
+/*
+ * assemble()
+ * Assemble the output of the lexer in one pass (see assembleStream()),
+ * then close up the placeholders of any lines that failed 
+ */
+void Assembler::assemble(Lexer& lexer)
+{
+    unsigned int dst, dead;
+
+    this->num_err = 0;
+    this->start_addr = 0;
+    this->start_set  = false;
+    this->dead_instrs.clear();
+    this->assembleStream(lexer);
+    if(this->dead_instrs.size() == 0)
+        return;
+
+    std::sort(this->dead_instrs.begin(), this->dead_instrs.end());
+    Instr* data = this->program.getData();
+    dst  = this->dead_instrs[0];
+    dead = 0;
+    for(unsigned int idx = dst; idx < this->program.getNumInstr(); ++idx)
+    {
+        if(dead < this->dead_instrs.size() && this->dead_instrs[dead] == idx)
+        {
+            dead++;
+            continue;
+        }
+        data[dst++] = data[idx];
     }
+    this->program.resize(dst);
+    this->dead_instrs.clear();
+}
+
+/*
+ * assemble()
+ * Assemble lines as they come out of the lexer straight into mem,
+ * skipping the program. A line that refers forward leaves 0 in 
+ * memory until it is patched over, as it does in the program.
+ */
+int Assembler::assemble(Lexer& lexer, uint16_t* mem, const uint32_t mem_size, AsmImage& image)
+{
+    this->mem       = mem;
+    this->mem_size  = mem_size;
+    this->mem_words = 0;
+    this->assemble(lexer);
+    this->mem       = nullptr;
+
+    image.entry     = this->start_addr;
+    image.num_words = this->mem_words;
+    image.sym_table = lexer.getSymTable();
+
+    return (this->num_err > 0) ? -1 : 0;
+}
+
+/*
+ * assemble()
+ * Assemble lines as they come out of the lexer straight into the
+ * memory of machine. Start it with machine.enable(image.entry).
+ */
+int Assembler::assemble(Lexer& lexer, LC3& machine, AsmImage& image)
+{
+    return this->assemble(lexer, machine.getMem(), machine.getMemSize(), image);
+}
+
+/*
+ * getNumFixups()
+ * Number of forward references in the last streamed assembly
+ */
+unsigned int Assembler::getNumFixups(void) const
+{
+    return this->fixups.size();
 }
 
 unsigned int Assembler::getNumErr(void) const
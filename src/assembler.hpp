@@ -11,12 +11,18 @@
 #include <vector>
 #include "source.hpp"
 #include "binary.hpp"
+#include "lexer.hpp"
 
 //TODO : This also needs to move to some machine specific 
 // place for generic (visitor) implementation
 #define LC3_ADR_SIZE 65535
 #define LC3_OFFSET_MAX 255
 
+// Lines in each chunk for assembleParallel()
+#define ASM_CHUNK_LINES 16384
+
+class LC3;
+
 /*
  * AsmLogEntry
  * Logs status of a single line during the assembly process
@@ -52,11 +58,43 @@ class AsmLog
         AsmLog(const AsmLog& that);
         // insert
         void add(const AsmLogEntry& e);
+        void set(const unsigned int idx, const AsmLogEntry& e);
+        void append(const AsmLog& that);
+        unsigned int getNumEntries(void) const;
         AsmLogEntry get(const unsigned int idx) const;
         std::string getString(const unsigned int idx) const;
         std::string getString(void) const;
 };
 
+/*
+ * AsmFixup
+ * A line that refers to a label which had not been seen yet 
+ * when the line came out of the lexer. Fixups waiting on the same
+ * label are chained together in the order they were made.
+ */
+typedef struct
+{
+    LineInfo     line;
+    unsigned int instr_idx;     // placeholder for the line in the program
+    unsigned int log_idx;       // placeholder for the line in the log
+    uint16_t     old_word;      // memory under the placeholder (assembling to memory)
+    int32_t      next;          // next fixup for the same label, or -1
+    bool         done;
+} AsmFixup;
+
+/*
+ * AsmImage
+ * What is left in memory by assembling straight into it. The entry
+ * point is the address of the first .ORIG, or 0 (where the lexer
+ * starts counting addresses) if there isn't one.
+ */
+typedef struct
+{
+    uint16_t     entry;
+    unsigned int num_words;     // words written
+    SymbolTable  sym_table;
+} AsmImage;
+
 /*
  * Asssembler
  *
@@ -67,14 +105,37 @@ class Assembler
     private: 
         bool         verbose;
         bool         cont_on_error;
+        bool         quiet;         // don't print errors (chunks of assembleParallel())
         unsigned int num_err;
 
     private:
         AsmLog      log;
         AsmLogEntry cur_log_entry;
         SourceInfo  src_info;
+        const SourceInfo* str_src;  // strings of the lines being assembled
         Program     program;   // TODO: mem size later
-        uint16_t    start_addr;
+        uint16_t    start_addr;     // first .ORIG
+        bool        start_set;
+        // Forward references. pending holds the labels that have been
+        // referred to but not defined yet, and the id of each label
+        // there indexes the first and last fixup waiting on it.
+        std::vector<AsmFixup> fixups;
+        SymbolTable           pending;
+        std::vector<int32_t>  pending_first;
+        std::vector<int32_t>  pending_last;
+        // Placeholders of lines that failed when they were patched,
+        // which are removed from the program at the end
+        std::vector<unsigned int> dead_instrs;
+        // When set, output is written here rather than added to the 
+        // program (chunks of assembleParallel())
+        Instr*                out;
+        Instr*                out_end;
+        bool                  out_full;
+        // When set, output is written to mem[addr] rather than added
+        // to the program (see assemble(Lexer&, uint16_t*, ...))
+        uint16_t*             mem;
+        uint32_t              mem_size;
+        unsigned int          mem_words;
 
     private:
         // opcode part extractions
@@ -102,6 +163,8 @@ class Assembler
         void asm_sti(const LineInfo& line);
         void asm_str(const LineInfo& line);
         void asm_trap(const LineInfo& line);
+        void asm_none(const LineInfo& line);
+        void asm_invalid(const LineInfo& line);
 
     private:
         // Handle directives / psuedo ops 
@@ -110,11 +173,47 @@ class Assembler
         void dir_orig(const LineInfo& line);
         void dir_stringz(const LineInfo& line);
 
+    private:
+        // Encoder for each line handler (LINE_H_*) 
+        typedef void (Assembler::*AsmHandler)(const LineInfo& line);
+        static const AsmHandler handlers[LINE_H_MAX];
+
+    private:
+        inline void emit(const Instr& i);
+        void memError(const uint16_t adr);
+        void encodeLine(const LineInfo& line);
+        unsigned int lineSize(const LineInfo& line) const;
+        bool assembleLine(const LineInfo& line, const int log_idx = -1);
+        void assembleStream(Lexer& lexer);
+        void addFixup(const LineInfo& line);
+        bool patchFixup(AsmFixup& f);
+        bool patchLabel(const Symbol& s);
+
     public:
+        Assembler();
         Assembler(const SourceInfo& si);
+        Assembler(SourceInfo&& si);
         ~Assembler();
+        Assembler(const Assembler& that) = default;
+        Assembler(Assembler&& that) = default;
+        Assembler& operator=(const Assembler& that) = default;
+        Assembler& operator=(Assembler&& that) = default;
 
         void assemble(void);
+        // Assemble on up to num_threads threads. Lines are split into
+        // chunks which are encoded separately, each straight into its
+        // own part of the program. The result is the same as assemble().
+        void assembleParallel(const unsigned int num_threads,
+                const unsigned int chunk_lines = ASM_CHUNK_LINES);
+        // Assemble lines as the lexer produces them 
+        void assemble(Lexer& lexer);
+        // Assemble lines as the lexer produces them straight into
+        // memory (mem_size words, indexed by address) with nothing 
+        // added to the program. Words the program doesn't cover are
+        // left as they are. Returns -1 if there were errors.
+        int  assemble(Lexer& lexer, uint16_t* mem, const uint32_t mem_size, AsmImage& image);
+        int  assemble(Lexer& lexer, LC3& machine, AsmImage& image);
+        unsigned int getNumFixups(void) const;
         unsigned int getNumErr(void) const;
         Program getProgram(void) const;
         std::vector<Instr> getInstrs(void) const;
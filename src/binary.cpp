@@ -27,11 +27,33 @@ void Program::add(const Instr& i)
     this->instructions.push_back(i);
 }
 
+void Program::setInstr(const unsigned int idx, const Instr& i)
+{
+    if(idx < this->instructions.size())
+        this->instructions[idx] = i;
+}
+
+void Program::popInstr(void)
+{
+    if(this->instructions.size() > 0)
+        this->instructions.pop_back();
+}
+
 unsigned int Program::getNumInstr(void) const
 {
     return this->instructions.size();
 }
 
+void Program::resize(const unsigned int n)
+{
+    this->instructions.resize(n);
+}
+
+Instr* Program::getData(void)
+{
+    return this->instructions.data();
+}
+
 std::vector<Instr> Program::getInstr(void) const
 {
     return this->instructions;
@@ -89,7 +111,7 @@ uint16_t Program::readMem(const unsigned int addr) const
 /*
  * PROGRAM OBJECT BINARY FORMAT
  *
- * Header is just 2 bytes indicating the number of records. Each record
+ * Header is 4 bytes indicating the number of records. Each record
  * requires 4 bytes. First two bytes are address, second two bytes are
  * data for that address.
  *
@@ -102,7 +124,7 @@ uint16_t Program::readMem(const unsigned int addr) const
 int Program::load(const std::string& filename)
 {
     unsigned int idx;
-    uint16_t num_records;
+    uint32_t num_records = 0;
     std::ifstream infile;
 
     // Delete existing data 
@@ -169,11 +191,11 @@ int Program::save(const std::string& filename)
 
     N = (uint32_t) this->instructions.size();
     outfile.write(reinterpret_cast<char*>(&N), sizeof(uint32_t));
-    outfile.write(reinterpret_cast<char*>(
-            &this->instructions[0].adr),
-            sizeof(uint16_t));
     for(unsigned int idx = 0; idx < this->instructions.size(); ++idx)
     {
+        outfile.write(reinterpret_cast<char*>(
+                &this->instructions[idx].adr),
+                sizeof(uint16_t));
         outfile.write(reinterpret_cast<char*>(
                 &this->instructions[idx].ins),
                 sizeof(uint16_t));
@@ -35,9 +35,14 @@ class Program
 
         // Instruction ops 
         void               add(const Instr& i);
+        void               setInstr(const unsigned int idx, const Instr& i);
+        void               popInstr(void);
         std::vector<Instr> getInstr(void) const;
         Instr              getInstr(const unsigned int idx) const;
         unsigned int       getNumInstr(void) const;
+        // In place access, for filling in a block of instructions
+        void               resize(const unsigned int n);
+        Instr*             getData(void);
         void               build(void);
         // Memory ops 
         void               writeMem(const unsigned int addr, const uint16_t val);
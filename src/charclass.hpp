@@ -0,0 +1,89 @@
+/* CHARCLASS
+ * Character classes for the lexer. Every character maps to a set
+ * of class bits through a 256 entry table that is built at compile
+ * time, so classifying a character is a single lookup.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __CHARCLASS_HPP
+#define __CHARCLASS_HPP
+
+#include <cstdint>
+
+// Class bits
+#define LEX_CC_SPACE      0x01      // ' ', '\t', '\r'
+#define LEX_CC_NEWLINE    0x02      // '\n'
+#define LEX_CC_SEPARATOR  0x04      // ',', ':'
+#define LEX_CC_COMMENT    0x08      // ';'
+#define LEX_CC_SYM_START  0x10      // can start a symbol (letters, '_')
+#define LEX_CC_SYM_BODY   0x20      // can be in a symbol (letters, digits, '_')
+#define LEX_CC_DIGIT      0x40      // '0' - '9'
+#define LEX_CC_HEX        0x80      // '0' - '9', 'a' - 'f', 'A' - 'F'
+
+// Common combinations
+#define LEX_CC_WHITESPACE (LEX_CC_SPACE | LEX_CC_NEWLINE)
+// Characters that end a token
+#define LEX_CC_TOKEN_END  (LEX_CC_SPACE | LEX_CC_NEWLINE | LEX_CC_SEPARATOR | LEX_CC_COMMENT)
+
+typedef struct
+{
+    uint8_t cls[256];
+} LexCharTable;
+
+/*
+ * lex_build_char_table()
+ * Work out the class bits for every character
+ */
+constexpr LexCharTable lex_build_char_table(void)
+{
+    LexCharTable t = {};
+
+    for(int c = 0; c < 256; ++c)
+    {
+        uint8_t b = 0;
+        bool upper = (c >= 'A' && c <= 'Z');
+        bool lower = (c >= 'a' && c <= 'z');
+        bool digit = (c >= '0' && c <= '9');
+
+        if(c == ' ' || c == '\t' || c == '\r')
+            b |= LEX_CC_SPACE;
+        if(c == '\n')
+            b |= LEX_CC_NEWLINE;
+        if(c == ',' || c == ':')
+            b |= LEX_CC_SEPARATOR;
+        if(c == ';')
+            b |= LEX_CC_COMMENT;
+        if(upper || lower || c == '_')
+            b |= LEX_CC_SYM_START | LEX_CC_SYM_BODY;
+        if(digit)
+            b |= LEX_CC_SYM_BODY | LEX_CC_DIGIT | LEX_CC_HEX;
+        if((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+            b |= LEX_CC_HEX;
+        t.cls[c] = b;
+    }
+
+    return t;
+}
+
+inline constexpr LexCharTable lex_char_table = lex_build_char_table();
+
+/*
+ * lex_char_class()
+ * Class bits for a character
+ */
+constexpr uint8_t lex_char_class(const char c)
+{
+    return lex_char_table.cls[(uint8_t) c];
+}
+
+/*
+ * lex_char_is()
+ * True if a character is in any of the classes in mask
+ */
+constexpr bool lex_char_is(const char c, const uint8_t mask)
+{
+    return (lex_char_table.cls[(uint8_t) c] & mask) ? true : false;
+}
+
+#endif /*__CHARCLASS_HPP*/
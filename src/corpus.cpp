@@ -0,0 +1,290 @@
+/* CORPUS
+ * Synthetic LC3 assembly
+ *
+ * Stefan Wong 2018
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "corpus.hpp"
+
+// Kinds of line in a segment
+#define CORPUS_INSTR    0
+#define CORPUS_REF      1
+#define CORPUS_FILL     2
+#define CORPUS_BLKW     3
+#define CORPUS_STRINGZ  4
+
+/*
+ * CorpusLine
+ * Plan for one line of a segment
+ */
+typedef struct
+{
+    uint8_t  kind;          // one of the kinds above
+    uint8_t  blkw;          // words reserved by .BLKW
+    bool     is_label;
+    uint32_t addr;          // address of the line (and its label)
+    int32_t  target;        // line a reference goes to, or -1
+} CorpusLine;
+
+void initCorpusParams(CorpusParams& p)
+{
+    p.num_lines       = 1024;
+    p.label_every     = 8;
+    p.ref_percent     = 20;
+    p.fwd_percent     = 50;
+    p.dir_percent     = 10;
+    p.comment_percent = 10;
+    p.seed            = 1;
+}
+
+/*
+ * corpus_hex()
+ * Append a value as 4 hex digits
+ */
+static void corpus_hex(std::string& out, const uint16_t val)
+{
+    const char digits[] = "0123456789ABCDEF";
+
+    for(int shift = 12; shift >= 0; shift -= 4)
+        out += digits[(val >> shift) & 0xF];
+}
+
+/*
+ * corpus_reg()
+ * Append a register name
+ */
+static void corpus_reg(std::string& out, const unsigned int r)
+{
+    out += 'R';
+    out += (char) ('0' + (r & 0x7));
+}
+
+/*
+ * corpus_find_target()
+ * Nearest labelled line to line k in the direction asked for,
+ * as long as it is within reach
+ */
+static int32_t corpus_find_target(const std::vector<CorpusLine>& seg, const unsigned int k, const bool fwd)
+{
+    if(fwd)
+    {
+        for(unsigned int j = k + 1; j < seg.size() && seg[j].addr - seg[k].addr <= CORPUS_REF_RANGE; ++j)
+        {
+            if(seg[j].is_label)
+                return j;
+        }
+    }
+    else
+    {
+        for(int j = (int) k - 1; j >= 0 && seg[k].addr - seg[j].addr <= CORPUS_REF_RANGE; --j)
+        {
+            if(seg[j].is_label)
+                return j;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * genCorpus()
+ */
+std::string genCorpus(const CorpusParams& p, CorpusStats* stats)
+{
+    const char* str_chars = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const char* traps[] = {"HALT", "PUTS", "OUT", "GETC"};
+    const char* brs[]   = {"BRnzp", "BRz", "BRp", "BRn", "BRnz", "BRzp", "BR"};
+    std::mt19937 gen(p.seed);
+    std::vector<CorpusLine> seg;
+    std::string out;
+    CorpusStats st = {};
+    unsigned int remaining = p.num_lines;
+    unsigned int line_idx = 0;          // of the next line in the whole source
+
+    out.reserve((size_t) p.num_lines * 24);
+    seg.reserve(CORPUS_SEG_LINES);
+    // Every segment has a .ORIG line, and there is a .END at the end
+    while(remaining > 1)
+    {
+        unsigned int num_body = std::min((unsigned int) CORPUS_SEG_LINES - 1, remaining - 2);
+        uint32_t addr = CORPUS_ORIG;
+
+        out += "    .ORIG x";
+        corpus_hex(out, CORPUS_ORIG);
+        out += '\n';
+        line_idx++;
+        st.num_segments++;
+
+        // Work out what each line is and where it goes first, so
+        // that references forward know where their label is
+        seg.resize(num_body);
+        for(unsigned int k = 0; k < num_body; ++k)
+        {
+            CorpusLine& l = seg[k];
+            l.is_label = (p.label_every > 0 && (line_idx + k) % p.label_every == 0);
+            l.addr     = addr;
+            l.blkw     = 0;
+            l.target   = -1;
+            if(gen() % 100 < p.dir_percent)
+            {
+                l.kind = CORPUS_FILL + gen() % 3;
+                if(l.kind == CORPUS_BLKW)
+                    l.blkw = 1 + gen() % 4;
+            }
+            else if(gen() % 100 < p.ref_percent)
+                l.kind = CORPUS_REF;
+            else
+                l.kind = CORPUS_INSTR;
+            addr += 1 + l.blkw;
+        }
+        for(unsigned int k = 0; k < num_body; ++k)
+        {
+            CorpusLine& l = seg[k];
+            if(l.kind != CORPUS_REF)
+                continue;
+            bool fwd = (gen() % 100 < p.fwd_percent);
+            l.target = corpus_find_target(seg, k, fwd);
+            if(l.target < 0)
+                l.target = corpus_find_target(seg, k, !fwd);
+            if(l.target < 0)
+                l.kind = CORPUS_INSTR;
+            else
+            {
+                st.num_refs++;
+                if(l.target > (int32_t) k)
+                    st.num_fwd_refs++;
+            }
+        }
+
+        for(unsigned int k = 0; k < num_body; ++k)
+        {
+            const CorpusLine& l = seg[k];
+            uint32_t r = gen();
+
+            if(l.is_label)
+            {
+                out += 'L';
+                out += std::to_string(line_idx + k);
+                out += ' ';
+                st.num_labels++;
+            }
+            else
+                out += "    ";
+            switch(l.kind)
+            {
+                case CORPUS_INSTR:
+                    st.num_instrs++;
+                    switch(r % 16)
+                    {
+                        case 0: case 1: case 2: case 3:
+                            out += "ADD ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            corpus_reg(out, r >> 7);
+                            out += ", ";
+                            corpus_reg(out, r >> 10);
+                            break;
+                        case 4: case 5: case 6:
+                            out += "ADD ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            corpus_reg(out, r >> 7);
+                            out += ", #";
+                            out += std::to_string((int) ((r >> 10) % 32) - 16);
+                            break;
+                        case 7: case 8:
+                            out += "AND ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            corpus_reg(out, r >> 7);
+                            out += ", x";
+                            out += "0123456789ABCDEF"[(r >> 10) & 0xF];
+                            break;
+                        case 9: case 10: case 11:
+                            // The assembler takes the LDR offset as an
+                            // address to be made PC relative, so only
+                            // #0 comes out as written
+                            out += "LDR ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            corpus_reg(out, r >> 7);
+                            out += ", #0";
+                            break;
+                        case 12: case 13: case 14:
+                            out += "STR ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            corpus_reg(out, r >> 7);
+                            out += ", #";
+                            out += std::to_string((int) ((r >> 10) % 64) - 32);
+                            break;
+                        default:
+                            out += traps[(r >> 4) % 4];
+                            break;
+                    }
+                    break;
+
+                case CORPUS_REF:
+                    st.num_instrs++;
+                    switch(r % 3)
+                    {
+                        case 0:
+                            out += brs[(r >> 4) % 7];
+                            out += ' ';
+                            break;
+                        case 1:
+                            out += "LD ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            break;
+                        default:
+                            out += "LEA ";
+                            corpus_reg(out, r >> 4);
+                            out += ", ";
+                            break;
+                    }
+                    out += 'L';
+                    out += std::to_string(line_idx + l.target);
+                    break;
+
+                case CORPUS_FILL:
+                    st.num_directives++;
+                    out += ".FILL x";
+                    corpus_hex(out, r >> 8);
+                    break;
+
+                case CORPUS_BLKW:
+                    st.num_directives++;
+                    out += ".BLKW #";
+                    out += std::to_string(l.blkw);
+                    break;
+
+                case CORPUS_STRINGZ:
+                    st.num_directives++;
+                    out += ".STRINGZ \"";
+                    for(unsigned int n = 0; n < 1 + (r >> 8) % 12; ++n)
+                        out += str_chars[gen() % 53];
+                    out += '"';
+                    break;
+            }
+            if(gen() % 100 < p.comment_percent)
+                out += "    ; comment";
+            out += '\n';
+        }
+        line_idx  += num_body;
+        remaining -= 1 + num_body;
+    }
+    if(remaining > 0)
+    {
+        out += "    .END\n";
+        line_idx++;
+    }
+    st.num_lines = line_idx;
+    if(stats != nullptr)
+        *stats = st;
+
+    return out;
+}
@@ -0,0 +1,65 @@
+/* CORPUS
+ * Synthetic LC3 assembly for testing and benchmarking the lexer and
+ * assembler on sources of any size. The output is valid assembly
+ * (it lexes and assembles without errors) with a chosen number of
+ * lines, labels, label references and directives, and the same
+ * parameters always give the same text.
+ *
+ * The source is split into segments, each starting with its own
+ * .ORIG, so that addresses stay in range however long it gets.
+ * References only go to labels in the same segment that are close
+ * enough for a PC relative offset.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __CORPUS_HPP
+#define __CORPUS_HPP
+
+#include <cstdint>
+#include <string>
+
+#define CORPUS_SEG_LINES   1024     // lines in each .ORIG segment
+#define CORPUS_REF_RANGE   200      // furthest a reference can be from its label
+#define CORPUS_ORIG        0x3000
+
+typedef struct
+{
+    unsigned int num_lines;         // lines in the source, including .ORIG and .END
+    unsigned int label_every;       // a label on one line in this many (0 for none)
+    unsigned int ref_percent;       // instructions that refer to a label (BR, LD, LEA)
+    unsigned int fwd_percent;       // references that are to a label further on
+    unsigned int dir_percent;       // lines that are .FILL, .BLKW or .STRINGZ
+    unsigned int comment_percent;   // lines with a comment after them
+    uint32_t     seed;
+} CorpusParams;
+
+/*
+ * CorpusStats
+ * What went into a generated source
+ */
+typedef struct
+{
+    unsigned int num_lines;
+    unsigned int num_segments;
+    unsigned int num_labels;
+    unsigned int num_refs;
+    unsigned int num_fwd_refs;
+    unsigned int num_directives;
+    unsigned int num_instrs;
+} CorpusStats;
+
+/*
+ * initCorpusParams()
+ * Defaults for a source with a bit of everything
+ */
+void initCorpusParams(CorpusParams& p);
+
+/*
+ * genCorpus()
+ * Generate a source. If stats is given it is filled in with what
+ * was generated.
+ */
+std::string genCorpus(const CorpusParams& p, CorpusStats* stats = nullptr);
+
+#endif /*__CORPUS_HPP*/
@@ -0,0 +1,217 @@
+/* DFA
+ * Table driven scanner for the lexer. Scanning is a deterministic
+ * state machine over a few byte classes, with the transition table
+ * built at compile time from the rules in lex_dfa_spec. Every
+ * character costs a class lookup and a transition lookup, and there
+ * is one loop for all the things the lexer scans over rather than
+ * one for each.
+ *
+ * A scan starts in one of the entry states below and runs until it
+ * reaches LEX_DFA_STOP (the character that stopped it is left as the
+ * current character) or the end of the text. Transitions can mark
+ * where a token starts and ends on the way.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __DFA_HPP
+#define __DFA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "charclass.hpp"
+
+// Byte classes
+#define LEX_DFA_C_OTHER     0
+#define LEX_DFA_C_SPACE     1       // ' ', '\t', '\r'
+#define LEX_DFA_C_NEWLINE   2       // '\n'
+#define LEX_DFA_C_SEP       3       // ',', ':'
+#define LEX_DFA_C_COMMENT   4       // ';'
+#define LEX_DFA_C_QUOTE     5       // '"'
+#define LEX_DFA_C_NUL       6       // '\0'
+#define LEX_DFA_NUM_CLASSES 8
+
+// Sets of classes for the rules
+#define LEX_DFA_M(c)        (1 << (c))
+#define LEX_DFA_ANY         0xFF
+#define LEX_DFA_BLANK_M     (LEX_DFA_M(LEX_DFA_C_SPACE) | LEX_DFA_M(LEX_DFA_C_NEWLINE))
+#define LEX_DFA_LINE_END_M  (LEX_DFA_M(LEX_DFA_C_NEWLINE) | LEX_DFA_M(LEX_DFA_C_NUL))
+
+// States. The lexer starts scans in the ones marked entry.
+#define LEX_DFA_TOKEN        0      // entry: separators, a token, and one separator after it
+#define LEX_DFA_TOKEN_BODY   1
+#define LEX_DFA_TOKEN_SEP    2
+#define LEX_DFA_BLANK        3      // entry: whitespace
+#define LEX_DFA_COMMENT      4      // entry: up to the end of the line
+#define LEX_DFA_LINE         5      // entry: blank and comment lines before a line
+#define LEX_DFA_LINE_COMMENT 6
+#define LEX_DFA_STRING       7      // entry: a quoted string
+#define LEX_DFA_STRING_OPEN  8
+#define LEX_DFA_STRING_BODY  9
+#define LEX_DFA_STRING_CLOSE 10
+#define LEX_DFA_STOP         11
+#define LEX_DFA_NUM_STATES   16
+
+// Marks carried in a transition along with the next state
+#define LEX_DFA_STATE_MASK   0x1F
+#define LEX_DFA_START        0x20   // the token starts at this character
+#define LEX_DFA_END          0x40   // the token ends at this character
+
+/*
+ * LexDfaRule
+ * In state, a character in any of classes moves to next
+ */
+typedef struct
+{
+    uint8_t state;
+    uint8_t classes;        // mask of LEX_DFA_C_*
+    uint8_t next;
+    uint8_t marks;          // LEX_DFA_START and/or LEX_DFA_END
+} LexDfaRule;
+
+/*
+ * lex_dfa_spec
+ * Anything without a rule stops the scan. Later rules take the
+ * place of earlier ones for the classes they name.
+ */
+inline constexpr LexDfaRule lex_dfa_spec[] = {
+    // Token. Whitespace and separators are skipped, then the token
+    // runs up to anything that ends one. A separator right after it
+    // is eaten as well.
+    {LEX_DFA_TOKEN,        LEX_DFA_ANY, LEX_DFA_TOKEN_BODY, LEX_DFA_START},
+    {LEX_DFA_TOKEN,        LEX_DFA_BLANK_M | LEX_DFA_M(LEX_DFA_C_SEP), LEX_DFA_TOKEN, 0},
+    {LEX_DFA_TOKEN,        LEX_DFA_M(LEX_DFA_C_COMMENT) | LEX_DFA_M(LEX_DFA_C_NUL),
+                           LEX_DFA_STOP, LEX_DFA_START | LEX_DFA_END},
+    {LEX_DFA_TOKEN_BODY,   LEX_DFA_ANY, LEX_DFA_TOKEN_BODY, 0},
+    {LEX_DFA_TOKEN_BODY,   LEX_DFA_BLANK_M | LEX_DFA_M(LEX_DFA_C_COMMENT) | LEX_DFA_M(LEX_DFA_C_NUL),
+                           LEX_DFA_STOP, LEX_DFA_END},
+    {LEX_DFA_TOKEN_BODY,   LEX_DFA_M(LEX_DFA_C_SEP), LEX_DFA_TOKEN_SEP, LEX_DFA_END},
+    // Whitespace
+    {LEX_DFA_BLANK,        LEX_DFA_BLANK_M, LEX_DFA_BLANK, 0},
+    // Rest of a line
+    {LEX_DFA_COMMENT,      LEX_DFA_ANY, LEX_DFA_COMMENT, 0},
+    {LEX_DFA_COMMENT,      LEX_DFA_LINE_END_M, LEX_DFA_STOP, 0},
+    // Lead up to a line. A comment runs up to and over the end of
+    // the line it is on.
+    {LEX_DFA_LINE,         LEX_DFA_BLANK_M, LEX_DFA_LINE, 0},
+    {LEX_DFA_LINE,         LEX_DFA_M(LEX_DFA_C_COMMENT), LEX_DFA_LINE_COMMENT, 0},
+    {LEX_DFA_LINE_COMMENT, LEX_DFA_ANY, LEX_DFA_LINE_COMMENT, 0},
+    {LEX_DFA_LINE_COMMENT, LEX_DFA_LINE_END_M, LEX_DFA_LINE, 0},
+    // String. Everything up to the opening quote is passed over,
+    // and the string runs to the closing quote (which is eaten) or
+    // the end of the line.
+    {LEX_DFA_STRING,       LEX_DFA_ANY, LEX_DFA_STRING, 0},
+    {LEX_DFA_STRING,       LEX_DFA_M(LEX_DFA_C_QUOTE) | LEX_DFA_M(LEX_DFA_C_NUL), LEX_DFA_STRING_OPEN, 0},
+    {LEX_DFA_STRING_OPEN,  LEX_DFA_ANY, LEX_DFA_STRING_BODY, LEX_DFA_START},
+    {LEX_DFA_STRING_OPEN,  LEX_DFA_M(LEX_DFA_C_QUOTE), LEX_DFA_STRING_CLOSE, LEX_DFA_START | LEX_DFA_END},
+    {LEX_DFA_STRING_OPEN,  LEX_DFA_LINE_END_M, LEX_DFA_STOP, LEX_DFA_START | LEX_DFA_END},
+    {LEX_DFA_STRING_BODY,  LEX_DFA_ANY, LEX_DFA_STRING_BODY, 0},
+    {LEX_DFA_STRING_BODY,  LEX_DFA_M(LEX_DFA_C_QUOTE), LEX_DFA_STRING_CLOSE, LEX_DFA_END},
+    {LEX_DFA_STRING_BODY,  LEX_DFA_LINE_END_M, LEX_DFA_STOP, LEX_DFA_END},
+};
+
+typedef struct
+{
+    uint8_t cls[256];                                       // byte -> class
+    uint8_t next[LEX_DFA_NUM_STATES][LEX_DFA_NUM_CLASSES];  // state | marks
+} LexDfaTable;
+
+/*
+ * lex_build_dfa_table()
+ * Work out the class of every byte and apply the rules in order
+ */
+constexpr LexDfaTable lex_build_dfa_table(void)
+{
+    LexDfaTable t = {};
+
+    for(int c = 0; c < 256; ++c)
+    {
+        uint8_t cc = lex_char_class((char) c);
+
+        if(cc & LEX_CC_SPACE)
+            t.cls[c] = LEX_DFA_C_SPACE;
+        else if(cc & LEX_CC_NEWLINE)
+            t.cls[c] = LEX_DFA_C_NEWLINE;
+        else if(cc & LEX_CC_SEPARATOR)
+            t.cls[c] = LEX_DFA_C_SEP;
+        else if(cc & LEX_CC_COMMENT)
+            t.cls[c] = LEX_DFA_C_COMMENT;
+        else if(c == '"')
+            t.cls[c] = LEX_DFA_C_QUOTE;
+        else if(c == '\0')
+            t.cls[c] = LEX_DFA_C_NUL;
+        else
+            t.cls[c] = LEX_DFA_C_OTHER;
+    }
+    for(int s = 0; s < LEX_DFA_NUM_STATES; ++s)
+    {
+        for(int c = 0; c < LEX_DFA_NUM_CLASSES; ++c)
+            t.next[s][c] = LEX_DFA_STOP;
+    }
+    for(const LexDfaRule& r : lex_dfa_spec)
+    {
+        for(int c = 0; c < LEX_DFA_NUM_CLASSES; ++c)
+        {
+            if(r.classes & (1 << c))
+                t.next[r.state][c] = r.next | r.marks;
+        }
+    }
+
+    return t;
+}
+
+inline constexpr LexDfaTable lex_dfa_table = lex_build_dfa_table();
+
+/*
+ * LexDfaScan
+ * Result of a scan. A token that was never marked is empty and
+ * sits at the end of the text.
+ */
+typedef struct
+{
+    size_t       pos;           // character the scan stopped on
+    size_t       tok_start;
+    size_t       tok_end;
+    unsigned int lines;         // newlines moved onto (not counting one at the start)
+} LexDfaScan;
+
+/*
+ * lex_dfa_run()
+ * Scan s from pos starting in state. Newlines are counted as they
+ * are landed on, so a newline that the scan starts on has already
+ * been counted.
+ *
+ * Most characters leave the state as it is with no marks (inside a
+ * token, a run of blanks or a comment). Checking for that with a
+ * branch lets the CPU predict the next state and carry on rather than
+ * wait for each lookup to come back, so only a change of state
+ * costs a dependent lookup.
+ */
+constexpr LexDfaScan lex_dfa_run(const std::string_view& s, size_t pos, uint8_t state)
+{
+    LexDfaScan r = {pos, s.size(), s.size(), 0};
+    // The first character is read like any other, so take it back off
+    unsigned int lines = (pos < s.size() && s[pos] == '\n') ? ~0u : 0u;
+
+    for(; pos < s.size(); ++pos)
+    {
+        uint8_t c = lex_dfa_table.cls[(uint8_t) s[pos]];
+        uint8_t e = lex_dfa_table.next[state][c];
+
+        lines += (c == LEX_DFA_C_NEWLINE);
+        if(e == state)
+            continue;
+        r.tok_start = (e & LEX_DFA_START) ? pos : r.tok_start;
+        r.tok_end   = (e & LEX_DFA_END) ? pos : r.tok_end;
+        state = e & LEX_DFA_STATE_MASK;
+        if(state == LEX_DFA_STOP)
+            break;
+    }
+    r.pos   = pos;
+    r.lines = lines;
+
+    return r;
+}
+
+#endif /*__DFA_HPP*/
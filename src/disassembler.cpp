@@ -15,9 +15,6 @@
 Disassembler::Disassembler()
 {
     this->verbose = false;
-    // Build the op table 
-    for(const Opcode &op : lc3_op_list)
-        this->lc3_op_table.add(op);
 }
 
 Disassembler::~Disassembler() {} 
@@ -90,19 +87,21 @@ int Disassembler::disInstr(const Instr& instr)
     }
 
     o.opcode   = this->dis_opcode(instr.ins);
-    o.mnemonic = this->lc3_op_table.getMnemonic(o.opcode);
-    if(o.mnemonic == "OP_UNKNOWN")
+    o.mnemonic = lc3_op_table.getMnemonic(o.opcode);
+    if(o.mnemonic == OPCODE_INVALID_MNEMONIC)
     {
         std::cerr << "[" << __FUNCTION__ << "] cannot find mnemonic for opcode <0x" 
             << o.opcode << ">" << std::endl;
     }
 
-    this->cur_line.opcode = o;
-    this->cur_line.addr   = instr.adr;
+    this->cur_line.opcode   = o.opcode;
+    this->cur_line.mnemonic = this->source.intern(o.mnemonic);
+    this->cur_line.addr     = instr.adr;
     switch(o.opcode)
     {
         case LC3_ADD:
-            this->cur_line.opcode.mnemonic = "ADD";
+            this->cur_line.handler = LINE_H_ADD;
+            this->cur_line.mnemonic = this->source.intern("ADD");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             this->cur_line.arg2 = this->dis_op2(instr.ins);
             this->cur_line.is_imm  = this->is_imm(instr.ins);
@@ -114,7 +113,8 @@ int Disassembler::disInstr(const Instr& instr)
             break;
 
         case LC3_AND:
-            this->cur_line.opcode.mnemonic = "AND";
+            this->cur_line.handler = LINE_H_AND;
+            this->cur_line.mnemonic = this->source.intern("AND");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             this->cur_line.arg2 = this->dis_op2(instr.ins);
             this->cur_line.is_imm  = this->is_imm(instr.ins);
@@ -126,38 +126,46 @@ int Disassembler::disInstr(const Instr& instr)
             break;
 
         case LC3_BR:
-            this->cur_line.opcode.mnemonic = "BR";
+            this->cur_line.handler = LINE_H_BR;
             this->cur_line.flags = this->dis_flags(instr.ins);
             this->cur_line.imm   = this->dis_pc9(instr.ins);
             // Add flags to mnemonic 
-            if(this->cur_line.flags & LC3_FLAG_N)
-                this->cur_line.opcode.mnemonic += "n";
-            if(this->cur_line.flags & LC3_FLAG_Z)
-                this->cur_line.opcode.mnemonic += "z";
-            if(this->cur_line.flags & LC3_FLAG_P)
-                this->cur_line.opcode.mnemonic += "p";
+            {
+                std::string br = "BR";
+                if(this->cur_line.flags & LC3_FLAG_N)
+                    br += "n";
+                if(this->cur_line.flags & LC3_FLAG_Z)
+                    br += "z";
+                if(this->cur_line.flags & LC3_FLAG_P)
+                    br += "p";
+                this->cur_line.mnemonic = this->source.intern(br);
+            }
             break;
 
         case LC3_JSR:
-            this->cur_line.opcode.mnemonic = "JSR";
+            this->cur_line.handler = LINE_H_JSR;
+            this->cur_line.mnemonic = this->source.intern("JSR");
             this->cur_line.imm = this->dis_pc11(instr.ins);
             break;
 
         case LC3_LEA:
-            this->cur_line.opcode.mnemonic = "LEA";
+            this->cur_line.handler = LINE_H_LEA;
+            this->cur_line.mnemonic = this->source.intern("LEA");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             this->cur_line.imm  = this->dis_pc9(instr.ins);
             break;
 
         case LC3_LD:
-            this->cur_line.opcode.mnemonic = "LD";
+            this->cur_line.handler = LINE_H_LD;
+            this->cur_line.mnemonic = this->source.intern("LD");
             this->cur_line.arg1 = this->dis_op1(instr.ins); 
             this->cur_line.imm  = this->dis_pc9(instr.ins);
 
             break;
 
         case LC3_LDR:
-            this->cur_line.opcode.mnemonic = "LDR";
+            this->cur_line.handler = LINE_H_LDR;
+            this->cur_line.mnemonic = this->source.intern("LDR");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             this->cur_line.arg2 = this->dis_op2(instr.ins);
             this->cur_line.imm  = this->dis_of6(instr.ins);
@@ -165,7 +173,8 @@ int Disassembler::disInstr(const Instr& instr)
             break;
 
         case LC3_NOT:
-            this->cur_line.opcode.mnemonic = "NOT";
+            this->cur_line.handler = LINE_H_INVALID;
+            this->cur_line.mnemonic = this->source.intern("NOT");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             this->cur_line.arg2 = this->dis_op2(instr.ins);
             this->cur_line.imm  = this->dis_of6(instr.ins);
@@ -173,15 +182,18 @@ int Disassembler::disInstr(const Instr& instr)
             break;
 
         case LC3_STR:
-            this->cur_line.opcode.mnemonic = "STR";
+            this->cur_line.handler = LINE_H_STR;
+            this->cur_line.mnemonic = this->source.intern("STR");
             this->cur_line.arg1 = this->dis_op1(instr.ins);
             break;
 
         case LC3_TRAP:
+            this->cur_line.handler = LINE_H_TRAP;
             this->cur_line.imm = this->dis_trap8(instr.ins);
             break;
 
         default:
+            this->cur_line.handler = LINE_H_NONE;
             std::cout << "[" << __FUNCTION__ << "] (line " << 
                 std::dec << this->cur_line.line_num << ") invalid opcode $" <<
                 std::uppercase << std::hex << std::setw(2) << 
@@ -225,7 +237,7 @@ void Disassembler::disassemble(void)
         this->source.add(this->cur_line);
         this->line_ptr++;
         // Stop if we just disassembled the HALT instruction
-        if(this->cur_line.opcode.mnemonic == "TRAP")
+        if(this->source.getStr(this->cur_line.mnemonic) == "TRAP")
         {
             if(this->cur_line.imm == 0x37)
             {
@@ -274,9 +286,9 @@ std::string Disassembler::line_to_asm(const LineInfo& l)
     std::ostringstream oss;
 
     if(l.is_label)
-        oss << l.label << ":";
-    oss << "\t " << l.opcode.mnemonic;
-    switch(l.opcode.opcode)
+        oss << this->source.getStr(l.label) << ":";
+    oss << "\t " << this->source.getStr(l.mnemonic);
+    switch(l.opcode)
     {
         case LC3_ADD:
         case LC3_AND:
@@ -29,10 +29,6 @@ class Disassembler
         LineInfo     cur_line;
         unsigned int line_ptr;
 
-    private:
-        // Tables for mnemonic lookup
-        OpcodeTable lc3_op_table;
-
     private:
         // instruction disassembly
         inline uint8_t  dis_opcode(const uint16_t instr) const;
@@ -0,0 +1,217 @@
+/* KEYWORD
+ * Keyword (mnemonic, trap psuedo-op and assembler directive) lookup.
+ * The keywords are hashed into a small table with a perfect hash 
+ * that is found at compile time, so classifying a token is one hash,
+ * one table read and one compare, with no allocation. Lookup ignores
+ * case.
+ *
+ * The keyword list is built at compile time from lc3_op_list, 
+ * lc3_psuedo_op_list and LEX_ASM_DIRECTIVE_OPCODES, so a new opcode
+ * only has to be added to its own list.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __KEYWORD_HPP
+#define __KEYWORD_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include "lc3.hpp"
+#include "lexer.hpp"
+
+// Keyword kinds
+#define LEX_KW_OP        0      // machine instruction
+#define LEX_KW_TRAP      1      // TRAP psuedo-op
+#define LEX_KW_DIR       2      // assembler directive
+
+#define LEX_KW_NONE      -1     // id for tokens that aren't keywords
+#define LEX_KW_MAX_LEN   8      // longest keyword (.STRINGZ)
+#define LEX_KW_HASH_SIZE 64     // must be a power of 2
+
+typedef struct
+{
+    std::string_view name;
+    uint8_t          kind;
+    uint16_t         opcode;
+    uint8_t          handler;   // LINE_H_* for lines with this keyword
+} LexKeyword;
+
+#define LEX_NUM_OPS  (sizeof(lc3_op_list) / sizeof(lc3_op_list[0]))
+#define LEX_NUM_TRAP (sizeof(lc3_psuedo_op_list) / sizeof(lc3_psuedo_op_list[0]))
+#define LEX_NUM_DIR  (sizeof(LEX_ASM_DIRECTIVE_OPCODES) / sizeof(LEX_ASM_DIRECTIVE_OPCODES[0]))
+// Every opcode and directive apart from .INVALID
+#define LEX_NUM_KEYWORDS (LEX_NUM_OPS + LEX_NUM_TRAP + LEX_NUM_DIR - 1)
+
+typedef struct
+{
+    LexKeyword kw[LEX_NUM_KEYWORDS];
+    size_t     num_kw;      // keywords actually filled in
+    size_t     max_len;     // longest keyword
+} LexKeywordList;
+
+/*
+ * lex_kw_handler()
+ * Line handler for a keyword of the given kind and opcode
+ */
+constexpr uint8_t lex_kw_handler(const uint8_t kind, const uint16_t opcode)
+{
+    if(kind == LEX_KW_TRAP)
+        return LINE_H_TRAP;
+    if(kind == LEX_KW_DIR)
+    {
+        switch(opcode)
+        {
+            case ASM_BLKW:    return LINE_H_BLKW;
+            case ASM_END:     return LINE_H_NONE;
+            case ASM_FILL:    return LINE_H_FILL;
+            case ASM_ORIG:    return LINE_H_ORIG;
+            case ASM_STRINGZ: return LINE_H_STRINGZ;
+        }
+        return LINE_H_INVALID;
+    }
+    switch(opcode)
+    {
+        case LC3_ADD:  return LINE_H_ADD;
+        case LC3_AND:  return LINE_H_AND;
+        case LC3_LD:   return LINE_H_LD;
+        case LC3_LDR:  return LINE_H_LDR;
+        case LC3_LEA:  return LINE_H_LEA;
+        case LC3_STR:  return LINE_H_STR;
+        case LC3_JSR:  return LINE_H_JSR;
+        case LC3_BR:   return LINE_H_BR;       // and all of its variants
+        case LC3_TRAP: return LINE_H_TRAP;
+    }
+    return LINE_H_INVALID;
+}
+
+/*
+ * lex_build_keyword_list()
+ * Instructions, then TRAP psuedo-ops, then directives
+ */
+constexpr LexKeywordList lex_build_keyword_list(void)
+{
+    LexKeywordList l = {};
+
+    for(const Opcode& o : lc3_op_list)
+        l.kw[l.num_kw++] = {o.mnemonic, LEX_KW_OP, o.opcode, lex_kw_handler(LEX_KW_OP, o.opcode)};
+    for(const Opcode& o : lc3_psuedo_op_list)
+        l.kw[l.num_kw++] = {o.mnemonic, LEX_KW_TRAP, o.opcode, lex_kw_handler(LEX_KW_TRAP, o.opcode)};
+    for(const Opcode& o : LEX_ASM_DIRECTIVE_OPCODES)
+    {
+        if(o.opcode == ASM_INVALID)
+            continue;
+        l.kw[l.num_kw++] = {o.mnemonic, LEX_KW_DIR, o.opcode, lex_kw_handler(LEX_KW_DIR, o.opcode)};
+    }
+    for(size_t k = 0; k < l.num_kw; ++k)
+        l.max_len = std::max(l.max_len, l.kw[k].name.size());
+
+    return l;
+}
+
+// The id of a keyword is its position in this list
+inline constexpr LexKeywordList lex_keyword_list = lex_build_keyword_list();
+static_assert(lex_keyword_list.num_kw == LEX_NUM_KEYWORDS, "keyword list not filled");
+static_assert(lex_keyword_list.max_len <= LEX_KW_MAX_LEN, "LEX_KW_MAX_LEN is too small");
+
+typedef struct
+{
+    uint32_t seed;
+    int8_t   slot[LEX_KW_HASH_SIZE];    // keyword id, or LEX_KW_NONE
+} LexKeywordHash;
+
+constexpr char lex_kw_upper(const char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char) (c - 'a' + 'A') : c;
+}
+
+/*
+ * lex_kw_hash()
+ * FNV-1a over the upper case characters, mixed with a seed
+ */
+constexpr uint32_t lex_kw_hash(const char* s, const size_t len, const uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+
+    for(size_t i = 0; i < len; ++i)
+        h = (h ^ (uint8_t) lex_kw_upper(s[i])) * 16777619u;
+
+    return h ^ (h >> 16);
+}
+
+/*
+ * lex_build_keyword_hash()
+ * Try seeds until every keyword lands in its own slot. A seed
+ * of zero means no seed was found.
+ */
+constexpr LexKeywordHash lex_build_keyword_hash(void)
+{
+    LexKeywordHash t = {};
+
+    for(uint32_t seed = 1; seed < 100000; ++seed)
+    {
+        bool ok = true;
+        for(int s = 0; s < LEX_KW_HASH_SIZE; ++s)
+            t.slot[s] = LEX_KW_NONE;
+        for(size_t k = 0; k < LEX_NUM_KEYWORDS; ++k)
+        {
+            std::string_view name = lex_keyword_list.kw[k].name;
+            uint32_t s = lex_kw_hash(name.data(), name.size(), seed) & (LEX_KW_HASH_SIZE - 1);
+            if(t.slot[s] != LEX_KW_NONE)
+            {
+                ok = false;
+                break;
+            }
+            t.slot[s] = (int8_t) k;
+        }
+        if(ok)
+        {
+            t.seed = seed;
+            return t;
+        }
+    }
+    t.seed = 0;
+
+    return t;
+}
+
+inline constexpr LexKeywordHash lex_keyword_hash = lex_build_keyword_hash();
+static_assert(lex_keyword_hash.seed != 0, "no perfect hash for keyword list");
+
+/*
+ * lex_keyword_find()
+ * Id of the keyword matching tok (ignoring case), or LEX_KW_NONE
+ */
+constexpr int lex_keyword_find(const std::string_view& tok)
+{
+    if(tok.size() == 0 || tok.size() > LEX_KW_MAX_LEN)
+        return LEX_KW_NONE;
+
+    uint32_t s = lex_kw_hash(tok.data(), tok.size(), lex_keyword_hash.seed) & (LEX_KW_HASH_SIZE - 1);
+    int id = lex_keyword_hash.slot[s];
+    if(id == LEX_KW_NONE)
+        return LEX_KW_NONE;
+
+    std::string_view name = lex_keyword_list.kw[id].name;
+    if(name.size() != tok.size())
+        return LEX_KW_NONE;
+    for(size_t i = 0; i < tok.size(); ++i)
+    {
+        if(lex_kw_upper(tok[i]) != lex_kw_upper(name[i]))
+            return LEX_KW_NONE;
+    }
+
+    return id;
+}
+
+/*
+ * lex_keyword()
+ * Keyword with a given id (which must be valid)
+ */
+constexpr const LexKeyword& lex_keyword(const int id)
+{
+    return lex_keyword_list.kw[id];
+}
+
+#endif /*__KEYWORD_HPP*/
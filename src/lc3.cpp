@@ -5,10 +5,12 @@
  */
 
 #include <iostream>
+#include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include "lc3.hpp"
+#include "log.hpp"
 
 /*
  * LC3Proc
@@ -41,6 +43,11 @@ LC3Proc::LC3Proc(const LC3Proc& that)
     this->mdr   = that.mdr;
     this->ir    = that.ir;
     this->flags = that.flags;
+    this->sr1   = that.sr1;
+    this->sr2   = that.sr2;
+    this->imm   = that.imm;
+    this->dst   = that.dst;
+    this->cur_opcode = that.cur_opcode;
 }
 
 void LC3Proc::diff(const LC3Proc& that)
@@ -144,32 +151,110 @@ std::string LC3Proc::toString(void) const
     return oss.str();
 }
 
+/*
+ * LC3Stats
+ * Statistics collected over calls to LC3::run()
+ */
+LC3Stats::LC3Stats()
+{
+    this->init();
+}
+
+LC3Stats::~LC3Stats() {} 
+
+void LC3Stats::init(void)
+{
+    this->instr_retired = 0;
+    for(int op = 0; op < LC3_NUM_OPCODES; ++op)
+        this->opcode_count[op] = 0;
+    this->traps       = 0;
+    this->mem_reads   = 0;
+    this->mem_writes  = 0;
+    this->mmio_reads  = 0;
+    this->mmio_writes = 0;
+    this->wall_time   = 0.0;
+    this->perf.init();
+}
+
+/*
+ * mips()
+ * Millions of instructions retired per second of host time 
+ * spent in run(). 
+ */
+double LC3Stats::mips(void) const
+{
+    if(this->wall_time <= 0.0)
+        return 0.0;
+    return ((double) this->instr_retired / this->wall_time) / 1e6;
+}
+
+std::string LC3Stats::toString(void) const
+{
+    // Names for the opcode count breakdown
+    static const char* op_names[LC3_NUM_OPCODES] = {
+        "BR",  "ADD", "LD",  "ST",  "JSR", "AND", "LDR", "STR",
+        "RTI", "NOT", "LDI", "STI", "JMP", "RES", "LEA", "TRAP"
+    };
+    std::ostringstream oss;
+
+    oss << "Instructions retired : " << std::dec << this->instr_retired << std::endl;
+    for(int op = 0; op < LC3_NUM_OPCODES; ++op)
+    {
+        if(this->opcode_count[op] == 0)
+            continue;
+        oss << "    " << std::left << std::setw(5) << std::setfill(' ') 
+            << op_names[op] << std::right << ": " << this->opcode_count[op] << std::endl;
+    }
+    oss << "Traps taken          : " << this->traps << std::endl;
+    oss << "Memory reads         : " << this->mem_reads 
+        << " (" << this->mmio_reads << " MMIO)" << std::endl;
+    oss << "Memory writes        : " << this->mem_writes 
+        << " (" << this->mmio_writes << " MMIO)" << std::endl;
+    oss << "Wall time            : " << std::fixed << std::setprecision(6) 
+        << this->wall_time << " s" << std::endl;
+    oss << "MIPS                 : " << std::setprecision(3) << this->mips() << std::endl;
+    if(this->perf.anyValid())
+        oss << this->perf.toString(this->instr_retired);
+
+    return oss.str();
+}
+
 /*
  * LC3 
  * Constructor for and LC3 object
  */
 LC3::LC3() : proc_trace(LC3_TRACE_SIZE)
 {
+    this->verbose    = false;
     this->save_trace = false;
+    this->perf       = nullptr;
+    this->stop_adr     = 0;
+    this->resume_break = false;
     this->mem_size = LC3_MEM_SIZE;
     this->allocMem();
     this->resetMem();
-    this->build_op_table();
     this->init_machine();
 }
 // Dtor
 LC3::~LC3()
 {
     delete[] this->mem;
+    delete this->perf;
 }
 // Copy Ctor 
 LC3::LC3(const LC3& that) : proc_trace(LC3_TRACE_SIZE)
 {
+    this->verbose    = that.verbose;
+    this->save_trace = false;
+    this->perf       = nullptr;     // host counters are per-object
+    this->breakpoints  = that.breakpoints;
+    this->watch_read   = that.watch_read;
+    this->watch_write  = that.watch_write;
+    this->stop_adr     = that.stop_adr;
+    this->resume_break = that.resume_break;
     this->mem_size = that.mem_size;
     this->allocMem();
     this->state = that.state;
-    this->op_table = that.op_table;
-    this->psuedo_op_table = that.psuedo_op_table;
 }
 
 void LC3::init_machine(void)
@@ -192,20 +277,6 @@ void LC3::init_machine(void)
        this->state.gpr[i] = 0;
 }
 
-/*
- * build_op_table()
- * Construct the internal opcode table.
- */
-void LC3::build_op_table(void)
-{
-    // Build table of real ops
-    for(const Opcode &op : lc3_op_list)
-        this->op_table.add(op);
-    // Build table of psuedo ops 
-    for(const Opcode &op : lc3_psuedo_op_list)
-        this->psuedo_op_table.add(op);
-}
-
 void LC3::allocMem(void)
 {
     this->mem = new uint16_t[this->mem_size];
@@ -328,6 +399,30 @@ uint16_t LC3::readMem(const uint16_t adr) const
     return this->mem[adr % this->mem_size];
 }
 
+/*
+ * mem_read()
+ * Read data memory on behalf of the current instruction
+ */
+inline uint16_t LC3::mem_read(const uint16_t adr)
+{
+    this->stats.mem_reads++;
+    if(adr >= LC3_MMIO_BASE)
+        this->stats.mmio_reads++;
+    return this->mem[adr];
+}
+
+/*
+ * mem_write()
+ * Write data memory on behalf of the current instruction
+ */
+inline void LC3::mem_write(const uint16_t adr, const uint16_t val)
+{
+    this->stats.mem_writes++;
+    if(adr >= LC3_MMIO_BASE)
+        this->stats.mmio_writes++;
+    this->mem[adr] = val;
+}
+
 int LC3::loadMemFile(const std::string& filename, int offset)
 {
     int status = 0;
@@ -359,6 +454,16 @@ void LC3::loadMemProgram(const Program& p)
         this->mem[instr_vec[i].adr] = instr_vec[i].ins;
 }
 
+/*
+ * getMem()
+ * The memory itself, getMemSize() words indexed by address, so that
+ * a program can be assembled straight into it (see Assembler)
+ */
+uint16_t* LC3::getMem(void)
+{
+    return this->mem;
+}
+
 std::vector<uint16_t> LC3::dumpMem(void) const
 {
     std::vector<uint16_t> mem_dump(this->mem_size);
@@ -406,7 +511,7 @@ std::vector<Instr> LC3::dumpMem(const unsigned int n, const unsigned int offset)
 void LC3::fetch(void)
 {
     if(this->verbose)
-        std::cout << "[" << __FUNCTION__ << "] FETCHing next instruction" << std::endl; 
+        LOG_DEBUG("FETCHing next instruction");
 
     this->state.mar = this->state.pc;   // this complicates things now
     this->state.pc++;
@@ -587,13 +692,14 @@ void LC3::execute(void)
             break;
 
         case LC3_TRAP:
-            this->state.mdr = this->mem[this->state.mar];
+            this->state.mdr = this->mem_read(this->state.mar);
             this->state.gpr[7] = this->state.pc;
             this->state.pc = this->state.mdr;
             // TODO : just clear clken here for now,
             // later when the OS routines are implemented we can 
             // update this to work correctly
-            this->mem[LC3_MCR] = 0x0000;
+            this->mem_write(LC3_MCR, 0x0000);
+            this->stats.traps++;
             break;
 
         default:
@@ -644,27 +750,27 @@ void LC3::store(void)
             break;
 
         case LC3_LD:
-            this->state.gpr[this->state.dst] = this->mem[(this->state.pc + 1) + this->state.imm];
+            this->state.gpr[this->state.dst] = this->mem_read(this->state.mar);
             break;
 
         case LC3_LDI:
-            this->state.gpr[this->state.dst] = this->mem[this->state.mar];
+            this->state.gpr[this->state.dst] = this->mem_read(this->state.mar);
             break;
 
         case LC3_LDR:
-            this->state.gpr[this->state.dst] = this->mem[this->state.sr1 + this->state.imm];
+            this->state.gpr[this->state.dst] = this->mem_read(this->state.mar);
             break;
 
         case LC3_ST:
-            this->mem[this->state.imm] = this->state.gpr[this->state.sr1];
+            this->mem_write(this->state.mar, this->state.gpr[this->state.sr1]);
             break;
 
         case LC3_STI:
-            this->mem[this->state.mar] = this->state.gpr[this->state.sr1];
+            this->mem_write(this->state.mar, this->state.gpr[this->state.sr1]);
             break;
 
         case LC3_STR:
-            this->mem[this->state.mar] = this->state.gpr[this->state.sr1];
+            this->mem_write(this->state.mar, this->state.gpr[this->state.sr1]);
             break;
 
         default:
@@ -691,19 +797,152 @@ int LC3::cycle(void)
 
     if(this->save_trace)
         this->proc_trace.add(this->state);
+    this->stats.instr_retired++;
+    this->stats.opcode_count[this->state.cur_opcode]++;
 
     return status;
 }
 
+/*
+ * run()
+ * Execute instructions until the machine halts or max_cycles 
+ * instructions have been executed. If host counters are enabled 
+ * they are sampled around the whole run. If any breakpoints or 
+ * watchpoints are set the run goes through run_debug() instead.
+ * Returns the reason that the run stopped.
+ */
+int LC3::run(const unsigned int max_cycles)
+{
+    int stop = LC3_STOP_CYCLES;
+    auto t_start = std::chrono::steady_clock::now();
+    bool debug = (this->breakpoints.numSet() > 0) ||
+                 (this->watch_read.numSet() > 0)  ||
+                 (this->watch_write.numSet() > 0);
+
+    if(this->perf != nullptr)
+        this->perf->start();
+    if(debug)
+        stop = this->run_debug(max_cycles);
+    else
+    {
+        for(unsigned int c = 0; c < max_cycles; ++c)
+        {
+            if(this->cycle() != 0)
+            {
+                stop = LC3_STOP_HALT;
+                break;
+            }
+        }
+    }
+    if(this->perf != nullptr)
+    {
+        this->perf->stop();
+        this->stats.perf.accumulate(this->perf->read());
+    }
+    this->stats.wall_time += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t_start).count();
+
+    return stop;
+}
+
+/*
+ * mem_access()
+ * Data memory accessed by the instruction that just retired 
+ * (LC3_ACCESS_*), and the addresses it read and wrote. This has to
+ * match the calls to mem_read() and mem_write() in execute() and 
+ * store(), which leave the address they access in MAR.
+ */
+uint8_t LC3::mem_access(uint16_t& rd_adr, uint16_t& wr_adr) const
+{
+    switch(this->state.cur_opcode)
+    {
+        case LC3_LD:
+        case LC3_LDI:
+        case LC3_LDR:
+            rd_adr = this->state.mar;
+            return LC3_ACCESS_RD;
+
+        case LC3_ST:
+        case LC3_STI:
+        case LC3_STR:
+            wr_adr = this->state.mar;
+            return LC3_ACCESS_WR;
+
+        case LC3_TRAP:
+            // reads the vector table, then clears the clock enable
+            rd_adr = this->state.mar;
+            wr_adr = LC3_MCR;
+            return LC3_ACCESS_RD | LC3_ACCESS_WR;
+
+        default:
+            return 0;
+    }
+}
+
+/*
+ * run_debug()
+ * Run loop used when breakpoints or watchpoints are set. A 
+ * breakpoint stops the machine before the instruction at that 
+ * address executes. A watchpoint stops the machine after the 
+ * instruction that accessed the watched address has retired. 
+ * Running again after stopping at a breakpoint executes the 
+ * instruction at the breakpoint.
+ */
+int LC3::run_debug(const unsigned int max_cycles)
+{
+    bool skip_break = this->resume_break && (this->state.pc == this->stop_adr);
+    uint16_t rd_adr = 0;
+    uint16_t wr_adr = 0;
+    uint8_t access;
+
+    this->resume_break = false;
+    for(unsigned int c = 0; c < max_cycles; ++c)
+    {
+        if(this->breakpoints.test(this->state.pc) && !(c == 0 && skip_break))
+        {
+            this->stop_adr     = this->state.pc;
+            this->resume_break = true;
+            return LC3_STOP_BREAK;
+        }
+        if(this->cycle() != 0)
+            return LC3_STOP_HALT;
+
+        access = this->mem_access(rd_adr, wr_adr);
+        if(access == 0)
+            continue;
+        if((access & LC3_ACCESS_RD) && this->watch_read.test(rd_adr))
+        {
+            this->stop_adr = rd_adr;
+            return LC3_STOP_WATCH_RD;
+        }
+        if((access & LC3_ACCESS_WR) && this->watch_write.test(wr_adr))
+        {
+            this->stop_adr = wr_adr;
+            return LC3_STOP_WATCH_WR;
+        }
+    }
+
+    return LC3_STOP_CYCLES;
+}
+
 /*
  * enable()
  * Set the clock enable bit
  */
 void LC3::enable(void)
 {
-    this->mem[LC3_MCR] |= 0x8000;
     // TODO: when the OS is setup load the start address properly
-    this->state.pc = 0x3000;
+    this->enable(0x3000);
+}
+
+/*
+ * enable()
+ * Set the clock enable bit and start from start_adr
+ */
+void LC3::enable(const uint16_t start_adr)
+{
+    this->mem[LC3_MCR] |= 0x8000;
+    this->state.pc = start_adr;
 }
 
 /*
@@ -745,11 +984,11 @@ bool LC3::getNeg(void) const
 
 /*
  * getOpTable()
- * Dump a copy of the opcode table for this machine
+ * The opcode table for this machine
  */
-OpcodeTable LC3::getOpTable(void) const
+const OpcodeTable& LC3::getOpTable(void) const
 {
-    return this->op_table;
+    return lc3_op_table;
 }
 
 // Verbose 
@@ -779,3 +1018,109 @@ MTrace <LC3Proc> LC3::getMachineTrace(void) const
 {
     return this->proc_trace;
 }
+
+// Breakpoints and watchpoints
+void LC3::setBreakpoint(const uint16_t adr)
+{
+    this->breakpoints.set(adr);
+}
+
+void LC3::clearBreakpoint(const uint16_t adr)
+{
+    this->breakpoints.clear(adr);
+}
+
+bool LC3::isBreakpoint(const uint16_t adr) const
+{
+    return this->breakpoints.test(adr);
+}
+
+void LC3::setWatchRead(const uint16_t adr)
+{
+    this->watch_read.set(adr);
+}
+
+void LC3::clearWatchRead(const uint16_t adr)
+{
+    this->watch_read.clear(adr);
+}
+
+void LC3::setWatchWrite(const uint16_t adr)
+{
+    this->watch_write.set(adr);
+}
+
+void LC3::clearWatchWrite(const uint16_t adr)
+{
+    this->watch_write.clear(adr);
+}
+
+/*
+ * clearDebug()
+ * Remove all breakpoints and watchpoints
+ */
+void LC3::clearDebug(void)
+{
+    this->breakpoints.clearAll();
+    this->watch_read.clearAll();
+    this->watch_write.clearAll();
+    this->resume_break = false;
+}
+
+/*
+ * getStopAddr()
+ * The breakpoint or watched address that caused the last run() 
+ * to stop.
+ */
+uint16_t LC3::getStopAddr(void) const
+{
+    return this->stop_adr;
+}
+
+// Statistics 
+LC3Stats LC3::getStats(void) const
+{
+    return this->stats;
+}
+
+/*
+ * resetStats()
+ * Clear all statistics (host counters stay enabled if they were)
+ */
+void LC3::resetStats(void)
+{
+    this->stats.init();
+}
+
+/*
+ * setPerf()
+ * Enable or disable host hardware counters around run(). Returns
+ * false if counters were requested but none could be opened on 
+ * this host.
+ */
+bool LC3::setPerf(const bool v)
+{
+    if(!v)
+    {
+        delete this->perf;
+        this->perf = nullptr;
+        return true;
+    }
+    if(this->perf == nullptr)
+        this->perf = new PerfCounters();
+    if(!this->perf->isAvailable())
+    {
+        if(this->verbose)
+            std::cerr << "[" << __FUNCTION__ << "] no host counters available" << std::endl;
+        delete this->perf;
+        this->perf = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool LC3::getPerf(void) const
+{
+    return (this->perf != nullptr) ? true : false;
+}
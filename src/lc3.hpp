@@ -12,6 +12,7 @@
 #include "machine.hpp"
 #include "opcode.hpp"
 #include "binary.hpp"
+#include "perf.hpp"
 
 // OPCODE CONSTANTS 
 #define LC3_ADD     0x01
@@ -71,13 +72,27 @@
 
 // Memory 
 #define LC3_MEM_SIZE 65535
+#define LC3_MMIO_BASE 0xFE00    // device registers live above here
+// Number of distinct opcodes (the top 4 bits of an instruction)
+#define LC3_NUM_OPCODES 16
 // Machine trace size 
 #define LC3_TRACE_SIZE 256
 
+// Reasons for run() to return
+#define LC3_STOP_CYCLES  0     // executed max_cycles instructions
+#define LC3_STOP_HALT    1     // clock enable was cleared
+#define LC3_STOP_BREAK   2     // PC reached a breakpoint
+#define LC3_STOP_WATCH_RD 3    // an instruction read a watched address
+#define LC3_STOP_WATCH_WR 4    // an instruction wrote a watched address
+
+// Data memory accesses made by an instruction
+#define LC3_ACCESS_RD 0x1
+#define LC3_ACCESS_WR 0x2
+
 // TODO : until the assembler/machine interface is complete,
 // generate the op and psuedo op table for use with the lexer.
 // Clean up this interface once the lexer internals are complete
-const Opcode lc3_op_list[] = {
+inline constexpr Opcode lc3_op_list[] = {
     {LC3_ADD,     "ADD"},
     {LC3_AND,     "AND"},
     {LC3_LD,      "LD"},
@@ -106,7 +121,7 @@ const Opcode lc3_op_list[] = {
 };
 
 // Psuedo ops
-const Opcode lc3_psuedo_op_list[] = {
+inline constexpr Opcode lc3_psuedo_op_list[] = {
     {LC3_GETC,  "GETC"},
     {LC3_OUT,   "OUT"},
     {LC3_PUTS,  "PUTS"},
@@ -115,6 +130,11 @@ const Opcode lc3_psuedo_op_list[] = {
     {LC3_HALT,  "HALT"}
 };
 
+// Tables built from the lists above at compile time, shared by
+// everything that needs to look up an opcode
+inline constexpr OpcodeTable lc3_op_table(lc3_op_list);
+inline constexpr OpcodeTable lc3_psuedo_op_table(lc3_psuedo_op_list);
+
 // LC3 CPU State
 class LC3Proc
 {
@@ -169,6 +189,35 @@ class LC3Proc
 };
 
 
+/*
+ * LC3Stats
+ * Statistics collected over calls to LC3::run()
+ */
+class LC3Stats
+{
+    public:
+        uint64_t   instr_retired;
+        uint64_t   opcode_count[LC3_NUM_OPCODES];
+        uint64_t   traps;
+        // Data memory accesses made by instructions (instruction
+        // fetches are not included, there is one per instr_retired)
+        uint64_t   mem_reads;
+        uint64_t   mem_writes;
+        // The part of mem_reads/mem_writes that hit device registers
+        uint64_t   mmio_reads;
+        uint64_t   mmio_writes;
+        double     wall_time;       // host seconds spent inside run()
+        PerfSample perf;            // host counters (if enabled)
+
+    public:
+        LC3Stats();
+        ~LC3Stats();
+        void        init(void);
+        double      mips(void) const;
+        std::string toString(void) const;
+};
+
+
 //class LC3 : public Machine
 //FIXME I've broken the inheritance link for the moment
 //until I get the architecture sorted
@@ -186,14 +235,27 @@ class LC3
         void      init_machine(void);
         // Processor
         LC3Proc     state;
-        OpcodeTable op_table;
-        OpcodeTable psuedo_op_table;
 
     private:
         // Machine trace
         MTrace <LC3Proc> proc_trace;
         bool             save_trace;
 
+    private:
+        // Statistics
+        LC3Stats      stats;
+        PerfCounters* perf;         // NULL unless host counters enabled
+
+    private:
+        // Breakpoints and watchpoints. These are only looked at 
+        // when at least one is set.
+        AddrBitmap breakpoints;
+        AddrBitmap watch_read;
+        AddrBitmap watch_write;
+        uint16_t   stop_adr;        // address that caused the last stop
+        bool       resume_break;    // last run stopped at a breakpoint
+        int        run_debug(const unsigned int max_cycles);
+
     private:
         // Instruction decode helper functions 
         inline uint8_t  instr_get_opcode(const uint16_t instr) const;
@@ -210,9 +272,11 @@ class LC3
         inline uint16_t instr_get_trap8(const uint16_t instr) const;
         // Set flags 
         inline void     set_flags(const uint8_t val);
-        // Build opcode table 
-        void            build_op_table(void);
-        
+        // Data memory access from the instruction cycle
+        inline uint16_t mem_read(const uint16_t adr);
+        inline void     mem_write(const uint16_t adr, const uint16_t val);
+        uint8_t         mem_access(uint16_t& rd_adr, uint16_t& wr_adr) const;
+
     private:
         // Sign extension
         inline uint16_t sext5(const uint8_t v) const;
@@ -237,7 +301,9 @@ class LC3
         // Reset CPU state 
         void     resetCPU(void);
         void     enable(void);
+        void     enable(const uint16_t start_adr);
         int      cycle(void);        // run the next instruction
+        int      run(const unsigned int max_cycles);
         void     halt(void);
         // Memory 
         void     resetMem(void);
@@ -245,6 +311,7 @@ class LC3
         uint16_t readMem(const uint16_t adr) const;
         int      loadMemFile(const std::string& filename, int offset);
         void     loadMemProgram(const Program& p);
+        uint16_t* getMem(void);      // for loading a program in place
         std::vector<uint16_t> dumpMem(void) const;
         std::vector<Instr>    dumpMem(const unsigned int n, const unsigned int offset);
 
@@ -257,7 +324,7 @@ class LC3
         bool     getNeg(void) const;
 
         // Opcode Table (public interface)
-        OpcodeTable getOpTable(void) const; //get complete table
+        const OpcodeTable& getOpTable(void) const; //get complete table
 
         // Verbose 
         void     setVerbose(const bool v);
@@ -268,6 +335,23 @@ class LC3
         bool     getTrace(void) const;
         MTrace <LC3Proc> getMachineTrace(void) const;
 
+        // Breakpoints and watchpoints
+        void     setBreakpoint(const uint16_t adr);
+        void     clearBreakpoint(const uint16_t adr);
+        bool     isBreakpoint(const uint16_t adr) const;
+        void     setWatchRead(const uint16_t adr);
+        void     clearWatchRead(const uint16_t adr);
+        void     setWatchWrite(const uint16_t adr);
+        void     clearWatchWrite(const uint16_t adr);
+        void     clearDebug(void);
+        uint16_t getStopAddr(void) const;
+
+        // Statistics 
+        LC3Stats getStats(void) const;
+        void     resetStats(void);
+        bool     setPerf(const bool v);
+        bool     getPerf(void) const;
+
 };
 
 #endif /*__LC3_HPP*/
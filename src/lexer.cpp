@@ -5,13 +5,21 @@
  * Stefan Wong 2018
  */
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <thread>
 #include <cstdlib>  // for std::atoi()
-#include <cctype>   // for std::toupper, std::isalnum
 #include <cstring>  // for strncmp()
 #include "lexer.hpp"
+#include "charclass.hpp"
+#include "keyword.hpp"
+#include "literal.hpp"
+#include "scan.hpp"
+#include "log.hpp"
 // TODO : I think I need to make an abstract Lexer class and then
 // derive an LC3 class to make this 'generic'
 #include "lc3.hpp"
@@ -23,41 +31,34 @@ Lexer::Lexer(const OpcodeTable& ot)
 {
     this->op_table = ot;
     this->initVars();
-    this->allocMem();
 }
 
 Lexer::Lexer(const OpcodeTable& ot, const std::string& filename)
 {
-    this->loadFile(filename);
     this->op_table = ot;
     this->initVars();
-    this->allocMem();
-}
-
-Lexer::~Lexer()
-{
-    delete[] this->token_buf;
+    this->loadFile(filename);
 }
 
-void Lexer::allocMem(void)
-{
-    this->token_buf = new char[this->token_buf_size];
-    this->token_buf[0] = '\0';
-}
+Lexer::~Lexer() {} 
 
 void Lexer::initVars(void)
 {
     this->verbose        = false;
     this->cur_pos        = 0;
-    this->token_buf_size = LEX_TOKEN_MAX_LEN;
+    this->cur_char       = '\0';
     this->cur_line       = 0;
-
-    // TODO : Note that this is using the 'global' vars
-    // which is not great. Will need to be refactored
-    for(const Opcode &op : lc3_psuedo_op_list)
-        this->psuedo_op_table.add(op);
-    for(const Opcode &op : LEX_ASM_DIRECTIVE_OPCODES)
-        this->asm_dir_table.add(op);
+    this->token_kw       = LEX_KW_NONE;
+    this->stream_end     = false;
+    this->quiet          = false;
+    this->cont_on_error  = false;
+    this->core           = LEX_CORE_SCAN;
+    this->num_out        = 0;
+    this->relexing       = false;
+    this->shift_from     = 0;
+    this->shift_line     = 0;
+    this->shift_pos      = 0;
+    this->shift_sym      = 0;
 }
 
 /*
@@ -69,21 +70,32 @@ void Lexer::initVars(void)
  */
 void Lexer::advance(void)
 {
-    this->cur_pos++;
-    this->cur_char = this->src[this->cur_pos];
-    if(this->cur_pos >= this->src.size())
-        this->cur_char = '\0';
+    if(this->cur_pos < this->src.size())
+        this->cur_pos++;
+    this->cur_char = (this->cur_pos < this->src.size()) ? 
+        this->src[this->cur_pos] : '\0';
     if(this->cur_char == '\n')
     {
         this->cur_line = this->cur_line + 1;
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] advanced to line "
-                << std::dec << this->cur_line << std::endl;
+            LOG_DEBUG("advanced to line %u", this->cur_line);
         }
     }
 }
 
+/*
+ * jumpTo()
+ * Move the character pointer straight to pos. Line counting is 
+ * up to the caller.
+ */
+void Lexer::jumpTo(const unsigned int pos)
+{
+    this->cur_pos  = (pos < this->src.size()) ? pos : this->src.size();
+    this->cur_char = (this->cur_pos < this->src.size()) ? 
+        this->src[this->cur_pos] : '\0';
+}
+
 /*
  * exhausted()
  * Returns true when there is no more input to lex
@@ -100,68 +112,74 @@ bool Lexer::exhausted(void) const
  */
 void Lexer::skipWhitespace(void) 
 {
-    while(!this->exhausted())
+    if(this->core == LEX_CORE_DFA)
     {
-        if(this->cur_char == ' '  || 
-           this->cur_char == '\n' || 
-           this->cur_char == '\t')
-            this->advance();
-        else
-            break;
+        this->dfaScan(LEX_DFA_BLANK);
+        return;
     }
+    if(!lex_char_is(this->cur_char, LEX_CC_WHITESPACE))
+        return;
+    this->jumpTo(lex_scan_blank(this->src.data(), this->cur_pos + 1,
+                this->src.size(), false, this->cur_line));
 }
 
+/*
+ * skipComment()
+ * Eat everything up to (but not including) the end of the line
+ */
 void Lexer::skipComment(void)
 {
-    while(this->cur_char != '\n')
-        this->advance();
+    if(this->core == LEX_CORE_DFA)
+    {
+        this->dfaScan(LEX_DFA_COMMENT);
+        return;
+    }
+    if(this->cur_char == '\n' || this->exhausted())
+        return;
+    this->jumpTo(lex_scan_line_end(this->src.data(), this->cur_pos, 
+                this->src.size()));
+    // advance() counts a line when it lands on a newline
+    if(this->cur_char == '\n')
+        this->cur_line++;
 }
 
+/*
+ * skipSeperators()
+ * Eat any mix of whitespace and seperator characters
+ */
 void Lexer::skipSeperators(void)
 {
-    while(!this->exhausted())
-    {
-        if(this->cur_char == ',' ||
-           this->cur_char == ':' ||
-           this->cur_char == ';')
-            this->advance();
-        else
-            break;
-    }
+    if(!lex_char_is(this->cur_char, LEX_CC_WHITESPACE | LEX_CC_SEPARATOR))
+        return;
+    this->jumpTo(lex_scan_blank(this->src.data(), this->cur_pos + 1,
+                this->src.size(), true, this->cur_line));
 }
 
 bool Lexer::isSymbol(void) const
 {
-    return (isalnum(toupper(this->cur_char)));
+    return lex_char_is(this->cur_char, LEX_CC_SYM_BODY);
 }
 bool Lexer::isNumber(void) const
 {
-    return (isdigit(toupper(this->cur_char)));
+    return lex_char_is(this->cur_char, LEX_CC_DIGIT);
 }
 bool Lexer::isDirective(void) const 
 {
-    return (this->cur_char == '.' || this->token_buf[0] == '.');
+    return (this->cur_char == '.' || this->tokenChar(0) == '.');
 }
 bool Lexer::isSpace(void)
 {
-    return (this->cur_char == ' '  || 
-            this->cur_char == '\t' ||
-            this->cur_char == '\n') ? true : false;
+    return lex_char_is(this->cur_char, LEX_CC_WHITESPACE);
 }
 bool Lexer::isComment(void)
 {
-    return (this->cur_char == ';');
+    return lex_char_is(this->cur_char, LEX_CC_COMMENT);
 }
 
-// TODO: need to deal with case (removing case) here 
 bool Lexer::isMnemonic(void)
 {
-    if(this->token_buf[0] == '\0')
-        return false;
-    Opcode op;
-    this->op_table.get(std::string(this->token_buf), op);
-
-    return (op.mnemonic != "M_INVALID") ? true : false;
+    return (this->token_kw != LEX_KW_NONE && 
+            lex_keyword(this->token_kw).kind == LEX_KW_OP) ? true : false;
 }
 /*
  * isTrapOp
@@ -170,12 +188,8 @@ bool Lexer::isMnemonic(void)
  */
 bool Lexer::isTrapOp(void)
 {
-    if(this->token_buf[0] == '\0')
-        return false;
-    Opcode op;
-    this->psuedo_op_table.get(std::string(this->token_buf), op);
-
-    return (op.mnemonic != "M_INVALID") ? true : false;
+    return (this->token_kw != LEX_KW_NONE && 
+            lex_keyword(this->token_kw).kind == LEX_KW_TRAP) ? true : false;
 }
 
 /*
@@ -185,54 +199,115 @@ bool Lexer::isTrapOp(void)
  */
 bool Lexer::isValidArg(void)
 {
-    return (this->token_buf[0] == 'r' ||
-            this->token_buf[0] == 'R' || 
-            this->token_buf[0] == '#' ||
-            this->token_buf[0] == 'x' ||
-            this->token_buf[0] == 'X') ? true : false;
+    char c = this->tokenChar(0);
+
+    return (c == 'r' ||
+            c == 'R' || 
+            c == '#' ||
+            c == 'x' ||
+            c == 'X') ? true : false;
+}
+
+/*
+ * tokenChar()
+ * Character idx of the current token, or '\0' past the end
+ */
+char Lexer::tokenChar(const unsigned int idx) const
+{
+    return (idx < this->token.size()) ? this->token[idx] : '\0';
+}
+
+/*
+ * setLineError()
+ * Flag an error on the current line. The message is only 
+ * formatted if someone asks for it.
+ */
+void Lexer::setLineError(const uint8_t code, const std::string_view& arg)
+{
+    this->line_info.error    = true;
+    this->line_info.err_code = code;
+    this->line_info.err_arg  = this->source_info.intern(arg);
+    if(this->verbose)
+        LOG_DEBUG("%s", this->source_info.getErrStr(this->line_info));
+}
+
+/*
+ * addError()
+ * Note the error on the line that nextLine() is about to return
+ */
+void Lexer::addError(void)
+{
+    LexError err;
+    size_t nl = this->src.rfind('\n', this->line_span.start);
+
+    err.line_idx = this->num_out;
+    err.line_num = this->line_info.line_num;
+    err.col      = (nl == std::string_view::npos) ? this->line_span.start + 1 : this->line_span.start - nl;
+    err.err_code = this->line_info.err_code;
+    this->errors.push_back(err);
+}
+
+/*
+ * dfaScan()
+ * Run the state machine from the current character, starting in 
+ * state, and move to wherever it stopped
+ */
+LexDfaScan Lexer::dfaScan(const uint8_t state)
+{
+    LexDfaScan r = lex_dfa_run(this->src, this->cur_pos, state);
+
+    this->cur_line += r.lines;
+    this->jumpTo(r.pos);
+
+    return r;
 }
 
 void Lexer::skipLine(void)
 {
-    while(this->cur_char != '\n')
-        this->advance();
+    this->skipComment();
     // skip ahead over newline
     this->advance();
 }
 
 /*
  * scanToken()
- * Scan a complete token into the token buffer
+ * Scan a complete token. The token is a slice of the source text.
  */
 void Lexer::scanToken(void)
 {
-    unsigned int idx = 0;
-    this->skipWhitespace();     // eat any leading whitespace 
-    this->skipSeperators();     // eat any seperators that might be left
-    while(idx < (this->token_buf_size-1))
+    unsigned int start, end;
+
+    if(this->core == LEX_CORE_DFA)
     {
-        if(this->cur_char == ' ')       // end 
-            break;
-        if(this->cur_char == '\n')      // newline
-            break;
-        if(this->cur_char == ';')       // comment
-            break;
-        if(this->cur_char == ',')       // seperator
-            break;
-        this->token_buf[idx] = this->cur_char;
-        this->advance();
-        idx++;
+        LexDfaScan r = this->dfaScan(LEX_DFA_TOKEN);
+        this->token = this->src.substr(r.tok_start, r.tok_end - r.tok_start);
+        goto TOKEN_END;
     }
-    this->token_buf[idx] = '\0';
+    // eat any leading whitespace or seperators that might be left
+    this->skipSeperators();
+    // A token can't contain a newline, so there is no line 
+    // counting to do and we can move straight to the end of it
+    start = this->cur_pos;
+    end   = start;
+    while(end < this->src.size() && 
+          !lex_char_is(this->src[end], LEX_CC_TOKEN_END) &&
+          this->src[end] != '\0')
+        end++;
+    this->cur_pos  = end;
+    this->cur_char = (end < this->src.size()) ? this->src[end] : '\0';
+    this->token    = this->src.substr(start, end - start);
+    // advance() counts a line when it lands on a newline
+    if(end > start && this->cur_char == '\n')
+        this->cur_line++;
     // If we are on a seperator now, advance the source pointer 
-    if(this->cur_char == ',')
+    if(lex_char_is(this->cur_char, LEX_CC_SEPARATOR))
         this->advance();
 
+TOKEN_END:
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (line " << std::dec << 
-            this->cur_line << ") : token_buf contains <" << 
-            std::string(this->token_buf) << "> " << std::endl;
+        LOG_DEBUG("(line %u) : token contains <%s> ", this->cur_line,
+                this->token);
     }
 }
 
@@ -242,28 +317,69 @@ void Lexer::scanToken(void)
  */
 void Lexer::scanString(void)
 {
-    unsigned int idx = 0;
+    unsigned int start;
 
-    // Find the first quote character
-    while(idx < (this->token_buf_size-1))
+    if(this->core == LEX_CORE_DFA)
     {
-        if(this->cur_char == '"')
-            break;
-        this->advance();
-        idx++;
+        LexDfaScan r = this->dfaScan(LEX_DFA_STRING);
+        this->token = this->src.substr(r.tok_start, r.tok_end - r.tok_start);
+        return;
     }
-    idx = 0;
+    // Find the first quote character
+    while(!this->exhausted() && this->cur_char != '"')
+        this->advance();
     this->advance();        // move past the quote character
-    while(idx < (this->token_buf_size-1))
-    {
-        // Break on the last quote character
-        if(this->cur_char == '"')
-            break;
-        this->token_buf[idx] = this->cur_char;
+    start = this->cur_pos;
+    // Stop on the closing quote (or the end of the line if 
+    // the string isn't terminated)
+    while(!this->exhausted() && this->cur_char != '"' && this->cur_char != '\n')
         this->advance();
-        idx++;
+    this->token = this->src.substr(start, this->cur_pos - start);
+    if(this->cur_char == '"')
+        this->advance();  // ensure the quote char is not the current char 
+}
+
+/*
+ * parseReg()
+ * Register number from the current token (eg R3). Returns false 
+ * if the token isn't one.
+ */
+bool Lexer::parseReg(uint16_t& reg)
+{
+    if(!this->isValidArg())
+        return false;
+    LexLiteral lit = lex_parse_digits(this->token, 1, 10);
+    if(lit.status != LEX_LIT_OK)
+        return false;
+    reg = (uint16_t) lit.value;
+
+    return true;
+}
+
+/*
+ * parseImm()
+ * Parse the current token as a literal into imm, checking that it
+ * fits in a field of bits. If it doesn't, the line error says why
+ * and false is returned.
+ */
+bool Lexer::parseImm(const unsigned int bits)
+{
+    LexLiteral lit = lex_parse_literal(this->token);
+
+    if(lit.status == LEX_LIT_EMPTY || lit.status == LEX_LIT_DIGIT)
+    {
+        this->setLineError(LINE_ERR_LITERAL, this->token);
+        return false;
+    }
+    if(lit.status == LEX_LIT_OVERFLOW || !lex_lit_fits(lit.value, bits))
+    {
+        this->line_info.err_num = bits;
+        this->setLineError(LINE_ERR_RANGE, this->token);
+        return false;
     }
-    this->advance();  // ensure the quote char is not the current char 
+    this->line_info.imm = (uint16_t) lit.value;
+
+    return true;
 }
 
 /*
@@ -274,58 +390,51 @@ void Lexer::parseOpcode3Args(void)
 {
     int err_argnum = 0;
     bool arg_err = false;
-    std::string arg;
+
     // Get arg1
     this->scanToken();
-    if(!this->isValidArg())
+    if(!this->parseReg(this->line_info.arg1))
     {
         err_argnum = 1;
         arg_err = true;
         goto ARG_ERR;
     }
-    arg = std::string(this->token_buf);
-    this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
 
     // Get source 1
     this->scanToken();
-    if(!this->isValidArg())
+    if(!this->parseReg(this->line_info.arg2))
     {
         err_argnum = 2;
         arg_err = true;
         goto ARG_ERR;
     }
-    arg = std::string(this->token_buf);
-    this->line_info.arg2 = std::stoi(arg.substr(1, arg.length()));
 
-    // Get source 2
+    // Get source 2, which is a register or an imm5 literal
     this->scanToken();
-    if(!this->isValidArg())
+    if(this->tokenChar(0) == 'r' || this->tokenChar(0) == 'R')
     {
-        err_argnum = 3;
-        arg_err = true;
-        goto ARG_ERR;
+        if(!this->parseReg(this->line_info.arg3))
+        {
+            err_argnum = 3;
+            arg_err = true;
+        }
     }
-    arg = std::string(this->token_buf);
-    if(arg[0] == '#')
+    else if(lex_is_literal(this->token))
     {
-        this->line_info.imm = std::stoi(arg.substr(1, arg.length()));
-        this->line_info.is_imm = true;
+        if(this->parseImm(LEX_LIT_IMM5))
+            this->line_info.is_imm = true;
     }
     else
-        this->line_info.arg3 = std::stoi(arg.substr(1, arg.length()));
+    {
+        err_argnum = 3;
+        arg_err = true;
+    }
 
 ARG_ERR:
     if(arg_err)
     {
-        if(this->verbose)
-        {
-            std::cout << "[" << __FUNCTION__ << "] (line " <<
-                std::dec << this->cur_line << ") error parsing arg " <<
-                err_argnum << " of " << this->line_info.opcode.mnemonic << 
-                " opcode" << std::endl;
-        }
-        this->line_info.error = true;
-        this->line_info.errstr = "Argument " + std::to_string(err_argnum) + " of opcode " + this->line_info.opcode.mnemonic + " invalid";
+        this->line_info.err_num = err_argnum;
+        this->setLineError(LINE_ERR_ARG, "");
     }
 }
 
@@ -335,25 +444,21 @@ ARG_ERR:
  */
 void Lexer::parseOpcode(void)
 {
-    Opcode o;
-    this->op_table.get(std::string(this->token_buf), o);
-    this->line_info.opcode = o;
-    if(o.mnemonic == "M_INVALID")
+    if(!this->isMnemonic())
     {
-        this->line_info.error = true;
-        this->line_info.errstr = "Invalid opcode <" + std::string(this->token_buf) + ">";
-        if(this->verbose)
-        {
-            std::cout << "[" << __FUNCTION__ << "] " << this->line_info.errstr << std::endl;
-        }
+        this->line_info.opcode = 0;
+        this->setLineError(LINE_ERR_OPCODE, this->token);
         return;
     }
+    const LexKeyword& o = lex_keyword(this->token_kw);
+    std::string_view mnemonic = o.name;
+    this->line_info.opcode   = o.opcode;
+    this->line_info.handler  = o.handler;
+    this->line_info.mnemonic = this->source_info.intern(mnemonic);
 
     if(this->verbose)
-        std::cout << "[" << __FUNCTION__ << "] decoding <" 
-            << o.mnemonic << ">" << std::endl;
+        LOG_DEBUG("decoding <%s>", mnemonic);
     
-    std::string arg;
     switch(o.opcode)
     {
         case LC3_ADD:
@@ -368,77 +473,63 @@ void Lexer::parseOpcode(void)
 
         case LC3_BR:
             // Check what (if any) flags are in opcode
-            if(this->line_info.opcode.mnemonic.length() > 2)
+            if(mnemonic.length() > 2)
             {
                 unsigned int num_flags;
-                num_flags = this->line_info.opcode.mnemonic.length() - 2;
+                num_flags = mnemonic.length() - 2;
                 if(this->verbose)
                 {
-                    std::cout << "[" << __FUNCTION__ << "] BR has " << 
-                        num_flags << " flag arguments" << std::endl;
+                    LOG_DEBUG("BR has %d flag arguments", num_flags);
                 }
 
                 for(unsigned int f = 0; f < num_flags; f++)
                 {
-                    if(this->line_info.opcode.mnemonic[f + 2] == 'p')
+                    if(mnemonic[f + 2] == 'p')
                         this->line_info.flags |= LC3_FLAG_P;
-                    if(this->line_info.opcode.mnemonic[f + 2] == 'n')
+                    if(mnemonic[f + 2] == 'n')
                         this->line_info.flags |= LC3_FLAG_N;
-                    if(this->line_info.opcode.mnemonic[f + 2] == 'z')
+                    if(mnemonic[f + 2] == 'z')
                         this->line_info.flags |= LC3_FLAG_Z;
                 }
                 if(this->verbose)
                 {
                     if(this->line_info.flags & LC3_FLAG_N)
-                        std::cout << "Set N flag" << std::endl;
+                        LOG_DEBUG("Set N flag");
                     if(this->line_info.flags & LC3_FLAG_Z)
-                        std::cout << "Set Z flag" << std::endl;
+                        LOG_DEBUG("Set Z flag");
                     if(this->line_info.flags & LC3_FLAG_P)
-                        std::cout << "Set P flag" << std::endl;
+                        LOG_DEBUG("Set P flag");
                 }
             }
+            // A literal here is an address, the assembler works out
+            // (and range checks) the offset to it
             this->scanToken();
-            if(this->isValidArg())      // assume literal
-            {
-                arg = std::string(this->token_buf);
-                if(this->token_buf[0] == 'x' || this->token_buf[0] == 'X')
-                    this->line_info.imm = std::stoi("0" + std::string(this->token_buf));
-                else
-                    this->line_info.imm = std::stoi(std::string(this->token_buf));
-            }
+            if(lex_is_literal(this->token))
+                this->parseImm(LEX_LIT_WORD);
             else        // assume label symbol
-                this->line_info.symbol = std::string(this->token_buf);
+                this->line_info.symbol = this->source_info.intern(this->token);
 
             break;
 
         case LC3_JMP_RET:
             // Decide if this is JMP or RET
-            if(o.mnemonic == "JMP")
+            if(mnemonic == "JMP")
             {
                 this->scanToken();
-                if(!this->isValidArg())
+                if(!this->parseReg(this->line_info.arg2))
                 {
-                    this->line_info.error = true;
-                    this->line_info.errstr = "Failed to parse JMP argument <" + std::string(this->token_buf) + ">";
+                    this->setLineError(LINE_ERR_PARSE_ARG, this->token);
                     break;
                 }
-                arg = std::string(this->token_buf);
-                this->line_info.arg2 = std::stoi(arg.substr(1, arg.length()));
             }
-            else if(o.mnemonic == "RET")
+            else if(mnemonic == "RET")
             {
                 this->line_info.arg1 = 0x0;
                 this->line_info.arg2 = 0x3;
             }
             else
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Invalid jump opcode " + o.mnemonic;
-                if(this->verbose)
-                {
-                    std::cout << "[" << __FUNCTION__ << 
-                        "] " << this->line_info.errstr << std::endl;
-                }
+                this->setLineError(LINE_ERR_JUMP, "");
             }
             break;
 
@@ -446,109 +537,68 @@ void Lexer::parseOpcode(void)
             this->scanToken();
             if(!this->isValidArg())
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse JSR immediate <" + std::string(this->token_buf) + ">";
+                this->setLineError(LINE_ERR_JSR_IMM, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            if(o.mnemonic == "JSR")
+            if(mnemonic == "JSR")
             {
                 this->line_info.arg1 = 0x4;
-                this->line_info.imm = std::stoi(arg.substr(1, arg.length()));
+                this->parseImm(LEX_LIT_PC11);
             }
-            else if(o.mnemonic == "JSRR")
+            else if(mnemonic == "JSRR")
             {
                 this->line_info.arg1 = 0x0;
-                this->line_info.arg2 = std::stoi(arg.substr(1,arg.length()));
-            }
-            else
-            {
-                this->line_info.error = true;
-                this->line_info.errstr = "Invalid jump opcode " + o.mnemonic; 
-                if(this->verbose)
-                {
-                    std::cout << "[" << __FUNCTION__ << 
-                        "] " << this->line_info.errstr << std::endl;
-                }
-            }
-            break;
-
-        case LC3_LEA:
-            this->scanToken();
-            if(!this->isValidArg())
-            {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse LEA argument <" + std::string(this->token_buf) + ">";
-                break;
-            }
-            arg = std::string(this->token_buf);
-            this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
-            // Next could be a symbol
-            if(this->isNumber())
-            {
-                this->scanToken();
-                this->line_info.imm = std::stoi(std::string(this->token_buf));
+                if(!this->parseReg(this->line_info.arg2))
+                    this->setLineError(LINE_ERR_JSR_IMM, this->token);
             }
             else
             {
-                this->scanToken();
-                this->line_info.symbol = std::string(this->token_buf);
+                this->setLineError(LINE_ERR_JUMP, "");
             }
-
             break;
 
         // These have a similar offset structure 
+        case LC3_LEA:
         case LC3_LD:
         case LC3_LDI:
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg1))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse LD argument <" + std::string(this->token_buf) + ">"; 
+                this->setLineError(LINE_ERR_PARSE_ARG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
-            // Next could be a symbol
+            // Next could be a symbol, or an address 
             this->scanToken();
-            if(this->isNumber())
-                this->line_info.imm = std::stoi(std::string(this->token_buf));
+            if(lex_is_literal(this->token))
+                this->parseImm(LEX_LIT_WORD);
             else
-                this->line_info.symbol = std::string(this->token_buf);
+                this->line_info.symbol = this->source_info.intern(this->token);
             break;
 
         case LC3_LDR:
             // Get arg1 register 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg1))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse LDR argument <" + std::string(this->token_buf) + "> (destination register)";
+                this->setLineError(LINE_ERR_DST_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
             // Get base register 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg2))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse LDR argument <" + std::string(this->token_buf) + "> (base register)";
+                this->setLineError(LINE_ERR_BASE_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg2 = std::stoi(arg.substr(1, arg.length()));
 
             // Get offset6, which must be a literal
             this->scanToken();
-            if(!this->isValidArg())
+            if(!lex_is_literal(this->token))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse LDR argument <" + std::string(this->token_buf) + "> (offset6)"; 
+                this->setLineError(LINE_ERR_OFFSET6, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.imm = std::stoi(arg.substr(1, arg.length()));
+            this->parseImm(LEX_LIT_OF6);
             this->line_info.is_imm = true;      // redundant?
             
             break;
@@ -556,24 +606,18 @@ void Lexer::parseOpcode(void)
         case LC3_NOT:
             // Get dest 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg1))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse NOT argument <" + std::string(this->token_buf) + "> (destination register)"; 
+                this->setLineError(LINE_ERR_DST_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
             // Get dst 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg2))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse NOT argument <" + std::string(this->token_buf) + "> (source register)"; 
+                this->setLineError(LINE_ERR_SRC_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg2 = std::stoi(arg.substr(1, arg.length()));
             break;
 
         // These have a similar opcode structure 
@@ -581,35 +625,27 @@ void Lexer::parseOpcode(void)
         case LC3_STR:
             // Get src register 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg1))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse ST argument <" + std::string(this->token_buf) + "> (source register)"; 
+                this->setLineError(LINE_ERR_SRC_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg1 = std::stoi(arg.substr(1, arg.length()));
             // Get base register 
             this->scanToken();
-            if(!this->isValidArg())
+            if(!this->parseReg(this->line_info.arg2))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse ST argument <" + std::string(this->token_buf) + "> (base register)"; 
+                this->setLineError(LINE_ERR_BASE_REG, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.arg2 = std::stoi(arg.substr(1, arg.length()));
 
             // Get offset6, which must be a literal
             this->scanToken();
-            if(!this->isValidArg())
+            if(!lex_is_literal(this->token))
             {
-                this->line_info.error = true;
-                this->line_info.errstr = "Failed to parse ST argument <" + std::string(this->token_buf) + "> (offset6)"; 
+                this->setLineError(LINE_ERR_OFFSET6, this->token);
                 break;
             }
-            arg = std::string(this->token_buf);
-            this->line_info.imm = std::stoi(arg.substr(1, arg.length()));
+            this->parseImm(LEX_LIT_OF6);
             this->line_info.is_imm = true;      // redundant?
 
             break;
@@ -627,37 +663,27 @@ void Lexer::parseOpcode(void)
  */
 void Lexer::parseTrapOpcode(void)
 {
-    Opcode o;
-
     this->line_info.is_directive    = false;
-    this->line_info.opcode.mnemonic = "TRAP";
-    this->line_info.opcode.opcode   = LC3_TRAP;
+    this->line_info.mnemonic = this->source_info.intern("TRAP");
+    this->line_info.opcode   = LC3_TRAP;
+    this->line_info.handler  = LINE_H_TRAP;
 
-    std::string tok = std::string(this->token_buf);
-    this->psuedo_op_table.get(std::string(this->token_buf), o);
-    if(o.mnemonic == "M_INVALID")
+    if(!this->isTrapOp())
     {
-        this->line_info.error = true;
-        this->line_info.errstr = "Not a valid TRAP psuedo-op <" + std::string(this->token_buf) + ">";
-        if(this->verbose)
-        {
-            std::cout << "[" << __FUNCTION__ << "] " <<
-                this->line_info.errstr << std::endl;
-        }
+        this->setLineError(LINE_ERR_TRAP, this->token);
         return;
     }
 
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (line " << std::dec << 
-            this->cur_line << ") parsing TRAP opcode <0x" 
-            << std::hex << this->line_info.opcode.opcode << "> " << std::endl;
+        LOG_DEBUG("(line %u) parsing TRAP opcode <0x%x> ", this->cur_line,
+                this->line_info.opcode);
     }
 
     // TODO : These are also 'hardcoded' for now. We want to 
     // eventually move them out so that some kind of LC3 specific
     // assembler can be specialized out of generic parts
-    switch(o.opcode)
+    switch(lex_keyword(this->token_kw).opcode)
     {
         case LC3_GETC:
             this->line_info.imm = 0x20;
@@ -678,14 +704,7 @@ void Lexer::parseTrapOpcode(void)
             this->line_info.imm = 0x25;
             break;
         default:
-            this->line_info.error = true;
-            this->line_info.errstr = "No implementation for opcode <" 
-                + tok;
-            if(this->verbose)
-            {
-                std::cout << "[" << __FUNCTION__ << "] " <<
-                    this->line_info.errstr << std::endl;
-            }
+            this->setLineError(LINE_ERR_TRAP_IMPL, this->token);
             break;
     }
 }
@@ -696,47 +715,34 @@ void Lexer::parseTrapOpcode(void)
  */
 void Lexer::parseDirective(void)
 {
-    Opcode o;
     this->line_info.is_directive  = true;
-    this->asm_dir_table.get(std::string(this->token_buf), o);
-    if(o.mnemonic == "M_INVALID" || o.mnemonic == ".INVALID")
+    if(this->token_kw == LEX_KW_NONE || lex_keyword(this->token_kw).kind != LEX_KW_DIR)
     {
-
-        this->line_info.error = true;
-        this->line_info.errstr = "Opcode <" + std::string(this->token_buf) + "> not a valid assembler directive";
-        if(this->verbose)
-        {
-            std::cout << "[" << __FUNCTION__ << "] " << 
-                this->line_info.errstr << std::endl;
-        }
+        this->setLineError(LINE_ERR_DIRECTIVE, this->token);
         return;
     }
-    this->line_info.opcode = o;
-    this->line_info.opcode.opcode = 0x0;    // zero out opcode for directives
+    const LexKeyword& o = lex_keyword(this->token_kw);
+    this->line_info.mnemonic = this->source_info.intern(o.name);
+    this->line_info.opcode   = 0x0;    // zero out opcode for directives
+    this->line_info.handler  = o.handler;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (line " << 
-            std::dec << this->cur_line << ") extracted directive symbol " <<
-            std::string(this->token_buf) << std::endl;
+        LOG_DEBUG("(line %u) extracted directive symbol %s", this->cur_line,
+                this->token);
     }
 
-    if(o.mnemonic == ".END")
+    if(o.opcode == ASM_END)
         return;
 
     // Remaining directives except for STRINGZ have arguments, 
     // figure those out here 
     uint16_t arg = 0;
-    if(o.mnemonic != ".STRINGZ")
+    if(o.opcode != ASM_STRINGZ)
     {
         this->scanToken();
-        // Get the arg in numerical form from string
-        std::string argstr = std::string(this->token_buf);
-        if(this->token_buf[0] == 'x' || this->token_buf[0] == 'X')
-            arg = std::stoi(argstr.substr(1, argstr.length()), nullptr, 16);
-        else if(this->token_buf[0] == '#')
-            arg = std::stoi(argstr.substr(1, argstr.length()));
-        else
-            arg = std::stoi(argstr);
+        if(!this->parseImm(LEX_LIT_WORD))
+            return;
+        arg = this->line_info.imm;
     }
 
     switch(o.opcode)
@@ -755,19 +761,12 @@ void Lexer::parseDirective(void)
             break;
         case ASM_STRINGZ:
             this->scanString();
-            // debug 
-            std::cout << "[" << __FUNCTION__ << "] got STRINGZ token <" 
-                << std::string(this->token_buf) << ">" << std::endl;
-            this->line_info.symbol = std::string(this->token_buf);
+            if(this->verbose)
+                LOG_DEBUG("got STRINGZ token <%s>", this->token);
+            this->line_info.symbol = this->source_info.intern(this->token);
             break;
         default:
-            this->line_info.error = true;
-            this->line_info.errstr = "Token <" + o.mnemonic + "> is not a valid assembler directive";
-            if(this->verbose)
-            {
-                std::cout << "[" << __FUNCTION__ << "] " << 
-                    this->line_info.errstr << std::endl;
-            }
+            this->setLineError(LINE_ERR_DIR_IMPL, "");
             break;
     }
 }
@@ -780,10 +779,10 @@ void Lexer::parseDirective(void)
 void Lexer::parseToken(void)
 {
     this->scanToken();
+    this->token_kw = lex_keyword_find(this->token);
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] scanned " << 
-            std::string(this->token_buf) << " into token buffer\n";
+        LOG_DEBUG("scanned %s into token buffer", this->token);
     }
 
     // Check if token is a directive
@@ -791,9 +790,8 @@ void Lexer::parseToken(void)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] (line " << 
-                std::dec << this->cur_line << ") found directive <" << 
-                std::string(this->token_buf) << ">" << std::endl;
+            LOG_DEBUG("(line %u) found directive <%s>", this->cur_line,
+                    this->token);
         }
         this->parseDirective();
         return;
@@ -804,9 +802,8 @@ void Lexer::parseToken(void)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] (line " << 
-                std::dec << this->cur_line << ") found trap opcode <" << 
-                std::string(this->token_buf) << ">" << std::endl;
+            LOG_DEBUG("(line %u) found trap opcode <%s>", this->cur_line,
+                    this->token);
         }
         this->parseTrapOpcode();
         return;
@@ -817,9 +814,8 @@ void Lexer::parseToken(void)
     {
         if(this->verbose)
         {
-            std::cout << "[" << __FUNCTION__ << "] (line " << 
-                std::dec << this->cur_line << ") found opcode <" << 
-                std::string(this->token_buf) << ">" << std::endl;
+            LOG_DEBUG("(line %u) found opcode <%s>", this->cur_line,
+                    this->token);
         }
         this->parseOpcode();
         return;
@@ -830,12 +826,11 @@ void Lexer::parseToken(void)
     // instruction
     if(this->line_info.is_label)
     {
-        this->line_info.error = true;
-        this->line_info.errstr = "No valid instruction after label <" + 
-            this->line_info.label + ">";
-        std::cerr << "[" << __FUNCTION__ << "] (line " << 
+        this->setLineError(LINE_ERR_NO_INSTR, this->source_info.getStr(this->line_info.label));
+        if(!this->quiet)
+            std::cerr << "[" << __FUNCTION__ << "] (line " << 
             std::dec << this->line_info.line_num << ") " << 
-            this->line_info.errstr << std::endl;
+            this->source_info.getErrStr(this->line_info) << std::endl;
         return;
     }
 
@@ -844,37 +839,38 @@ void Lexer::parseToken(void)
     this->line_info.is_label = true;
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] (line "
-            << std::dec << this->cur_line << ") found label symbol <" 
-            << std::string(this->token_buf) << "> at address 0x"
-            << std::hex << std::setw(4) << std::setfill('0') 
-            << this->cur_addr << std::endl;
+        LOG_DEBUG("(line %u) found label symbol <%s> at address 0x%04x",
+                this->cur_line, this->token, this->cur_addr);
     }
         
     // add the label, removing any trailing characters (eg ':')
-    std::string label(this->token_buf);
+    std::string_view label = this->token;
     // Ensure that this actually turned into a valid token 
     if(label.length() == 0)
     {
-        this->line_info.error = true;
-        this->line_info.errstr = "(line " + std::to_string(this->line_info.line_num) + ") Invalid label token";
-        if(this->verbose)
-            std::cout << "[" << __FUNCTION__ << "] " << this->line_info.errstr << std::endl;
+        this->setLineError(LINE_ERR_LABEL, "");
         return;
     }
     if(label[label.length()-1] == ':')
-        this->line_info.label = label.substr(0, label.length()-1);
+        this->line_info.label = this->source_info.intern(label.substr(0, label.length()-1));
     else
-        this->line_info.label = std::string(this->token_buf);
+        this->line_info.label = this->source_info.intern(label);
     Symbol s;
     // Get rid of any trailing non-alphanum chars 
-    std::string sym_label = std::string(this->token_buf);
-    while(!isalnum(toupper(sym_label[sym_label.length()-1])))
-        sym_label.pop_back();
+    std::string_view sym_label = label;
+    while(!sym_label.empty() && !lex_char_is(sym_label.back(), LEX_CC_SYM_BODY))
+        sym_label.remove_suffix(1);
     s.label = sym_label;
     s.addr  = this->cur_addr;
-    std::cout << "s.label [" << s.label <<  "] s.addr : " << std::hex << s.addr << std::endl;
-    this->sym_table.add(s);
+    if(this->verbose)
+        LOG_DEBUG("s.label [%s] s.addr : %x", s.label, s.addr);
+    // An edited source will change, so keep a copy of the label
+    if(this->edit_buf != nullptr)
+        s.label = this->source_info.getStr(this->source_info.intern(s.label));
+    if(this->relexing)
+        this->relex_syms.push_back(s);
+    else
+        this->sym_table.add(s);
     //this->skipWhitespace();
 }
 
@@ -891,9 +887,12 @@ void Lexer::parseLine(void)
     // Check the line info to see what kind of line it was. 
     if(this->line_info.error)
     {
-        std::cerr << "[" << __FUNCTION__ << "] error line ("
-            << std::dec << this->line_info.line_num << ") "
-            << this->line_info.errstr << std::endl;
+        if(!this->quiet)
+        {
+            std::cerr << "[" << __FUNCTION__ << "] error line ("
+                << std::dec << this->line_info.line_num << ") "
+                << this->source_info.getErrStr(this->line_info) << std::endl;
+        }
         goto LINE_END;
     }
 
@@ -902,9 +901,8 @@ void Lexer::parseLine(void)
     {
         if(this->verbose)
         { 
-            std::cout << "[" << __FUNCTION__ << "] got label on line "
-                << std::dec << this->line_info.line_num << std::endl;
-            std::cout << "[" << __FUNCTION__ << "] parsing segment after label" << std::endl;
+            LOG_DEBUG("got label on line %u", this->line_info.line_num);
+            LOG_DEBUG("parsing segment after label");
         }
         this->skipWhitespace();
         this->parseToken();
@@ -916,7 +914,7 @@ LINE_END:
 }
 
 /*
- * resolveLabels9)
+ * resolveLabels()
  * Replace labels with their corresponding addresses
  */
 void Lexer::resolveLabels(void)
@@ -925,38 +923,120 @@ void Lexer::resolveLabels(void)
     unsigned int n;
     uint16_t label_addr;
 
+    this->label_refs.clear();
     for(n = 0; n < this->source_info.getNumLines(); n++)
     {
         info = this->source_info.get(n);
-        //if(!info.is_label && info.label != "\0")
-        if(info.symbol != "\0" && !info.is_directive)
+        this->countRef(info, 1);
+        if(info.symbol != STR_ID_EMPTY && !info.is_directive)
         {
-            label_addr = this->sym_table.getAddr(info.symbol);
-            if(this->verbose)
+            std::string_view symbol = this->source_info.getStr(info.symbol);
+            if(!this->sym_table.find(symbol, label_addr))
             {
-                std::cout << "[" << __FUNCTION__ << 
-                    "] resolving symbol " << info.symbol << 
-                    " which has address " << std::hex << label_addr
-                    << std::endl;
+                if(this->verbose)
+                    LOG_DEBUG("symbol %s is not defined", symbol);
+                continue;
             }
-            if(label_addr > 0)
+            if(this->verbose)
             {
-                info.imm = label_addr;
-                this->source_info.update(n, info);
+                LOG_DEBUG("resolving symbol %s which has address %x",
+                        symbol, label_addr);
             }
+            info.imm = label_addr;
+            this->source_info.update(n, info);
         }
     }
 }
 
+/*
+ * resolveLine()
+ * Fill in the address of the label a line refers to. A label 
+ * that isn't defined leaves the immediate as the lexer found it,
+ * which for a label is always 0.
+ */
+void Lexer::resolveLine(LineInfo& line) const
+{
+    uint16_t label_addr;
+
+    if(line.symbol == STR_ID_EMPTY || line.is_directive)
+        return;
+    if(this->sym_table.find(this->source_info.getStr(line.symbol), label_addr))
+        line.imm = label_addr;
+    else
+        line.imm = 0;
+}
+
+/*
+ * isOrig()
+ * True if a line is a .ORIG directive, after which addresses 
+ * no longer depend on the lines before
+ */
+bool Lexer::isOrig(const LineInfo& line) const
+{
+    return (line.handler == LINE_H_ORIG && !line.error) ? true : false;
+}
+
 // Do lexing pass
-SourceInfo Lexer::lex(void)
+const SourceInfo& Lexer::lex(void)
 {
-    this->cur_line = 1;
-    this->cur_pos  = 0;
-    this->cur_addr = 0;
+    LineInfo line;
+    unsigned int max_lines;
+
+    // First pass. There are never more lines than newlines, so 
+    // counting them first means the line arrays are sized once.
+    this->begin();
+    max_lines = std::count(this->src.begin(), this->src.end(), '\n') + 1;
+    this->source_info.reserve(this->source_info.getNumLines() + max_lines);
+    this->spans.reserve(max_lines);
+    while(this->nextLine(line))
+    {
+        this->source_info.add(line);
+        this->spans.push_back(this->line_span);
+    }
+    if(this->source_info.hasError() && !this->cont_on_error)
+        return this->source_info;
 
-    // First pass 
-    while(!this->exhausted())
+    // Second pass 
+    this->resolveLabels();
+
+    return this->source_info;
+}
+
+/*
+ * begin()
+ * Go back to the start of the source
+ */
+void Lexer::begin(void)
+{
+    this->viewSource();
+    this->cur_line   = 1;
+    this->cur_pos    = 0;
+    this->cur_addr   = 0;
+    this->cur_char   = (this->src.size() > 0) ? this->src[0] : '\0';
+    this->stream_end = false;
+    this->relexing   = false;
+    this->num_out    = 0;
+    this->applyShift();
+    this->spans.clear();
+    this->errors.clear();
+    // Lines and symbols refer to the source text in place
+    this->source_info.setSource(this->src_buf);
+    this->sym_table.setSource(this->src_buf);
+}
+
+/*
+ * nextLine()
+ * Parse the next line of source into line. Returns false once
+ * the source is exhausted, or after a line with an error has 
+ * been returned.
+ */
+bool Lexer::nextLine(LineInfo& line)
+{
+    // Blank lines and comments are skipped in one go here, so 
+    // the loop only has to find where the line starts
+    if(this->core == LEX_CORE_DFA && !this->stream_end)
+        this->dfaScan(LEX_DFA_LINE);
+    while(!this->stream_end && !this->exhausted())
     {
         // Skip whitespace 
         if(this->isSpace())
@@ -966,59 +1046,689 @@ SourceInfo Lexer::lex(void)
         }
 
         // Skip comments
-        if(this->cur_char ==  ';')
+        if(this->isComment())
         {
             this->skipLine();
             continue;
         }
 
+        this->line_span.start = this->cur_pos;
+        this->line_span.sym   = this->relexing ? this->relex_syms.size() : this->sym_table.getNumSyms();
         this->parseLine();
-        this->source_info.add(this->line_info);
+        line = this->line_info;
         if(this->line_info.error)
         {
-            std::cout << "[" << __FUNCTION__ << "] (line " << 
-                this->line_info.line_num << ") ERROR " << 
-                this->line_info.errstr << std::endl;
+            if(!this->quiet)
+            {
+                std::cout << "[" << __FUNCTION__ << "] (line " << 
+                    std::dec << this->line_info.line_num << ") ERROR " << 
+                    this->source_info.getErrStr(this->line_info) << std::endl;
+            }
             this->source_info.setError(true);
-            return this->source_info;
+            this->addError();
+            // Whatever is left of the line can't be trusted, so 
+            // start again on the next one
+            if(this->cont_on_error)
+                this->skipComment();
+            else
+                this->stream_end = true;
         }
+        this->line_span.end = this->cur_pos;
+        this->num_out++;
+        return true;
     }
-    // Second pass 
+
+    return false;
+}
+
+/*
+ * LexChunk
+ * One piece of the source for lexParallel(). Addresses in the chunk
+ * are relative to the start of the chunk up until its first .ORIG,
+ * and line numbers are relative to the start of the chunk.
+ */
+typedef struct
+{
+    size_t                 start;
+    size_t                 len;
+    std::unique_ptr<Lexer> lexer;
+    std::exception_ptr     except;
+    unsigned int           num_newlines;
+    bool                   seen_orig;
+    unsigned int           orig_line;   // index of the first .ORIG line
+    unsigned int           orig_sym;    // symbols up to and including that line
+    bool                   cut;         // a line ran into the end of the chunk
+} LexChunk;
+
+/*
+ * lexParallel()
+ */
+const SourceInfo& Lexer::lexParallel(const unsigned int num_threads, const size_t chunk_size)
+{
+    std::vector<LexChunk> chunks;
+    size_t start, end;
+
+    this->viewSource();
+    // Split at line boundaries. A chunk never starts on a newline, 
+    // since the lexer doesn't count a newline that it starts on
+    start = 0;
+    while(start < this->src.size())
+    {
+        end = std::min(start + std::max(chunk_size, (size_t) 1), this->src.size());
+        end = this->src.find('\n', end - 1);
+        if(end == std::string_view::npos)
+            end = this->src.size();
+        else
+            end = this->src.find_first_not_of('\n', end);
+        if(end == std::string_view::npos)
+            end = this->src.size();
+
+        chunks.emplace_back();
+        chunks.back().start = start;
+        chunks.back().len   = end - start;
+        start = end;
+    }
+    if(num_threads <= 1 || chunks.size() <= 1)
+        return this->lex();
+
+    // Lex the chunks 
+    auto lex_chunk = [&](LexChunk& c)
+    {
+        LineInfo line;
+
+        c.seen_orig = false;
+        c.orig_line = 0;
+        c.orig_sym  = 0;
+        c.cut       = false;
+        c.except    = nullptr;
+        try
+        {
+            c.lexer.reset(new Lexer(this->op_table));
+            c.lexer->verbose = this->verbose;
+            c.lexer->quiet   = true;
+            c.lexer->cont_on_error = this->cont_on_error;
+            c.lexer->core    = this->core;
+            c.lexer->src_buf = this->src_buf;
+            // Only the slice of the source, never the edited copy 
+            // itself, which looking at would move its gap
+            c.lexer->src     = this->src.substr(c.start, c.len);
+            c.num_newlines   = std::count(c.lexer->src.begin(), c.lexer->src.end(), '\n');
+            c.lexer->source_info.reserve(c.num_newlines + 1);
+            c.lexer->spans.reserve(c.num_newlines + 1);
+
+            c.lexer->begin();
+            while(c.lexer->nextLine(line))
+            {
+                c.lexer->source_info.add(line);
+                c.lexer->spans.push_back(c.lexer->line_span);
+                if(!c.seen_orig && c.lexer->isOrig(line))
+                {
+                    c.seen_orig = true;
+                    c.orig_line = c.lexer->source_info.getNumLines() - 1;
+                    c.orig_sym  = c.lexer->sym_table.getNumSyms();
+                }
+                // The line may carry on into the next chunk
+                if(c.lexer->exhausted())
+                    c.cut = true;
+            }
+        }
+        catch(...)
+        {
+            c.except = std::current_exception();
+        }
+    };
+    std::atomic<unsigned int> next_chunk(0);
+    auto lex_chunks = [&](void)
+    {
+        unsigned int idx;
+
+        while((idx = next_chunk.fetch_add(1)) < chunks.size())
+            lex_chunk(chunks[idx]);
+    };
+
+    std::vector<std::thread> workers;
+    unsigned int num_workers = std::min((size_t) num_threads, chunks.size());
+    for(unsigned int t = 0; t < num_workers; ++t)
+        workers.emplace_back(lex_chunks);
+    for(std::thread& w : workers)
+        w.join();
+
+    // If a line may have run across the end of a chunk, join that 
+    // chunk to the next one and lex them again. Lexing stops at the
+    // first error (unless we carry on after errors), so later chunks
+    // don't matter.
+    unsigned int last_chunk = 0;
+    while(last_chunk < chunks.size())
+    {
+        LexChunk& c = chunks[last_chunk];
+        if(c.except)
+            std::rethrow_exception(c.except);
+        if(c.cut && last_chunk < chunks.size() - 1)
+        {
+            if(this->verbose)
+                LOG_DEBUG("line crosses end of chunk %u, joining to next chunk", last_chunk);
+            c.len += chunks[last_chunk + 1].len;
+            chunks.erase(chunks.begin() + last_chunk + 1);
+            lex_chunk(c);
+            continue;
+        }
+        if(c.lexer->source_info.hasError() && !this->cont_on_error)
+            break;
+        last_chunk++;
+    }
+    last_chunk = std::min(last_chunk, (unsigned int) chunks.size() - 1);
+
+    // Stitch the chunks together. Each chunk starts at the address 
+    // the one before it finished on.
+    this->begin();
+    unsigned int addr_base = 0;
+    unsigned int line_base = 0;
+    unsigned int num_lines = 0;
+    for(unsigned int idx = 0; idx <= last_chunk; ++idx)
+        num_lines += chunks[idx].lexer->source_info.getNumLines();
+    this->source_info.reserve(this->source_info.getNumLines() + num_lines);
+    this->spans.reserve(num_lines);
+    for(unsigned int idx = 0; idx <= last_chunk; ++idx)
+    {
+        LexChunk& c = chunks[idx];
+        SourceInfo& csource = c.lexer->source_info;
+        std::vector<StrId> remap = this->source_info.mergeStrings(csource);
+        unsigned int sym_base = this->sym_table.getNumSyms();
+        unsigned int line_idx_base = this->source_info.getNumLines();
+        unsigned int n;
+
+        for(n = 0; n < csource.getNumLines(); ++n)
+        {
+            LineInfo line = csource.get(n);
+            if(!c.seen_orig || n < c.orig_line)
+                line.addr += addr_base;
+            line.line_num += line_base;
+            line.symbol   = remap[line.symbol];
+            line.label    = remap[line.label];
+            line.mnemonic = remap[line.mnemonic];
+            line.err_arg  = remap[line.err_arg];
+            this->source_info.add(line);
+
+            LexSpan span = c.lexer->spans[n];
+            span.start += c.start;
+            span.end   += c.start;
+            span.sym   += sym_base;
+            this->spans.push_back(span);
+        }
+        for(n = 0; n < c.lexer->sym_table.getNumSyms(); ++n)
+        {
+            Symbol sym = c.lexer->sym_table.get(n);
+            if(!c.seen_orig || n < c.orig_sym)
+                sym.addr += addr_base;
+            // An edited source will change, so keep a copy of the label
+            if(this->edit_buf != nullptr)
+                sym.label = this->source_info.getStr(this->source_info.intern(sym.label));
+            this->sym_table.add(sym);
+        }
+        for(LexError err : c.lexer->errors)
+        {
+            err.line_idx += line_idx_base;
+            err.line_num += line_base;
+            this->errors.push_back(err);
+            if(!this->quiet)
+            {
+                LineInfo err_line = this->source_info.get(err.line_idx);
+                std::cout << "[" << __FUNCTION__ << "] (line " << 
+                    std::dec << err_line.line_num << ") ERROR " << 
+                    this->source_info.getErrStr(err_line) << std::endl;
+            }
+        }
+        if(csource.hasError())
+        {
+            this->source_info.setError(true);
+            if(!this->cont_on_error)
+                return this->source_info;
+        }
+
+        addr_base = c.seen_orig ? c.lexer->cur_addr : addr_base + c.lexer->cur_addr;
+        line_base += c.num_newlines;
+        // A newline right at the start of the source isn't counted
+        if(idx == 0 && this->src[0] == '\n')
+            line_base--;
+    }
+    this->cur_addr = addr_base;
+    this->cur_line = line_base + 1;
+
     this->resolveLabels();
 
     return this->source_info;
 }
 
+/*
+ * viewSource()
+ * Look at all of the source again, after edit() left only part of
+ * the edited copy in view
+ */
+void Lexer::viewSource(void)
+{
+    if(this->edit_buf != nullptr)
+        this->src = this->edit_buf->view();
+}
+
+/*
+ * relexAll()
+ * Throw away the output so far and lex the whole source again
+ */
+LexEdit Lexer::relexAll(void)
+{
+    LexEdit e;
+
+    e.first_line  = 0;
+    e.num_removed = this->source_info.getNumLines();
+    this->shift_from  = 0;
+    this->shift_line  = 0;
+    this->shift_pos   = 0;
+    this->shift_sym   = 0;
+    this->source_info = SourceInfo();
+    this->sym_table   = SymbolTable();
+    this->lex();
+    e.num_added   = this->source_info.getNumLines();
+    e.line_delta  = 0;
+    e.addr_delta  = 0;
+    e.relabel     = true;
+    e.relex_all   = true;
+
+    return e;
+}
+
+/*
+ * getSpan()
+ * Span of a line, with any shift that is still pending on it
+ */
+LexSpan Lexer::getSpan(const unsigned int idx) const
+{
+    LexSpan span = this->spans[idx];
+
+    if(idx >= this->shift_from)
+    {
+        span.start += this->shift_pos;
+        span.end   += this->shift_pos;
+        span.sym   += this->shift_sym;
+    }
+
+    return span;
+}
+
+/*
+ * findSpan()
+ * First line that the lexer was still on at pos
+ */
+unsigned int Lexer::findSpan(const unsigned int pos) const
+{
+    unsigned int lo = 0;
+    unsigned int hi = this->spans.size();
+
+    while(lo < hi)
+    {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if(this->getSpan(mid).end < pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/*
+ * moveShift()
+ * Move the start of the pending shift to line idx. Only the lines
+ * in between are changed, so moving it a short way is cheap.
+ */
+void Lexer::moveShift(const unsigned int idx)
+{
+    unsigned int lo, hi, k;
+    int sign;
+    LineInfo line;
+
+    if(this->shift_line != 0 || this->shift_pos != 0 || this->shift_sym != 0)
+    {
+        lo   = std::min(idx, this->shift_from);
+        hi   = std::min(std::max(idx, this->shift_from), 
+                        std::min((unsigned int) this->spans.size(), this->source_info.getNumLines()));
+        sign = (idx > this->shift_from) ? 1 : -1;
+        for(k = lo; k < hi; ++k)
+        {
+            this->spans[k].start += sign * this->shift_pos;
+            this->spans[k].end   += sign * this->shift_pos;
+            this->spans[k].sym   += sign * this->shift_sym;
+            line = this->source_info.get(k);
+            line.line_num += sign * this->shift_line;
+            this->source_info.update(k, line);
+        }
+    }
+    this->shift_from = idx;
+}
+
+/*
+ * applyShift()
+ * Bring every line up to date
+ */
+void Lexer::applyShift(void)
+{
+    this->moveShift(this->spans.size());
+    this->shift_from = 0;
+    this->shift_line = 0;
+    this->shift_pos  = 0;
+    this->shift_sym  = 0;
+}
+
+/*
+ * countRef()
+ * Count a line in (n = 1) or out of (n = -1) the references to 
+ * the label it names
+ */
+void Lexer::countRef(const LineInfo& line, const int n)
+{
+    if(line.symbol == STR_ID_EMPTY || line.is_directive)
+        return;
+    if(line.symbol >= this->label_refs.size())
+        this->label_refs.resize(line.symbol + 1, 0);
+    this->label_refs[line.symbol] += n;
+}
+
+/*
+ * edit()
+ * Lexing restarts from the end of the last line that is before the
+ * edit, and stops as soon as it ends a line at the same place in the
+ * text as one of the old lines after the edit. From there on the old 
+ * lines are still good, apart from their line numbers and offsets, 
+ * which are shifted, and (up to the next .ORIG) their addresses.
+ *
+ * The line number and offset shift is left pending from where the 
+ * edit ended, and moved to the next edit when there is one, so an
+ * edit only costs the lines it lexes plus the lines between it and
+ * the last edit. The text is treated the same way (see 
+ * SourceBuffer::replace()). What isn't put off is anything that 
+ * changes because an address moved: the addresses up to the next 
+ * .ORIG, and when a label changes or moves, the symbol table and 
+ * the lines that refer to it.
+ */
+LexEdit Lexer::edit(const unsigned int pos, const unsigned int len, const std::string_view& text)
+{
+    LexEdit e;
+    LineInfo line;
+    LexSpan prev = {0, 0, 0};
+    std::vector<LineInfo> new_lines;
+    std::vector<LexSpan>  new_spans;
+    unsigned int start, end, src_len, window, restart, num_lines, num_errors, first, tail, orig, k;
+    int64_t delta;
+    bool synced, failed;
+    bool was_quiet;
+
+    // Lines that were lexed from the original text still refer to it, 
+    // so edits are made to a copy
+    if(this->edit_buf == nullptr)
+    {
+        this->edit_buf = std::make_shared<SourceBuffer>();
+        this->edit_buf->assignCopy(std::string(this->src));
+    }
+
+    // Work out what is being replaced before the text changes 
+    src_len = this->edit_buf->length();
+    start   = std::min(pos, src_len);
+    end     = std::min((size_t) start + len, (size_t) src_len);
+    std::string_view old_text = this->edit_buf->prefix(end);
+    e.line_delta = std::count(text.begin(), text.end(), '\n') -
+                   std::count(old_text.begin() + start, old_text.begin() + end, '\n');
+    delta = (int64_t) text.size() - (int64_t) (end - start);
+    this->edit_buf->replace(start, end - start, text);
+    src_len = this->edit_buf->length();
+
+    // Without a clean lex to start from there's nothing to reuse
+    num_lines = this->source_info.getNumLines();
+    if(num_lines == 0 || this->source_info.hasError() || this->spans.size() != num_lines)
+        return this->relexAll();
+
+    // The first line affected is the first one that the lexer looked
+    // at the start of the edit for. Lines before it are brought up to
+    // date, the old lines from here on may still be shifted.
+    first = this->findSpan(start);
+    this->moveShift(first);
+    if(first > 0)
+        prev = this->getSpan(first - 1);
+    restart = prev.end;
+
+    // Only the text up to the end of the line the edit ends in is 
+    // looked at to start with. If lexing gets to the end of that 
+    // without getting back in step, it starts again with more.
+    tail   = this->findSpan(end);
+    window = (tail < num_lines) ? this->getSpan(tail).end + delta + 1 : src_len;
+    window = std::min(std::max(window, start + (unsigned int) text.size() + 1), src_len);
+
+    // Lex until we get back in step with the old lines
+    was_quiet        = this->quiet;
+    this->quiet      = true;
+    this->relexing   = true;
+    num_errors       = this->errors.size();
+    while(true)
+    {
+        this->src = this->edit_buf->prefix(window);
+        if(first == 0)
+        {
+            this->cur_line = 1;
+            this->cur_addr = 0;
+        }
+        else
+        {
+            LineInfo prev_line = this->source_info.get(first - 1);
+            this->cur_addr = prev_line.addr + 1;
+            this->cur_line = prev_line.line_num + std::count(this->src.begin() + prev.start,
+                    this->src.begin() + std::min((size_t) prev.end + 1, this->src.size()), '\n');
+        }
+        this->cur_pos    = restart;
+        this->cur_char   = (this->cur_pos < this->src.size()) ? this->src[this->cur_pos] : '\0';
+        this->stream_end = false;
+        this->relex_syms.clear();
+        new_lines.clear();
+        new_spans.clear();
+        synced = false;
+        failed = false;
+        tail   = first;
+        while(this->nextLine(line))
+        {
+            // A line that runs into the end of the window may have 
+            // been cut short
+            if(window < src_len && this->line_span.end >= window)
+                break;
+            if(line.error)
+            {
+                failed = true;
+                break;
+            }
+            new_lines.push_back(line);
+            new_spans.push_back(this->line_span);
+            if(this->line_span.end >= start + text.size())
+            {
+                int64_t old_end = (int64_t) this->line_span.end - delta;
+                while(tail < num_lines && this->getSpan(tail).end < old_end)
+                    tail++;
+                if(tail < num_lines && this->getSpan(tail).end == old_end)
+                {
+                    synced = true;
+                    break;
+                }
+            }
+        }
+        if(synced || failed || window == src_len)
+            break;
+        this->errors.resize(num_errors);
+        this->source_info.setError(false);
+        window = std::min(window + (window - restart), src_len);
+    }
+    this->relexing = false;
+    this->quiet    = was_quiet;
+    if(this->source_info.hasError())
+        return this->relexAll();
+
+    e.first_line  = first;
+    e.num_removed = synced ? tail - first + 1 : num_lines - first;
+    e.num_added   = new_lines.size();
+    e.addr_delta  = 0;
+    e.relex_all   = false;
+    tail = first + e.num_removed;
+    if(synced)
+        e.addr_delta = (int16_t) (new_lines.back().addr - this->source_info.get(tail - 1).addr);
+
+    // Addresses after the edit move up to the next .ORIG
+    orig = tail;
+    if(e.addr_delta != 0)
+    {
+        for(; orig < num_lines && !this->isOrig(this->source_info.get(orig)); ++orig)
+        {
+            line = this->source_info.get(orig);
+            line.addr += e.addr_delta;
+            this->source_info.update(orig, line);
+        }
+    }
+
+    // Symbols defined in the lines that were lexed again, and those
+    // whose address moved
+    unsigned int num_syms  = this->sym_table.getNumSyms();
+    unsigned int sym_first = (first < num_lines) ? this->getSpan(first).sym : num_syms;
+    unsigned int sym_tail  = (tail < num_lines) ? this->getSpan(tail).sym : num_syms;
+    unsigned int sym_moved = sym_tail;
+    if(e.addr_delta != 0)
+        sym_moved = (orig + 1 < num_lines) ? this->getSpan(orig + 1).sym : num_syms;
+
+    e.relabel = (sym_moved != sym_tail || this->relex_syms.size() != sym_tail - sym_first);
+    for(k = 0; !e.relabel && k < this->relex_syms.size(); ++k)
+    {
+        Symbol sym = this->sym_table.get(sym_first + k);
+        if(sym.label != this->relex_syms[k].label || sym.addr != this->relex_syms[k].addr)
+            e.relabel = true;
+    }
+    std::vector<StrId> relabels;
+    if(e.relabel)
+    {
+        std::vector<Symbol> syms;
+        syms.reserve(num_syms - (sym_tail - sym_first) + this->relex_syms.size());
+        for(k = 0; k < sym_first; ++k)
+            syms.push_back(this->sym_table.get(k));
+        syms.insert(syms.end(), this->relex_syms.begin(), this->relex_syms.end());
+        for(k = sym_tail; k < num_syms; ++k)
+        {
+            syms.push_back(this->sym_table.get(k));
+            if(k < sym_moved)
+                syms.back().addr += e.addr_delta;
+        }
+        // Labels that were taken out, put in or moved
+        for(k = sym_first; k < sym_moved; ++k)
+            relabels.push_back(this->source_info.intern(this->sym_table.get(k).label));
+        for(const Symbol& s : this->relex_syms)
+            relabels.push_back(this->source_info.intern(s.label));
+        this->sym_table.build(syms);
+    }
+
+    // Splice in the new lines. The lines after them take on this 
+    // edit's shift as well as any that was pending.
+    for(k = first; k < tail; ++k)
+        this->countRef(this->source_info.get(k), -1);
+    for(k = 0; k < new_lines.size(); ++k)
+    {
+        this->resolveLine(new_lines[k]);
+        this->countRef(new_lines[k], 1);
+        new_spans[k].sym += sym_first;
+    }
+    this->shift_line += e.line_delta;
+    this->shift_pos  += delta;
+    this->shift_sym  += this->relex_syms.size() - (sym_tail - sym_first);
+    this->source_info.replace(first, e.num_removed, new_lines);
+    k = std::min(e.num_removed, e.num_added);
+    std::copy(new_spans.begin(), new_spans.begin() + k, this->spans.begin() + first);
+    if(e.num_removed > k)
+        this->spans.erase(this->spans.begin() + first + k, this->spans.begin() + tail);
+    else
+        this->spans.insert(this->spans.begin() + first + k, new_spans.begin() + k, new_spans.end());
+    this->shift_from = first + e.num_added;
+
+    // Lines anywhere may refer to a label that changed, but only 
+    // those lines need to be looked at again
+    unsigned int num_refs = 0;
+    std::sort(relabels.begin(), relabels.end());
+    relabels.erase(std::unique(relabels.begin(), relabels.end()), relabels.end());
+    for(const StrId id : relabels)
+        num_refs += (id < this->label_refs.size()) ? this->label_refs[id] : 0;
+    for(k = 0; num_refs > 0 && k < this->source_info.getNumLines(); ++k)
+    {
+        const LineInfo& ref = this->source_info.at(k);
+        if(ref.symbol == STR_ID_EMPTY || ref.is_directive ||
+           !std::binary_search(relabels.begin(), relabels.end(), ref.symbol))
+            continue;
+        num_refs--;
+        line = ref;
+        this->resolveLine(line);
+        if(line.imm != ref.imm)
+            this->source_info.update(k, line);
+    }
+
+    return e;
+}
+
+/*
+ * findSymbol()
+ * Address of a label seen so far
+ */
+bool Lexer::findSymbol(const std::string_view& label, uint16_t& addr) const
+{
+    return this->sym_table.find(label, addr);
+}
+
 // ==== FILE LOADING
+/*
+ * loadFile()
+ * Map a source file for lexing. If the file can't be mapped
+ * it is read into memory instead.
+ */
 void Lexer::loadFile(const std::string& filename)
 {
-    std::ifstream infile(filename);
-    std::string line;
-
     // save the filename
     this->filename = filename;
-    while(std::getline(infile, line))
-    {
-        this->src += line;
-        this->src.push_back('\n');
-    }
+    this->edit_buf = nullptr;
+    this->src_buf  = std::make_shared<SourceBuffer>();
+    if(this->src_buf->load(filename) < 0)
+        std::cerr << "[" << __FUNCTION__ << "] failed to read file [" 
+            << filename << "]" << std::endl;
+    this->src      = this->src_buf->view();
+    this->cur_pos  = 0;
+    this->cur_char = (this->src.size() > 0) ? this->src[0] : '\0';
 
     if(this->verbose)
     {
-        std::cout << "[" << __FUNCTION__ << "] read " 
-        << std::dec << this->src.length() << " characters from file ["
-        << filename << "]" << std::endl;
+        LOG_DEBUG("read %u characters from file [%s]", this->src.length(),
+                filename);
     }
+}
 
-    infile.close();
-    this->src.push_back('\0');
-    this->cur_char = this->src[0];
+/*
+ * loadBuffer()
+ * Lex source text held in a buffer owned by the caller. The 
+ * buffer is not copied.
+ */
+void Lexer::loadBuffer(const char* buf, const size_t len)
+{
+    this->edit_buf = nullptr;
+    this->src_buf  = std::make_shared<SourceBuffer>();
+    this->src_buf->assign(buf, len);
+    this->src      = this->src_buf->view();
+    this->cur_pos  = 0;
+    this->cur_char = (this->src.size() > 0) ? this->src[0] : '\0';
+}
+
+void Lexer::loadBuffer(const std::string_view& buf)
+{
+    this->loadBuffer(buf.data(), buf.size());
 }
 
 // ==== Getters 
 unsigned int Lexer::getSrcLength(void) const
 {
-    return this->src.size();
+    return (this->edit_buf != nullptr) ? this->edit_buf->length() : this->src.size();
 }
 
 std::string Lexer::getFilename(void) const
@@ -1028,7 +1738,16 @@ std::string Lexer::getFilename(void) const
 
 std::string Lexer::dumpSrc(void) const
 {
-    return this->src;
+    return std::string((this->edit_buf != nullptr) ? this->edit_buf->view() : this->src);
+}
+
+/*
+ * getSource()
+ * Text being lexed
+ */
+std::shared_ptr<const SourceBuffer> Lexer::getSource(void) const
+{
+    return this->src_buf;
 }
 
 // Verbose 
@@ -1042,6 +1761,36 @@ bool Lexer::getVerbose(void) const
     return this->verbose;
 }
 
+void Lexer::setContOnError(const bool c)
+{
+    this->cont_on_error = c;
+}
+
+bool Lexer::getContOnError(void) const
+{
+    return this->cont_on_error;
+}
+
+void Lexer::setCore(const uint8_t c)
+{
+    this->core = c;
+}
+
+uint8_t Lexer::getCore(void) const
+{
+    return this->core;
+}
+
+/*
+ * getErrors()
+ * Errors from the last lex(), in source order. Without 
+ * setContOnError() there is at most one.
+ */
+const std::vector<LexError>& Lexer::getErrors(void) const
+{
+    return this->errors;
+}
+
 OpcodeTable Lexer::dumpOpTable(void) const
 {
     return this->op_table;
@@ -1052,8 +1801,9 @@ unsigned int Lexer::opTableSize(void) const
     return this->op_table.getNumOps();
 }
 
-SourceInfo Lexer::dumpSrcInfo(void) const
+SourceInfo Lexer::dumpSrcInfo(void)
 {
+    this->applyShift();
     return this->source_info;
 }
 
@@ -1062,6 +1812,41 @@ SymbolTable Lexer::dumpSymTable(void) const
     return this->sym_table;
 }
 
+/*
+ * getSourceInfo()
+ * Output of the last lex() or edit(). Any shift that edit() left
+ * pending is applied first.
+ */
+const SourceInfo& Lexer::getSourceInfo(void)
+{
+    this->applyShift();
+    return this->source_info;
+}
+
+const SymbolTable& Lexer::getSymTable(void) const
+{
+    return this->sym_table;
+}
+
+const OpcodeTable& Lexer::getOpTable(void) const
+{
+    return this->op_table;
+}
+
+/*
+ * takeSrcInfo()
+ * Move the output of the last lex() out of the lexer. The lexer is
+ * left with no lines and no strings, so an edit() after this lexes 
+ * everything again.
+ */
+SourceInfo Lexer::takeSrcInfo(void)
+{
+    this->applyShift();
+    this->spans.clear();
+    this->label_refs.clear();
+    return std::move(this->source_info);
+}
+
 #ifdef LEX_DEBUG 
 bool Lexer::isASCII(void) const
 {
@@ -9,15 +9,23 @@
 #define __LEXER_HPP
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 // Pass an opcode table for the machine to the lexer
+#include "dfa.hpp"
 #include "opcode.hpp"
 #include "source.hpp"
 
 #define LEX_DEBUG 
-// Largest size allowable for a token
-#define LEX_TOKEN_MAX_LEN 32
+
+// Sources are split into chunks of about this many bytes for lexParallel()
+#define LEX_CHUNK_SIZE (256 * 1024)
+
+// Scanning cores (see setCore())
+#define LEX_CORE_SCAN 0     // hand written loops and bulk skips (scan.hpp)
+#define LEX_CORE_DFA  1     // table driven state machine (dfa.hpp)
 
 // Assembler directives (which don't map to trap opcodes)
 #define ASM_INVALID 0x00
@@ -28,7 +36,7 @@
 #define ASM_STRINGZ 0x05
 
 // Assembler directives that are not trap vectors 
-static Opcode LEX_ASM_DIRECTIVE_OPCODES[] = {
+inline constexpr Opcode LEX_ASM_DIRECTIVE_OPCODES[] = {
     {ASM_BLKW,    ".BLKW"},
     {ASM_END,     ".END"},
     {ASM_FILL,    ".FILL"},
@@ -37,6 +45,45 @@ static Opcode LEX_ASM_DIRECTIVE_OPCODES[] = {
     {ASM_INVALID, ".INVALID"},
 };
 
+/*
+ * LexSpan
+ * Where in the source a line came from
+ */
+typedef struct
+{
+    uint32_t start;     // first character of the line
+    uint32_t end;       // where the lexer stopped after the line
+    uint32_t sym;       // symbols defined before the line
+} LexSpan;
+
+/*
+ * LexEdit
+ * What changed in the output of the lexer after an edit()
+ */
+typedef struct
+{
+    unsigned int first_line;    // first line that was lexed again
+    unsigned int num_removed;   // lines taken out from there
+    unsigned int num_added;     // lines put in their place
+    int          line_delta;    // line numbers after that moved by this
+    int          addr_delta;    // addresses after that moved by this
+    bool         relabel;       // symbols changed, so labels were resolved again
+    bool         relex_all;     // the whole source had to be lexed again
+} LexEdit;
+
+/*
+ * LexError
+ * An error found by the lexer. The line itself (and the message 
+ * for it) is in the lexer output at line_idx.
+ */
+typedef struct
+{
+    uint32_t line_idx;      // index of the line in the lexer output
+    uint32_t line_num;      // line in the source
+    uint32_t col;           // column the line starts at, from 1
+    uint8_t  err_code;      // one of LINE_ERR_*
+} LexError;
+
 // TODO: for now we just lex for LC3, but maybe we pass
 // a machine object here and extract the correct symbol/address
 // mappings from that object
@@ -45,15 +92,32 @@ class Lexer
     private:
         bool verbose;
         OpcodeTable op_table;
-        OpcodeTable psuedo_op_table;
-        OpcodeTable asm_dir_table;
         std::string filename;
-        std::string src;
+        std::shared_ptr<SourceBuffer> src_buf;
+        std::string_view src;       // view of src_buf
         unsigned int cur_pos;
         char cur_char;
-        char* token_buf;        // build up token here
-        unsigned int token_buf_size;
-        void allocMem(void);
+        std::string_view token;     // current token (slice of src)
+        int token_kw;               // keyword id of token (or LEX_KW_NONE)
+        bool stream_end;            // nextLine() has nothing more to give
+        bool quiet;                 // don't print errors (chunks of lexParallel())
+        bool cont_on_error;         // carry on at the next line after an error
+        uint8_t core;               // one of LEX_CORE_*
+        unsigned int num_out;       // lines nextLine() has returned since begin()
+        std::vector<LexError> errors;
+        // Incremental lexing
+        std::shared_ptr<SourceBuffer> edit_buf;    // edited copy of the source
+        std::vector<LexSpan> spans;     // span of each line from lex()
+        LexSpan              line_span; // span of the line nextLine() just returned
+        bool                 relexing;  // symbols go to relex_syms, not sym_table
+        std::vector<Symbol>  relex_syms;
+        // The lines after an edit move by the same amount, which is 
+        // left pending on the lines from shift_from on (see moveShift())
+        unsigned int         shift_from;
+        int32_t              shift_line;    // line numbers
+        int64_t              shift_pos;     // span start and end
+        int32_t              shift_sym;     // span sym
+        std::vector<uint32_t> label_refs;   // lines that refer to each label, by StrId
         void initVars(void);
 
     private:
@@ -64,6 +128,7 @@ class Lexer
     private:
         // Source movement
         void advance(void);
+        void jumpTo(const unsigned int pos);
         bool exhausted(void) const;
         void skipWhitespace(void);
         void skipComment(void);
@@ -76,12 +141,18 @@ class Lexer
         bool isMnemonic(void);
         bool isTrapOp(void);
         bool isValidArg(void);
+        char tokenChar(const unsigned int idx) const;
+        void setLineError(const uint8_t code, const std::string_view& arg);
         void skipLine(void);
+        void addError(void);
+        LexDfaScan dfaScan(const uint8_t state);
         
     private:
         // Symbol parse
         void scanToken(void);
         void scanString(void);
+        bool parseReg(uint16_t& reg);
+        bool parseImm(const unsigned int bits);
         void parseOpcode3Args(void);
         void parseOpcode(void);
         void parseTrapOpcode(void);
@@ -94,9 +165,36 @@ class Lexer
         SymbolTable  sym_table;
         unsigned int cur_line;
         void         resolveLabels(void);
+        void         resolveLine(LineInfo& line) const;
+        bool         isOrig(const LineInfo& line) const;
+        LexEdit      relexAll(void);
+        void         viewSource(void);
+        // Incremental lexing
+        LexSpan      getSpan(const unsigned int idx) const;
+        unsigned int findSpan(const unsigned int pos) const;
+        void         moveShift(const unsigned int idx);
+        void         applyShift(void);
+        void         countRef(const LineInfo& line, const int n);
     public:
-        // Lexing function
-        SourceInfo lex(void);
+        // Lexing function. The output stays in the lexer, use 
+        // takeSrcInfo() to move it out rather than copying it.
+        const SourceInfo& lex(void);
+        // Streaming interface. After begin(), each call to nextLine()
+        // parses and returns one more line. Labels are not resolved,
+        // callers look them up with findSymbol() as they go.
+        void begin(void);
+        bool nextLine(LineInfo& line);
+        bool findSymbol(const std::string_view& label, uint16_t& addr) const;
+        // Lex on up to num_threads threads. The source is split into 
+        // chunks at line boundaries which are lexed separately and then
+        // stitched together. The result is the same as lex().
+        const SourceInfo& lexParallel(const unsigned int num_threads, 
+                const size_t chunk_size = LEX_CHUNK_SIZE);
+        // Replace len characters at pos with text, and lex only as much
+        // as the edit affects. The lexer works on its own copy of the
+        // source from the first edit on. Moving the lines after the 
+        // edit is put off until the output is next looked at.
+        LexEdit    edit(const unsigned int pos, const unsigned int len, const std::string_view& text);
 
     public:
         Lexer(const OpcodeTable& ot);
@@ -104,20 +202,39 @@ class Lexer
         ~Lexer();
         Lexer(const Lexer& that) = delete;
 
-        // Load source from disk
+        // Load source from disk (the file is mapped, not copied)
         void loadFile(const std::string& filename);
+        // Lex a buffer owned by the caller, which must stay alive
+        // as long as anything produced by lex() is in use
+        void loadBuffer(const char* buf, const size_t len);
+        void loadBuffer(const std::string_view& buf);
         // Standard getters 
         unsigned int getSrcLength(void) const;
         std::string getFilename(void) const;
         std::string dumpSrc(void) const;
+        std::shared_ptr<const SourceBuffer> getSource(void) const;
 
         void setVerbose(const bool b);
         bool getVerbose(void) const;
+        // Keep lexing after a line with an error, rather than 
+        // stopping there. Every error is kept in getErrors().
+        void setContOnError(const bool c);
+        bool getContOnError(void) const;
+        const std::vector<LexError>& getErrors(void) const;
+        // Choose how the source is scanned. Both cores give the 
+        // same output.
+        void    setCore(const uint8_t c);
+        uint8_t getCore(void) const;
         // Dump internal info - remove 
         OpcodeTable dumpOpTable(void) const;
         unsigned int opTableSize(void) const;
-        SourceInfo  dumpSrcInfo(void) const;
+        SourceInfo  dumpSrcInfo(void);
         SymbolTable dumpSymTable(void) const;
+        // Output of the last lex() or edit(), without a copy
+        const SourceInfo&  getSourceInfo(void);
+        const SymbolTable& getSymTable(void) const;
+        const OpcodeTable& getOpTable(void) const;
+        SourceInfo         takeSrcInfo(void);
 #ifdef LEX_DEBUG 
         bool isASCII(void) const;
         char dumpchar(const unsigned int idx) const;
@@ -0,0 +1,178 @@
+/* LITERAL
+ * Numeric literals in assembly source. These are parsed straight
+ * out of the source text (no copy, no std::stoi) with a table of
+ * digit values, and the result can be checked against the width
+ * of the field it is going into.
+ *
+ *   #-12   decimal
+ *   x30FF  hex ('X' also works)
+ *   b0101  binary ('B' also works)
+ *   12     decimal with no prefix
+ *
+ * A '-' may follow the prefix (or lead a bare decimal). Values are
+ * limited to what fits in 16 bits, either signed or unsigned.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __LITERAL_HPP
+#define __LITERAL_HPP
+
+#include <cstdint>
+#include <string_view>
+
+// Parse status
+#define LEX_LIT_OK        0
+#define LEX_LIT_EMPTY     1     // no digits
+#define LEX_LIT_DIGIT     2     // a character that isn't a digit of the base
+#define LEX_LIT_OVERFLOW  3     // too large for 16 bits
+
+// Field widths
+#define LEX_LIT_IMM5      5
+#define LEX_LIT_OF6       6
+#define LEX_LIT_PC9       9
+#define LEX_LIT_PC11      11
+#define LEX_LIT_WORD      16    // signed or unsigned
+
+// Digits are accumulated up to this and then stop growing, so no
+// number of digits can wrap the value
+#define LEX_LIT_SATURATE  0x1FFFF
+
+#define LEX_LIT_NOT_DIGIT 0xFF
+
+typedef struct
+{
+    int32_t value;
+    uint8_t status;     // one of LEX_LIT_*
+} LexLiteral;
+
+typedef struct
+{
+    uint8_t val[256];
+} LexDigitTable;
+
+/*
+ * lex_build_digit_table()
+ * Value of every character as a digit, up to base 16
+ */
+constexpr LexDigitTable lex_build_digit_table(void)
+{
+    LexDigitTable t = {};
+
+    for(int c = 0; c < 256; ++c)
+    {
+        if(c >= '0' && c <= '9')
+            t.val[c] = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            t.val[c] = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            t.val[c] = c - 'A' + 10;
+        else
+            t.val[c] = LEX_LIT_NOT_DIGIT;
+    }
+
+    return t;
+}
+
+inline constexpr LexDigitTable lex_digit_table = lex_build_digit_table();
+
+/*
+ * lex_parse_digits()
+ * Parse s[pos:] as an optionally negative number in base. The loop
+ * has no early exit, a bad digit is just noted and checked for at
+ * the end.
+ */
+constexpr LexLiteral lex_parse_digits(const std::string_view& s, size_t pos, const uint32_t base)
+{
+    LexLiteral lit = {0, LEX_LIT_OK};
+    bool neg = false;
+    uint32_t mag = 0;
+    uint32_t bad = 0;
+
+    if(pos < s.size() && s[pos] == '-')
+    {
+        neg = true;
+        pos++;
+    }
+    if(pos >= s.size())
+    {
+        lit.status = LEX_LIT_EMPTY;
+        return lit;
+    }
+    for(; pos < s.size(); ++pos)
+    {
+        uint32_t d = lex_digit_table.val[(uint8_t) s[pos]];
+        bad |= (d >= base);
+        mag = mag * base + (d & 0xF);
+        mag = (mag > LEX_LIT_SATURATE) ? LEX_LIT_SATURATE : mag;
+    }
+
+    if(bad)
+        lit.status = LEX_LIT_DIGIT;
+    else if(mag > (neg ? 0x8000u : 0xFFFFu))
+        lit.status = LEX_LIT_OVERFLOW;
+    lit.value = neg ? -(int32_t) mag : (int32_t) mag;
+
+    return lit;
+}
+
+/*
+ * lex_parse_literal()
+ * Parse a literal, working out the base from the prefix
+ */
+constexpr LexLiteral lex_parse_literal(const std::string_view& s)
+{
+    if(s.empty())
+        return LexLiteral{0, LEX_LIT_EMPTY};
+
+    switch(s[0])
+    {
+        case '#':
+            return lex_parse_digits(s, 1, 10);
+        case 'x':
+        case 'X':
+            return lex_parse_digits(s, 1, 16);
+        case 'b':
+        case 'B':
+            return lex_parse_digits(s, 1, 2);
+        default:
+            return lex_parse_digits(s, 0, 10);
+    }
+}
+
+/*
+ * lex_is_literal()
+ * True if a token should be read as a literal rather than a label.
+ * Tokens starting with '#', '-' or a digit always are. Ones that
+ * start with a hex or binary prefix are if the rest are digits of
+ * that base (so 'xFF' is a literal but 'xray' is a label).
+ */
+constexpr bool lex_is_literal(const std::string_view& s)
+{
+    if(s.empty())
+        return false;
+    if(s[0] == '#' || s[0] == '-' || (s[0] >= '0' && s[0] <= '9'))
+        return true;
+    if(s[0] == 'x' || s[0] == 'X' || s[0] == 'b' || s[0] == 'B')
+    {
+        uint8_t status = lex_parse_literal(s).status;
+        return (status == LEX_LIT_OK || status == LEX_LIT_OVERFLOW) ? true : false;
+    }
+
+    return false;
+}
+
+/*
+ * lex_lit_fits()
+ * True if value fits in a field of bits. Fields narrower than a
+ * word are signed, a word takes either signed or unsigned values.
+ */
+constexpr bool lex_lit_fits(const int32_t value, const unsigned int bits)
+{
+    if(bits >= LEX_LIT_WORD)
+        return (value >= -0x8000 && value <= 0xFFFF) ? true : false;
+
+    return (value >= -(1 << (bits - 1)) && value < (1 << (bits - 1))) ? true : false;
+}
+
+#endif /*__LITERAL_HPP*/
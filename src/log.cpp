@@ -0,0 +1,391 @@
+/* LOG
+ * Logging functions.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.hpp"
+
+/*
+ * LogRing
+ * Single producer, single consumer ring of records. The producer is
+ * the thread that owns the ring, the consumer is the writer thread.
+ */
+typedef struct
+{
+    LogRecord             rec[LOG_RING_SIZE];
+    std::atomic<uint64_t> head;     // next slot to write (producer)
+    std::atomic<uint64_t> tail;     // next slot to read  (consumer)
+    std::atomic<bool>     retired;  // producer has exited
+} LogRing;
+
+/*
+ * LogRingOwner
+ * Holds the calling thread's ring, and retires it when the thread
+ * exits. The ring itself is freed by the writer once it is empty.
+ */
+class LogRingOwner
+{
+    public:
+        LogRing* ring;
+
+    public:
+        LogRingOwner() : ring(nullptr) {}
+        ~LogRingOwner()
+        {
+            if(this->ring != nullptr)
+                this->ring->retired.store(true, std::memory_order_release);
+            this->ring = nullptr;
+        }
+};
+
+/*
+ * Logger
+ * Owns the rings and the writer thread
+ */
+class Logger
+{
+    private:
+        std::mutex              ring_mutex;     // guards rings and output
+        std::vector<LogRing*>   rings;
+        std::ostream*           os;
+        std::thread             writer;
+        std::mutex              writer_mutex;
+        std::condition_variable writer_cv;
+        bool                    writer_started;
+        std::atomic<bool>       stop;
+        std::atomic<uint64_t>   num_dropped;
+
+    private:
+        bool drain(void);
+        void writerLoop(void);
+        void startWriter(void);
+
+    public:
+        Logger();
+        ~Logger();
+
+        LogRing* newRing(void);
+        void     wake(void);
+        void     flush(void);
+        void     setOutput(std::ostream* os);
+        void     drop(void);
+        uint64_t numDropped(void) const;
+        unsigned int numRings(void);
+};
+
+Logger::Logger()
+{
+    this->os             = &std::cout;
+    this->writer_started = false;
+    this->stop           = false;
+    this->num_dropped    = 0;
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->writer_mutex);
+        this->stop = true;
+    }
+    this->writer_cv.notify_one();
+    if(this->writer.joinable())
+        this->writer.join();
+    this->drain();
+    this->os->flush();
+    // Rings that aren't retired are left allocated, since a thread 
+    // may still be running (and logging) during static destruction
+}
+
+/*
+ * drain()
+ * Format and write everything currently in the rings, and free the
+ * rings of threads that have exited. Returns true if anything was 
+ * written.
+ */
+bool Logger::drain(void)
+{
+    bool wrote = false;
+    std::lock_guard<std::mutex> lock(this->ring_mutex);
+
+    for(unsigned int idx = 0; idx < this->rings.size(); )
+    {
+        LogRing* ring = this->rings[idx];
+        // Retired is read before head, so that everything pushed 
+        // before the ring was retired is seen here
+        bool     retired = ring->retired.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        while(tail != head)
+        {
+            *this->os << log_format(ring->rec[tail & (LOG_RING_SIZE - 1)]);
+            tail++;
+            wrote = true;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        if(retired)
+        {
+            delete ring;
+            this->rings[idx] = this->rings.back();
+            this->rings.pop_back();
+        }
+        else
+            idx++;
+    }
+    if(wrote)
+        this->os->flush();
+
+    return wrote;
+}
+
+/*
+ * writerLoop()
+ */
+void Logger::writerLoop(void)
+{
+    while(!this->stop)
+    {
+        if(this->drain())
+            continue;
+        std::unique_lock<std::mutex> lock(this->writer_mutex);
+        this->writer_cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+/*
+ * startWriter()
+ */
+void Logger::startWriter(void)
+{
+    std::lock_guard<std::mutex> lock(this->writer_mutex);
+    if(this->writer_started)
+        return;
+    this->writer = std::thread(&Logger::writerLoop, this);
+    this->writer_started = true;
+}
+
+/*
+ * newRing()
+ * Make a ring for the calling thread
+ */
+LogRing* Logger::newRing(void)
+{
+    LogRing* ring = new LogRing;
+    ring->head    = 0;
+    ring->tail    = 0;
+    ring->retired = false;
+    {
+        std::lock_guard<std::mutex> lock(this->ring_mutex);
+        this->rings.push_back(ring);
+    }
+    this->startWriter();
+
+    return ring;
+}
+
+/*
+ * wake()
+ */
+void Logger::wake(void)
+{
+    this->writer_cv.notify_one();
+}
+
+/*
+ * flush()
+ */
+void Logger::flush(void)
+{
+    this->drain();
+}
+
+/*
+ * setOutput()
+ */
+void Logger::setOutput(std::ostream* os)
+{
+    this->drain();
+    std::lock_guard<std::mutex> lock(this->ring_mutex);
+    this->os = (os == nullptr) ? &std::cout : os;
+}
+
+void Logger::drop(void)
+{
+    this->num_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Logger::numDropped(void) const
+{
+    return this->num_dropped.load(std::memory_order_relaxed);
+}
+
+unsigned int Logger::numRings(void)
+{
+    std::lock_guard<std::mutex> lock(this->ring_mutex);
+    return this->rings.size();
+}
+
+static Logger& get_logger(void)
+{
+    static Logger logger;
+    return logger;
+}
+
+/*
+ * log_push()
+ */
+bool log_push(const LogRecord& r)
+{
+    static thread_local LogRingOwner owner;
+    Logger& logger = get_logger();
+
+    if(owner.ring == nullptr)
+        owner.ring = logger.newRing();
+    LogRing* ring = owner.ring;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if(head - tail >= LOG_RING_SIZE)
+    {
+        logger.drop();
+        return false;
+    }
+    ring->rec[head & (LOG_RING_SIZE - 1)] = r;
+    ring->head.store(head + 1, std::memory_order_release);
+    // Only bother the writer when the ring is getting full, otherwise
+    // let it pick the records up on its next poll
+    if(head - tail == LOG_RING_SIZE / 2)
+        logger.wake();
+
+    return true;
+}
+
+/*
+ * log_format()
+ */
+std::string log_format(const LogRecord& r)
+{
+    std::string out;
+    const char* f = r.format->fmt;
+    unsigned int arg_idx = 0;
+    char buf[32];
+
+    out.reserve(64);
+    out += "[";
+    out += r.format->func;
+    out += "] ";
+
+    while(*f != '\0')
+    {
+        if(*f != '%')
+        {
+            out += *f++;
+            continue;
+        }
+        f++;
+        if(*f == '%')
+        {
+            out += *f++;
+            continue;
+        }
+
+        // Flags and width
+        bool zero_pad = false;
+        int width = 0;
+        if(*f == '0')
+        {
+            zero_pad = true;
+            f++;
+        }
+        while(*f >= '0' && *f <= '9')
+            width = width * 10 + (*f++ - '0');
+        char conv = *f;
+        if(conv == '\0')
+            break;
+        f++;
+
+        if(arg_idx >= r.num_args)
+        {
+            out += "<?>";
+            continue;
+        }
+
+        std::string field;
+        if(r.arg_type[arg_idx] == LOG_ARG_STR)
+            field = &r.str[r.arg[arg_idx]];
+        else
+        {
+            int64_t v = r.arg[arg_idx];
+            switch(conv)
+            {
+                case 'x':
+                    snprintf(buf, sizeof(buf), "%llx", (unsigned long long) v);
+                    break;
+                case 'X':
+                    snprintf(buf, sizeof(buf), "%llX", (unsigned long long) v);
+                    break;
+                case 'u':
+                    snprintf(buf, sizeof(buf), "%llu", (unsigned long long) v);
+                    break;
+                case 'c':
+                    buf[0] = (char) v;
+                    buf[1] = '\0';
+                    break;
+                default:
+                    snprintf(buf, sizeof(buf), "%lld", (long long) v);
+                    break;
+            }
+            field = buf;
+        }
+        arg_idx++;
+
+        if((int) field.size() < width)
+            out.append(width - field.size(), zero_pad ? '0' : ' ');
+        out += field;
+    }
+    out += "\n";
+
+    return out;
+}
+
+/*
+ * logFlush()
+ */
+void logFlush(void)
+{
+    get_logger().flush();
+}
+
+/*
+ * logSetOutput()
+ */
+void logSetOutput(std::ostream* os)
+{
+    get_logger().setOutput(os);
+}
+
+/*
+ * logNumDropped()
+ */
+uint64_t logNumDropped(void)
+{
+    return get_logger().numDropped();
+}
+
+/*
+ * logNumRings()
+ */
+unsigned int logNumRings(void)
+{
+    return get_logger().numRings();
+}
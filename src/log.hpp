@@ -1,6 +1,17 @@
 /* LOG
- * Logging functions. Most of this is taken from 
- * https://stackoverflow.com/questions/19415845/a-better-log-macro-using-template-metaprogramming#19452415
+ * Logging functions.
+ *
+ * Log statements don't format anything on the calling thread. Each
+ * call site has a static LogFormat (which acts as the format id) and
+ * a log call just copies a pointer to that plus the raw argument
+ * values into a lock-free ring buffer owned by the calling thread.
+ * A background writer thread drains the rings, formats the records
+ * and writes them out. If a ring is full the record is dropped
+ * (and counted) rather than blocking the caller.
+ * When a thread exits its ring is retired, and the writer frees 
+ * it once everything in it has been written.
+ *
+ * Levels below LOG_LEVEL are removed at compile time.
  *
  * Stefan Wong 2018
  */
@@ -8,54 +19,205 @@
 #ifndef __LOG_HPP
 #define __LOG_HPP
 
-struct None { };
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <type_traits>
+
+// Log levels
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE  4
+
+// Minimum level that gets compiled in
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
 
-template <typename First,typename Second>
-struct Pair {
-  First first;
-  Second second;
-};
+// Sizes
+#define LOG_MAX_ARGS  6
+#define LOG_STR_SIZE  64        // space for string arguments in a record
+#define LOG_RING_SIZE 4096      // records per thread, must be power of 2
 
-template <typename List>
-struct LogData {
-  List list;
-};
+// Argument types
+#define LOG_ARG_INT 0
+#define LOG_ARG_STR 1
 
-template <typename Begin,typename Value>
-LogData<Pair<Begin,const Value &>>
-  operator<<(LogData<Begin> begin,const Value &value)
+/*
+ * LogFormat
+ * One of these exists (statically) for each log call site. The
+ * format string takes printf style conversions (%d %u %x %X %c %s
+ * with optional zero pad and width).
+ */
+typedef struct
 {
-  return {{begin.list,value}};
+    int         level;
+    const char* func;
+    const char* fmt;
+} LogFormat;
+
+/*
+ * LogRecord
+ * A single unformatted log entry
+ */
+typedef struct
+{
+    const LogFormat* format;
+    uint8_t          num_args;
+    uint8_t          arg_type[LOG_MAX_ARGS];
+    int64_t          arg[LOG_MAX_ARGS];     // value, or offset into str
+    uint16_t         str_len;
+    char             str[LOG_STR_SIZE];
+} LogRecord;
+
+// Packing of arguments into a record. Once the string space is 
+// full the rest of the string arguments are empty, pointing at the 
+// terminator of the last one.
+inline void log_pack_str(LogRecord& r, const char* s, size_t len)
+{
+    r.arg_type[r.num_args] = LOG_ARG_STR;
+    if(r.str_len >= LOG_STR_SIZE)
+    {
+        r.arg[r.num_args] = LOG_STR_SIZE - 1;
+        r.num_args++;
+        return;
+    }
+    size_t avail = LOG_STR_SIZE - r.str_len - 1;
+    if(len > avail)
+        len = avail;
+    r.arg[r.num_args]      = r.str_len;
+    std::memcpy(&r.str[r.str_len], s, len);
+    r.str_len += len;
+    r.str[r.str_len++] = '\0';
+    r.num_args++;
 }
 
-template <typename Begin,size_t n>
-LogData<Pair<Begin,const char *>>
-  operator<<(LogData<Begin> begin,const char (&value)[n])
+inline void log_pack(LogRecord& r) {}
+
+// Integer arguments are anything integral or an enum. Other types 
+// (floating point, pointers) have no conversion and won't compile.
+template <typename T>
+using log_int_t = std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>;
+
+template <typename T, typename... Rest>
+log_int_t<T> log_pack(LogRecord& r, const T& val, const Rest&... rest);
+template <typename... Rest>
+void log_pack(LogRecord& r, const char* val, const Rest&... rest);
+template <typename... Rest>
+void log_pack(LogRecord& r, char* val, const Rest&... rest);
+template <typename... Rest>
+void log_pack(LogRecord& r, const std::string& val, const Rest&... rest);
+template <typename... Rest>
+void log_pack(LogRecord& r, const std::string_view& val, const Rest&... rest);
+
+// Integer arguments
+template <typename T, typename... Rest>
+log_int_t<T> log_pack(LogRecord& r, const T& val, const Rest&... rest)
 {
-  return {{begin.list,value}};
+    if(r.num_args < LOG_MAX_ARGS)
+    {
+        r.arg_type[r.num_args] = LOG_ARG_INT;
+        r.arg[r.num_args]      = (int64_t) val;
+        r.num_args++;
+    }
+    log_pack(r, rest...);
 }
 
-inline void printList(std::ostream &os,None)
+// String arguments are copied into the record. String literals 
+// decay to const char*.
+template <typename... Rest>
+void log_pack(LogRecord& r, const char* val, const Rest&... rest)
 {
+    if(r.num_args < LOG_MAX_ARGS)
+        log_pack_str(r, val, std::strlen(val));
+    log_pack(r, rest...);
 }
 
+template <typename... Rest>
+void log_pack(LogRecord& r, char* val, const Rest&... rest)
+{
+    log_pack(r, (const char*) val, rest...);
+}
+
+template <typename... Rest>
+void log_pack(LogRecord& r, const std::string& val, const Rest&... rest)
+{
+    if(r.num_args < LOG_MAX_ARGS)
+        log_pack_str(r, val.data(), val.size());
+    log_pack(r, rest...);
+}
 
-template <typename Begin,typename Last>
-void printList(std::ostream &os,const Pair<Begin,Last> &data)
+template <typename... Rest>
+void log_pack(LogRecord& r, const std::string_view& val, const Rest&... rest)
 {
-  printList(os,data.first);
-  os << data.second;
+    if(r.num_args < LOG_MAX_ARGS)
+        log_pack_str(r, val.data(), val.size());
+    log_pack(r, rest...);
 }
 
-template <typename List>
-void log(const char *file,int line,const LogData<List> &data)
+// Write a record into the calling thread's ring
+bool log_push(const LogRecord& r);
+
+template <typename... Args>
+void log_record(const LogFormat* format, const Args&... args)
 {
-  std::cout << file << " (" << line << "): ";
-  printList(std::cout,data.list);
-  std::cout << "\n";
+    LogRecord r;
+    r.format   = format;
+    r.num_args = 0;
+    r.str_len  = 0;
+    log_pack(r, args...);
+    log_push(r);
 }
 
+// Format a record into a string (done by the writer thread)
+std::string log_format(const LogRecord& r);
+
+/*
+ * Logger control. These are for the application, not for the
+ * code doing the logging.
+ */
+// Wait until everything logged so far has been written
+void     logFlush(void);
+// Set where records are written (default std::cout)
+void     logSetOutput(std::ostream* os);
+// Number of records dropped because a ring was full
+uint64_t logNumDropped(void);
+// Number of rings held, one for each thread that has logged and 
+// is still running (or whose records haven't all been written)
+unsigned int logNumRings(void);
+
+// Log call macros
+#define LOG_AT(lvl, fmtstr, ...) do { \
+    static const LogFormat log_call_fmt_ = {lvl, __FUNCTION__, fmtstr}; \
+    log_record(&log_call_fmt_, ##__VA_ARGS__); \
+} while(0)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmtstr, ...) LOG_AT(LOG_LEVEL_DEBUG, fmtstr, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmtstr, ...) do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmtstr, ...) LOG_AT(LOG_LEVEL_INFO, fmtstr, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmtstr, ...) do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmtstr, ...) LOG_AT(LOG_LEVEL_WARN, fmtstr, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmtstr, ...) do {} while(0)
+#endif
 
-#define LOG(x) (log(__FILE__,__LINE__,LogData<None>() << x))
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmtstr, ...) LOG_AT(LOG_LEVEL_ERROR, fmtstr, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmtstr, ...) do {} while(0)
+#endif
 
 #endif /*__LOG_HPP*/
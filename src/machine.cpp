@@ -6,6 +6,56 @@
 
 #include "machine.hpp"
 
+/*
+ * AddrBitmap
+ */
+AddrBitmap::AddrBitmap()
+{
+    this->clearAll();
+}
+
+AddrBitmap::~AddrBitmap() {} 
+
+/*
+ * set()
+ * Set the bit for an address
+ */
+void AddrBitmap::set(const uint16_t adr)
+{
+    if(!this->test(adr))
+        this->num_set++;
+    this->words[adr >> 6] |= (uint64_t) 1 << (adr & 0x3F);
+}
+
+/*
+ * clear()
+ * Clear the bit for an address
+ */
+void AddrBitmap::clear(const uint16_t adr)
+{
+    if(this->test(adr))
+        this->num_set--;
+    this->words[adr >> 6] &= ~((uint64_t) 1 << (adr & 0x3F));
+}
+
+/*
+ * clearAll()
+ */
+void AddrBitmap::clearAll(void)
+{
+    for(unsigned int w = 0; w < ADDR_BITMAP_WORDS; ++w)
+        this->words[w] = 0;
+    this->num_set = 0;
+}
+
+/*
+ * numSet()
+ * Number of addresses with their bit set
+ */
+unsigned int AddrBitmap::numSet(void) const
+{
+    return this->num_set;
+}
 
 Machine::Machine()
 {
@@ -45,7 +45,7 @@ template <typename T> class MTrace
 template <typename T> MTrace<T>::MTrace(const unsigned int size)
 {
     this->trace_size = size;
-    this->buffer.reserve(this->trace_size);
+    this->buffer.resize(this->trace_size);
     this->trace_ptr = 0;
 }
 
@@ -58,9 +58,7 @@ template <typename T> MTrace<T>::MTrace(const MTrace<T>& that)
     this->trace_size = that.trace_size;
     this->trace_ptr  = that.trace_ptr;
     // Copy the trace 
-    this->buffer.reserve(this->trace_size);
-    for(unsigned t = 0; t < this->buffer.size(); ++t)
-        this->buffer[t] = that.buffer[t];
+    this->buffer = that.buffer;
 }
 
 /*
@@ -129,8 +127,8 @@ template <typename T> T MTrace<T>::get(const unsigned idx) const
  */
 template <typename T> void MTrace<T>::clear(void)
 {
-    this->buffer.erase(this->buffer.begin(), this->buffer.end());
-    this->buffer.reserve(this->trace_size);
+    this->buffer.assign(this->trace_size, T());
+    this->trace_ptr = 0;
 }
 
 /*
@@ -161,6 +159,36 @@ template <typename T> bool MTrace<T>::isEqual(const MTrace<T>& that)
 }
 
 
+/*
+ * AddrBitmap
+ * One bit for each address in a 16-bit address space. Used for
+ * breakpoints and watchpoints, where the only thing the run loop 
+ * needs to do is test a single bit.
+ */
+#define ADDR_BITMAP_BITS  65536
+#define ADDR_BITMAP_WORDS (ADDR_BITMAP_BITS / 64)
+
+class AddrBitmap
+{
+    private:
+        uint64_t     words[ADDR_BITMAP_WORDS];
+        unsigned int num_set;
+
+    public:
+        AddrBitmap();
+        ~AddrBitmap();
+
+        void         set(const uint16_t adr);
+        void         clear(const uint16_t adr);
+        void         clearAll(void);
+        unsigned int numSet(void) const;
+
+        bool test(const uint16_t adr) const
+        {
+            return (this->words[adr >> 6] >> (adr & 0x3F)) & 0x1;
+        }
+};
+
 /*
  * MACHINE
  * Generic machine object
@@ -1,4 +1,4 @@
-/* OPCODE 
+/* OPCODE
  * Opcode structures
  *
  * Stefan Wong 2018
@@ -9,76 +9,53 @@
 #include <iomanip>
 #include "opcode.hpp"
 
-OpcodeTable::OpcodeTable() {} 
-
-OpcodeTable::~OpcodeTable() {} 
-
-void OpcodeTable::add(const Opcode& o)
-{
-    this->op_list.push_back(o);
-}
-
-// TODO : something faster than linear search
-// LC3 is small enough to get away with this but may as well
-// come back and do it properly once things are working
-void OpcodeTable::get(const std::string& mnemonic, Opcode& o) const
+/*
+ * add()
+ * Add an opcode to the end of the table
+ */
+int OpcodeTable::add(const Opcode& o)
 {
-    unsigned int idx;
-
-    for(idx = 0; idx < this->op_list.size(); idx++)
+    if(this->num_ops >= OPCODE_TABLE_MAX)
     {
-        if(mnemonic == this->op_list[idx].mnemonic)
-        {
-            o.opcode   = this->op_list[idx].opcode;
-            o.mnemonic = this->op_list[idx].mnemonic;
-            return;
-            //o = this->op_list[idx];
-        }
+        std::cerr << "[" << __FUNCTION__ << "] table is full ("
+            << OPCODE_TABLE_MAX << " opcodes), cannot add "
+            << o.mnemonic << std::endl;
+        return -1;
     }
-    o.opcode = 0;
-    o.mnemonic = "M_INVALID";
+    this->insert(o);
+
+    return 0;
 }
 
-void OpcodeTable::get(const uint16_t opcode, Opcode& o) const
+void OpcodeTable::get(const std::string_view& mnemonic, Opcode& o) const
 {
-    // TODO : same as above but 'search by opcode'
-    unsigned int idx;
+    int idx = this->find(mnemonic);
 
-    for(idx = 0; idx < this->op_list.size(); idx++)
+    if(idx == OPCODE_NOT_FOUND)
     {
-        if(opcode == this->op_list[idx].opcode)
-        {
-            //o = this->op_list[idx];
-            o.opcode   = this->op_list[idx].opcode;
-            o.mnemonic = this->op_list[idx].mnemonic;
-            return;
-        }
+        o.opcode   = 0;
+        o.mnemonic = OPCODE_INVALID_MNEMONIC;
     }
-    o.opcode = 0;
-    o.mnemonic = "M_INVALID";
+    else
+        o = this->op_list[idx];
 }
 
-std::string OpcodeTable::getMnemonic(const uint16_t opcode) const
+void OpcodeTable::get(const uint16_t opcode, Opcode& o) const
 {
-    // At some point maybe I should deal with all these linear scans..
-    for(unsigned int idx = 0; idx < this->op_list.size(); ++idx)
+    int idx = this->find(opcode);
+
+    if(idx == OPCODE_NOT_FOUND)
     {
-        if(opcode == this->op_list[idx].opcode)
-            return this->op_list[idx].mnemonic;
+        o.opcode   = 0;
+        o.mnemonic = OPCODE_INVALID_MNEMONIC;
     }
-
-    return "OP_INVAILD";
-}
-
-void OpcodeTable::getIdx(const unsigned int idx, Opcode& o) const
-{
-    if(idx < this->op_list.size())
+    else
         o = this->op_list[idx];
 }
 
 void OpcodeTable::init(void)
 {
-    this->op_list.clear();
+    *this = OpcodeTable();
 }
 
 // Print the entire contents of the OpcodeTable to console
@@ -86,18 +63,13 @@ void OpcodeTable::print(void) const
 {
     unsigned int idx;
 
-    std::cout << this->op_list.size() << " instructions in table" << std::endl;
-    for(idx = 0; idx < this->op_list.size(); idx++)
+    std::cout << this->num_ops << " instructions in table" << std::endl;
+    for(idx = 0; idx < this->num_ops; idx++)
     {
-        std::cout << "Op " << std::dec << std::setw(4) << std::setfill(' ') << 
-            idx + 1 << " : [" << std::setw(5) << std::setfill(' ') << 
-            this->op_list[idx].mnemonic.c_str() << "] 0x" << 
+        std::cout << "Op " << std::dec << std::setw(4) << std::setfill(' ') <<
+            idx + 1 << " : [" << std::setw(5) << std::setfill(' ') <<
+            this->op_list[idx].mnemonic << "] 0x" <<
             std::hex << std::setw(2) << std::setfill('0') <<
             this->op_list[idx].opcode << std::endl;
     }
 }
-
-unsigned int OpcodeTable::getNumOps(void) const
-{
-    return this->op_list.size();
-}
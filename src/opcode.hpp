@@ -1,4 +1,4 @@
-/* OPCODE 
+/* OPCODE
  * Opcode structures
  *
  * Stefan Wong 2018
@@ -7,41 +7,133 @@
 #ifndef __OPCODE_HPP
 #define __OPCODE_HPP
 
-#include <string>
-#include <vector>
+#include <string_view>
 #include <cstdint>
 
-typedef struct 
+#define OPCODE_TABLE_MAX   32       // most entries an OpcodeTable can hold
+#define OPCODE_NUM_FIELDS  16       // values of the 4 bit opcode field
+#define OPCODE_NOT_FOUND   -1
+#define OPCODE_INVALID_MNEMONIC "OP_INVALID"
+
+/*
+ * Opcode
+ * Mnemonics are views of strings that must outlive the table,
+ * which for string literals they always do.
+ */
+typedef struct
 {
-    uint16_t    opcode;
-    std::string mnemonic;
+    uint16_t         opcode;
+    std::string_view mnemonic;
 } Opcode;
 
-/* 
- * OpcodeTable 
+/*
+ * OpcodeTable
  *
- * Holds a list of Opcode structures.
+ * Holds a list of Opcode structures. The table is a fixed size
+ * object with no allocation, so it can be built at compile time
+ * from a list of opcodes and shared (see lc3_op_table), and copying
+ * one is cheap. Lookups return an index into the table or a
+ * reference to an entry rather than copying it out. Opcodes that fit
+ * in the 4 bit opcode field are found through a direct index.
  */
 class OpcodeTable
 {
     private:
-        std::vector<Opcode> op_list;
-        
+        Opcode       op_list[OPCODE_TABLE_MAX];
+        unsigned int num_ops;
+        int8_t       op_idx[OPCODE_NUM_FIELDS];     // first entry for each opcode field
+
+    private:
+        constexpr void insert(const Opcode& o)
+        {
+            if(o.opcode < OPCODE_NUM_FIELDS && this->op_idx[o.opcode] == OPCODE_NOT_FOUND)
+                this->op_idx[o.opcode] = this->num_ops;
+            this->op_list[this->num_ops] = o;
+            this->num_ops++;
+        }
+
     public:
-        OpcodeTable();
-        ~OpcodeTable();
-        void add(const Opcode& o);
-        void get(const std::string& mnemonic, Opcode& o) const;
+        constexpr OpcodeTable() : op_list{}, num_ops(0), op_idx{}
+        {
+            for(int8_t& idx : this->op_idx)
+                idx = OPCODE_NOT_FOUND;
+        }
+
+        template <size_t N> constexpr OpcodeTable(const Opcode (&ops)[N]) : OpcodeTable()
+        {
+            static_assert(N <= OPCODE_TABLE_MAX, "too many opcodes for an OpcodeTable");
+            for(const Opcode& o : ops)
+                this->insert(o);
+        }
+
+        int  add(const Opcode& o);
+
+        /*
+         * find()
+         * Index of the first entry with this mnemonic or opcode,
+         * or OPCODE_NOT_FOUND
+         */
+        constexpr int find(const std::string_view& mnemonic) const
+        {
+            for(unsigned int idx = 0; idx < this->num_ops; ++idx)
+            {
+                if(mnemonic == this->op_list[idx].mnemonic)
+                    return idx;
+            }
+
+            return OPCODE_NOT_FOUND;
+        }
+
+        constexpr int find(const uint16_t opcode) const
+        {
+            if(opcode < OPCODE_NUM_FIELDS)
+                return this->op_idx[opcode];
+            for(unsigned int idx = 0; idx < this->num_ops; ++idx)
+            {
+                if(opcode == this->op_list[idx].opcode)
+                    return idx;
+            }
+
+            return OPCODE_NOT_FOUND;
+        }
+
+        /*
+         * getIdx()
+         * Entry at idx, or an empty Opcode (with the invalid 
+         * mnemonic) if there is no entry there
+         */
+        constexpr Opcode getIdx(const unsigned int idx) const
+        {
+            if(idx >= this->num_ops)
+                return Opcode{0, OPCODE_INVALID_MNEMONIC};
+            return this->op_list[idx];
+        }
+
+        /*
+         * getMnemonic()
+         * Mnemonic of the first entry for opcode, or
+         * OPCODE_INVALID_MNEMONIC
+         */
+        constexpr std::string_view getMnemonic(const uint16_t opcode) const
+        {
+            int idx = this->find(opcode);
+
+            return (idx == OPCODE_NOT_FOUND) ? OPCODE_INVALID_MNEMONIC : this->op_list[idx].mnemonic;
+        }
+
+        // Copy out the entry found, or an invalid Opcode
+        void get(const std::string_view& mnemonic, Opcode& o) const;
         void get(const uint16_t opcode, Opcode& o) const;
-        std::string getMnemonic(const uint16_t opcode) const;
-        void getIdx(const unsigned int idx, Opcode& o) const;
         void init(void);
 
         // TODO: create toString() method
         void print(void) const;
 
-        // generic getters 
-        unsigned int getNumOps(void) const;
+        // generic getters
+        constexpr unsigned int getNumOps(void) const
+        {
+            return this->num_ops;
+        }
 
 };
 
@@ -0,0 +1,282 @@
+/* PERF
+ * Host hardware counters for measuring the emulator itself.
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include "perf.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif /*__linux__*/
+
+static const char* perf_counter_names[PERF_NUM_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "branch-misses",
+    "L1D-misses",
+    "LLC-misses"
+};
+
+const char* perfCounterName(const int counter)
+{
+    if(counter < 0 || counter >= PERF_NUM_COUNTERS)
+        return "invalid";
+    return perf_counter_names[counter];
+}
+
+/*
+ * PerfSample
+ */
+PerfSample::PerfSample()
+{
+    this->init();
+}
+
+PerfSample::~PerfSample() {}
+
+void PerfSample::init(void)
+{
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        this->count[c] = 0;
+        this->valid[c] = false;
+    }
+}
+
+/*
+ * accumulate()
+ * Add the counts from another sample into this one. A counter
+ * is valid if it was valid in either sample.
+ */
+void PerfSample::accumulate(const PerfSample& that)
+{
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(!that.valid[c])
+            continue;
+        this->count[c] += that.count[c];
+        this->valid[c] = true;
+    }
+}
+
+bool PerfSample::anyValid(void) const
+{
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->valid[c])
+            return true;
+    }
+
+    return false;
+}
+
+double PerfSample::perInstr(const int counter, const uint64_t num_instr) const
+{
+    if(counter < 0 || counter >= PERF_NUM_COUNTERS)
+        return 0.0;
+    if(!this->valid[counter] || num_instr == 0)
+        return 0.0;
+
+    return (double) this->count[counter] / (double) num_instr;
+}
+
+std::string PerfSample::toString(const uint64_t num_instr) const
+{
+    std::ostringstream oss;
+
+    if(!this->anyValid())
+    {
+        oss << "host counters unavailable" << std::endl;
+        return oss.str();
+    }
+    oss << "Counter          Total           Per LC3 instr" << std::endl;
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        oss << std::left << std::setw(16) << std::setfill(' ') << perf_counter_names[c] << " ";
+        if(!this->valid[c])
+        {
+            oss << "n/a" << std::endl;
+            continue;
+        }
+        oss << std::left << std::setw(15) << std::dec << this->count[c] << " ";
+        oss << std::fixed << std::setprecision(3) << this->perInstr(c, num_instr) << std::endl;
+    }
+
+    return oss.str();
+}
+
+/*
+ * PerfCounters
+ */
+PerfCounters::PerfCounters()
+{
+    this->running = false;
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+        this->fd[c] = -1;
+    this->open_counters();
+}
+
+PerfCounters::~PerfCounters()
+{
+    this->close_counters();
+}
+
+#ifdef __linux__
+static int perf_event_open(struct perf_event_attr* attr)
+{
+    // Measure this thread, on any CPU
+    return (int) syscall(__NR_perf_event_open, attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static uint64_t perf_cache_config(const uint64_t cache, const uint64_t op, const uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+#endif /*__linux__*/
+
+/*
+ * open_counters()
+ * Open each of the host counters. Any counter that can't be opened
+ * is left with an fd of -1 and is reported as invalid in samples.
+ */
+void PerfCounters::open_counters(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    uint32_t types[PERF_NUM_COUNTERS] = {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HW_CACHE
+    };
+    uint64_t configs[PERF_NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        perf_cache_config(PERF_COUNT_HW_CACHE_L1D,
+                          PERF_COUNT_HW_CACHE_OP_READ,
+                          PERF_COUNT_HW_CACHE_RESULT_MISS),
+        perf_cache_config(PERF_COUNT_HW_CACHE_LL,
+                          PERF_COUNT_HW_CACHE_OP_READ,
+                          PERF_COUNT_HW_CACHE_RESULT_MISS)
+    };
+
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = types[c];
+        attr.config         = configs[c];
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                              PERF_FORMAT_TOTAL_TIME_RUNNING;
+        this->fd[c] = perf_event_open(&attr);
+    }
+#endif /*__linux__*/
+}
+
+void PerfCounters::close_counters(void)
+{
+#ifdef __linux__
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->fd[c] >= 0)
+            close(this->fd[c]);
+        this->fd[c] = -1;
+    }
+#endif /*__linux__*/
+}
+
+bool PerfCounters::isAvailable(void) const
+{
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->fd[c] >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * start()
+ * Zero and enable all open counters
+ */
+void PerfCounters::start(void)
+{
+#ifdef __linux__
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->fd[c] < 0)
+            continue;
+        ioctl(this->fd[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(this->fd[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif /*__linux__*/
+    this->running = true;
+}
+
+/*
+ * stop()
+ * Disable all open counters. Values are kept until the next start()
+ */
+void PerfCounters::stop(void)
+{
+    if(!this->running)
+        return;
+#ifdef __linux__
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->fd[c] < 0)
+            continue;
+        ioctl(this->fd[c], PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif /*__linux__*/
+    this->running = false;
+}
+
+/*
+ * read()
+ * Read the current counter values. If the kernel had to multiplex
+ * a counter then the value is scaled up by enabled/running time.
+ */
+PerfSample PerfCounters::read(void) const
+{
+    PerfSample sample;
+
+#ifdef __linux__
+    uint64_t buf[3];        // value, time enabled, time running
+    for(int c = 0; c < PERF_NUM_COUNTERS; ++c)
+    {
+        if(this->fd[c] < 0)
+            continue;
+        if(::read(this->fd[c], buf, sizeof(buf)) != sizeof(buf))
+            continue;
+        if(buf[2] == 0)
+        {
+            // Never scheduled - only valid if never enabled either
+            sample.count[c] = 0;
+            sample.valid[c] = (buf[1] == 0);
+            continue;
+        }
+        if(buf[2] < buf[1])
+            sample.count[c] = (uint64_t) ((double) buf[0] * ((double) buf[1] / (double) buf[2]));
+        else
+            sample.count[c] = buf[0];
+        sample.valid[c] = true;
+    }
+#endif /*__linux__*/
+
+    return sample;
+}
@@ -0,0 +1,74 @@
+/* PERF
+ * Host hardware counters for measuring the emulator itself.
+ * On Linux these are read through perf_event_open(). Where the
+ * counters can't be opened (no kernel support, restrictive
+ * perf_event_paranoid, non-Linux host) the counters just report
+ * themselves as unavailable.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __PERF_HPP
+#define __PERF_HPP
+
+#include <cstdint>
+#include <string>
+
+// Counter indices
+#define PERF_CYCLES        0
+#define PERF_INSTRUCTIONS  1
+#define PERF_BRANCH_MISSES 2
+#define PERF_L1D_MISSES    3
+#define PERF_LLC_MISSES    4
+#define PERF_NUM_COUNTERS  5
+
+/*
+ * PerfSample
+ * Values of the host counters over one (or more) measured intervals
+ */
+class PerfSample
+{
+    public:
+        uint64_t count[PERF_NUM_COUNTERS];
+        bool     valid[PERF_NUM_COUNTERS];
+
+    public:
+        PerfSample();
+        ~PerfSample();
+        void        init(void);
+        void        accumulate(const PerfSample& that);
+        bool        anyValid(void) const;
+        // Counter value normalized over some number of emulated instructions
+        double      perInstr(const int counter, const uint64_t num_instr) const;
+        std::string toString(const uint64_t num_instr) const;
+};
+
+/*
+ * PerfCounters
+ * Wraps a set of host hardware counters. Counters are opened
+ * individually so that a host which lacks (say) an LLC event still
+ * reports cycles and instructions.
+ */
+class PerfCounters
+{
+    private:
+        int  fd[PERF_NUM_COUNTERS];
+        bool running;
+        void open_counters(void);
+        void close_counters(void);
+
+    public:
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters& that) = delete;
+
+        bool       isAvailable(void) const;
+        void       start(void);
+        void       stop(void);
+        PerfSample read(void) const;
+};
+
+// Name of a counter for display
+const char* perfCounterName(const int counter);
+
+#endif /*__PERF_HPP*/
@@ -0,0 +1,186 @@
+/* SCAN
+ * Bulk scanning of source text for the lexer.
+ *
+ * Stefan Wong 2018
+ */
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "scan.hpp"
+#include "charclass.hpp"
+
+/*
+ * lex_scan_blank_scalar()
+ */
+size_t lex_scan_blank_scalar(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines)
+{
+    const uint8_t mask = sep ? (LEX_CC_WHITESPACE | LEX_CC_SEPARATOR) : LEX_CC_WHITESPACE;
+
+    while(pos < len && lex_char_is(s[pos], mask))
+    {
+        if(s[pos] == '\n')
+            lines++;
+        pos++;
+    }
+
+    return pos;
+}
+
+/*
+ * lex_scan_line_end_scalar()
+ */
+size_t lex_scan_line_end_scalar(const char* s, size_t pos, const size_t len)
+{
+    while(pos < len && s[pos] != '\n' && s[pos] != '\0')
+        pos++;
+
+    return pos;
+}
+
+#if defined(__AVX2__)
+/*
+ * AVX2, 32 bytes per step
+ */
+size_t lex_scan_blank(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines)
+{
+    const __m256i v_space = _mm256_set1_epi8(' ');
+    const __m256i v_tab   = _mm256_set1_epi8('\t');
+    const __m256i v_cr    = _mm256_set1_epi8('\r');
+    const __m256i v_nl    = _mm256_set1_epi8('\n');
+    const __m256i v_comma = _mm256_set1_epi8(sep ? ',' : ' ');
+    const __m256i v_colon = _mm256_set1_epi8(sep ? ':' : ' ');
+
+    while(pos + 32 <= len)
+    {
+        __m256i v  = _mm256_loadu_si256((const __m256i*) (s + pos));
+        __m256i nl = _mm256_cmpeq_epi8(v, v_nl);
+        __m256i b  = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, v_space), _mm256_cmpeq_epi8(v, v_tab)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, v_cr), nl));
+        b = _mm256_or_si256(b,
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, v_comma), _mm256_cmpeq_epi8(v, v_colon)));
+        uint32_t nl_bits = (uint32_t) _mm256_movemask_epi8(nl);
+        uint32_t stop    = ~((uint32_t) _mm256_movemask_epi8(b));
+
+        if(stop != 0)
+        {
+            unsigned int idx = __builtin_ctz(stop);
+            lines += __builtin_popcount(nl_bits & ((1u << idx) - 1));
+            return pos + idx;
+        }
+        lines += __builtin_popcount(nl_bits);
+        pos += 32;
+    }
+
+    return lex_scan_blank_scalar(s, pos, len, sep, lines);
+}
+
+size_t lex_scan_line_end(const char* s, size_t pos, const size_t len)
+{
+    const __m256i v_nl   = _mm256_set1_epi8('\n');
+    const __m256i v_zero = _mm256_setzero_si256();
+
+    while(pos + 32 <= len)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (s + pos));
+        uint32_t stop = (uint32_t) _mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, v_nl), _mm256_cmpeq_epi8(v, v_zero)));
+        if(stop != 0)
+            return pos + __builtin_ctz(stop);
+        pos += 32;
+    }
+
+    return lex_scan_line_end_scalar(s, pos, len);
+}
+
+const char* lex_scan_impl(void)
+{
+    return "avx2";
+}
+
+#elif defined(__SSE2__)
+/*
+ * SSE2, 16 bytes per step
+ */
+size_t lex_scan_blank(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines)
+{
+    const __m128i v_space = _mm_set1_epi8(' ');
+    const __m128i v_tab   = _mm_set1_epi8('\t');
+    const __m128i v_cr    = _mm_set1_epi8('\r');
+    const __m128i v_nl    = _mm_set1_epi8('\n');
+    const __m128i v_comma = _mm_set1_epi8(sep ? ',' : ' ');
+    const __m128i v_colon = _mm_set1_epi8(sep ? ':' : ' ');
+
+    while(pos + 16 <= len)
+    {
+        __m128i v  = _mm_loadu_si128((const __m128i*) (s + pos));
+        __m128i nl = _mm_cmpeq_epi8(v, v_nl);
+        __m128i b  = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, v_space), _mm_cmpeq_epi8(v, v_tab)),
+                _mm_or_si128(_mm_cmpeq_epi8(v, v_cr), nl));
+        b = _mm_or_si128(b,
+                _mm_or_si128(_mm_cmpeq_epi8(v, v_comma), _mm_cmpeq_epi8(v, v_colon)));
+        uint32_t nl_bits = (uint32_t) _mm_movemask_epi8(nl);
+        uint32_t stop    = ~((uint32_t) _mm_movemask_epi8(b)) & 0xFFFF;
+
+        if(stop != 0)
+        {
+            unsigned int idx = __builtin_ctz(stop);
+            lines += __builtin_popcount(nl_bits & ((1u << idx) - 1));
+            return pos + idx;
+        }
+        lines += __builtin_popcount(nl_bits);
+        pos += 16;
+    }
+
+    return lex_scan_blank_scalar(s, pos, len, sep, lines);
+}
+
+size_t lex_scan_line_end(const char* s, size_t pos, const size_t len)
+{
+    const __m128i v_nl   = _mm_set1_epi8('\n');
+    const __m128i v_zero = _mm_setzero_si128();
+
+    while(pos + 16 <= len)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*) (s + pos));
+        uint32_t stop = (uint32_t) _mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, v_nl), _mm_cmpeq_epi8(v, v_zero)));
+        if(stop != 0)
+            return pos + __builtin_ctz(stop);
+        pos += 16;
+    }
+
+    return lex_scan_line_end_scalar(s, pos, len);
+}
+
+const char* lex_scan_impl(void)
+{
+    return "sse2";
+}
+
+#else
+/*
+ * No vector support
+ */
+size_t lex_scan_blank(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines)
+{
+    return lex_scan_blank_scalar(s, pos, len, sep, lines);
+}
+
+size_t lex_scan_line_end(const char* s, size_t pos, const size_t len)
+{
+    return lex_scan_line_end_scalar(s, pos, len);
+}
+
+const char* lex_scan_impl(void)
+{
+    return "scalar";
+}
+
+#endif /*__AVX2__*/
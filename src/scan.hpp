@@ -0,0 +1,45 @@
+/* SCAN
+ * Bulk scanning of source text for the lexer. These find the next
+ * character of interest 16 (SSE2) or 32 (AVX2) bytes at a time and
+ * count the newlines passed over with a popcount, so the lexer can
+ * skip blanks and comments without stepping through advance().
+ *
+ * The vector path is chosen at compile time (build with eg
+ * OPT="-O2 -mavx2" for AVX2). The scalar versions are always
+ * available and give the same results.
+ *
+ * Stefan Wong 2018
+ */
+
+#ifndef __SCAN_HPP
+#define __SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * lex_scan_blank()
+ * Index of the first character at or after pos in s[0:len] that is
+ * not whitespace (' ', '\t', '\r', '\n'), or len if there is none.
+ * When sep is true ',' and ':' are skipped as well. The number of
+ * '\n' characters passed over is added to lines.
+ */
+size_t lex_scan_blank(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines);
+
+/*
+ * lex_scan_line_end()
+ * Index of the first '\n' or '\0' at or after pos in s[0:len], or
+ * len if there is none.
+ */
+size_t lex_scan_line_end(const char* s, size_t pos, const size_t len);
+
+// Scalar versions of the above
+size_t lex_scan_blank_scalar(const char* s, size_t pos, const size_t len,
+        const bool sep, unsigned int& lines);
+size_t lex_scan_line_end_scalar(const char* s, size_t pos, const size_t len);
+
+// Name of the vector path that was compiled in
+const char* lex_scan_impl(void);
+
+#endif /*__SCAN_HPP*/
@@ -4,27 +4,562 @@
  * Stefan Wong 2018
  */
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "source.hpp"
 
+/*
+ * SOURCEBUFFER
+ */
+SourceBuffer::SourceBuffer()
+{
+    this->data     = nullptr;
+    this->size     = 0;
+    this->map_addr  = nullptr;
+    this->map_size  = 0;
+    this->gap_start = 0;
+    this->gap_len   = 0;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    this->release();
+}
+
+void SourceBuffer::release(void)
+{
+    if(this->map_addr != nullptr)
+        munmap(this->map_addr, this->map_size);
+    this->map_addr = nullptr;
+    this->map_size = 0;
+    this->copy.clear();
+    this->data      = nullptr;
+    this->size      = 0;
+    this->gap_start = 0;
+    this->gap_len   = 0;
+}
+
+/*
+ * load()
+ * Map a source file into memory. If the file can't be mapped 
+ * (eg: it isn't a regular file) it is read into a copy instead.
+ * Returns -1 if the file can't be read.
+ */
+int SourceBuffer::load(const std::string& filename)
+{
+    struct stat st;
+    int fd;
+
+    this->release();
+    fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return -1;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        // Nothing to map for an empty file 
+        if(st.st_size == 0)
+        {
+            close(fd);
+            return 0;
+        }
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED)
+        {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            this->map_addr = addr;
+            this->map_size = st.st_size;
+            this->data     = (const char*) addr;
+            this->size     = st.st_size;
+            return 0;
+        }
+    }
+    close(fd);
+
+    // Fall back to reading the whole file 
+    std::ifstream infile(filename, std::ios::binary);
+    if(!infile.good())
+        return -1;
+    std::ostringstream oss;
+    oss << infile.rdbuf();
+    this->assignCopy(oss.str());
+
+    return 0;
+}
+
+/*
+ * assign()
+ * Refer to a buffer owned by the caller. Nothing is copied.
+ */
+void SourceBuffer::assign(const char* buf, const size_t len)
+{
+    this->release();
+    this->data = buf;
+    this->size = len;
+}
+
+/*
+ * assignCopy()
+ * Take a copy of some source text
+ */
+void SourceBuffer::assignCopy(const std::string& text)
+{
+    this->release();
+    this->copy      = text;
+    this->data      = this->copy.data();
+    this->size      = this->copy.size();
+    this->gap_start = this->size;
+}
+
+/*
+ * moveGap()
+ * Move the gap in an edited copy to pos, which only moves the 
+ * text between the two
+ */
+void SourceBuffer::moveGap(const size_t pos) const
+{
+    char* buf = this->copy.data();
+
+    if(this->gap_len > 0)
+    {
+        if(pos < this->gap_start)
+            std::memmove(buf + pos + this->gap_len, buf + pos, this->gap_start - pos);
+        else if(pos > this->gap_start)
+            std::memmove(buf + this->gap_start, buf + this->gap_start + this->gap_len, pos - this->gap_start);
+    }
+    this->gap_start = pos;
+}
+
+/*
+ * growGap()
+ * Make the gap at least len long. The gap grows with the text so
+ * that growing it is rare.
+ */
+void SourceBuffer::growGap(const size_t len)
+{
+    size_t new_len = len + std::max(this->size / 2, (size_t) SRC_MIN_GAP);
+    std::string buf(this->size + new_len, '\0');
+
+    std::memcpy(&buf[0], this->copy.data(), this->gap_start);
+    std::memcpy(&buf[0] + this->gap_start + new_len, 
+                this->copy.data() + this->gap_start + this->gap_len,
+                this->size - this->gap_start);
+    this->copy.swap(buf);
+    this->gap_len = new_len;
+    this->data    = this->copy.data();
+}
+
+/*
+ * replace()
+ * Replace len characters at pos with text. The buffer is copied
+ * first if it isn't already a copy. After that this costs the 
+ * length of the edit plus the distance from the last one.
+ */
+void SourceBuffer::replace(const size_t pos, const size_t len, const std::string_view& text)
+{
+    size_t start, num;
+
+    if(this->data != this->copy.data())
+        this->assignCopy(std::string(this->view()));
+    start = std::min(pos, this->size);
+    num   = std::min(len, this->size - start);
+    this->moveGap(start);
+    this->gap_len += num;
+    this->size    -= num;
+    if(text.size() > this->gap_len)
+        this->growGap(text.size());
+    std::memcpy(this->copy.data() + this->gap_start, text.data(), text.size());
+    this->gap_start += text.size();
+    this->gap_len   -= text.size();
+    this->size      += text.size();
+}
+
+std::string_view SourceBuffer::view(void) const
+{
+    return this->prefix(this->size);
+}
+
+/*
+ * prefix()
+ * The first len characters of the text. Only the text between the
+ * gap and len is moved to get them.
+ */
+std::string_view SourceBuffer::prefix(const size_t len) const
+{
+    size_t n = std::min(len, this->size);
+
+    if(this->gap_len > 0 && this->gap_start < n)
+        this->moveGap(n);
+    return std::string_view(this->data, n);
+}
+
+size_t SourceBuffer::length(void) const
+{
+    return this->size;
+}
+
+bool SourceBuffer::isMapped(void) const
+{
+    return (this->map_addr != nullptr) ? true : false;
+}
+
+// FNV-1a, used to index labels and pooled strings
+static uint32_t source_hash(const std::string_view& s)
+{
+    uint32_t h = 2166136261u;
+
+    for(const char c : s)
+        h = (h ^ (uint8_t) c) * 16777619u;
+
+    return h;
+}
+
+/*
+ * STRINGPOOL
+ */
+StringPool::StringPool()
+{
+    this->cur_block  = nullptr;
+    this->block_used = 0;
+    this->slots.assign(SYM_MIN_SLOTS, -1);
+    // id 0 is the empty string
+    this->strs.push_back(std::string_view());
+    this->str_hash.push_back(0);
+}
+
+StringPool::~StringPool() {} 
+
+/*
+ * store()
+ * Find a home for the text of a new string
+ */
+std::string_view StringPool::store(const std::string_view& s)
+{
+    // Text in the source can be referred to where it is
+    if(this->src.size() > 0 && s.data() >= this->src.data() && 
+       s.data() + s.size() <= this->src.data() + this->src.size())
+        return s;
+
+    char* dst;
+    if(s.size() > STR_BLOCK_SIZE / 4)
+    {
+        // Big strings get a block to themselves
+        this->blocks.push_back(std::unique_ptr<char[]>(new char[s.size()]));
+        dst = this->blocks.back().get();
+    }
+    else
+    {
+        if(this->cur_block == nullptr || this->block_used + s.size() > STR_BLOCK_SIZE)
+        {
+            this->blocks.push_back(std::unique_ptr<char[]>(new char[STR_BLOCK_SIZE]));
+            this->cur_block  = this->blocks.back().get();
+            this->block_used = 0;
+        }
+        dst = this->cur_block + this->block_used;
+        this->block_used += s.size();
+    }
+    std::memcpy(dst, s.data(), s.size());
+
+    return std::string_view(dst, s.size());
+}
+
+/*
+ * rehash()
+ */
+void StringPool::rehash(const unsigned int num_slots)
+{
+    this->slots.assign(num_slots, -1);
+    for(unsigned int id = 1; id < this->strs.size(); ++id)
+    {
+        uint32_t s = this->str_hash[id] & (num_slots - 1);
+        while(this->slots[s] != -1)
+            s = (s + 1) & (num_slots - 1);
+        this->slots[s] = id;
+    }
+}
+
+/*
+ * clone()
+ * Copy of the pool, with every string keeping its id. Text in the 
+ * source is still referred to in place.
+ */
+std::shared_ptr<StringPool> StringPool::clone(void) const
+{
+    std::shared_ptr<StringPool> p = std::make_shared<StringPool>();
+
+    p->src      = this->src;
+    p->slots    = this->slots;
+    p->str_hash = this->str_hash;
+    p->strs.reserve(this->strs.size());
+    for(unsigned int id = 1; id < this->strs.size(); ++id)
+        p->strs.push_back(p->store(this->strs[id]));
+
+    return p;
+}
+
+/*
+ * assign()
+ * Make the pool the strings in text, where string id runs from 
+ * offs[id] to offs[id + 1]. The offsets must be in order and in
+ * the text, and the strings distinct. Nothing is copied or hashed.
+ */
+void StringPool::assign(const std::string_view& text, const std::vector<uint32_t>& offs)
+{
+    this->blocks.clear();
+    this->cur_block  = nullptr;
+    this->block_used = 0;
+    this->src        = text;
+    this->strs.resize(std::max(offs.size(), (size_t) 2) - 1);
+    this->strs[STR_ID_EMPTY] = std::string_view();
+    for(unsigned int id = 1; id < this->strs.size(); ++id)
+        this->strs[id] = text.substr(offs[id], offs[id + 1] - offs[id]);
+    this->str_hash.assign(1, 0);
+    this->slots.assign(SYM_MIN_SLOTS, -1);
+}
+
+/*
+ * intern()
+ * Id of a string, adding it to the pool if it isn't there already
+ */
+StrId StringPool::intern(const std::string_view& s)
+{
+    if(s.size() == 0)
+        return STR_ID_EMPTY;
+
+    return this->insert(s, source_hash(s));
+}
+
+/*
+ * index()
+ * Hash the strings that haven't been yet, which is all but the 
+ * empty string after assign()
+ */
+void StringPool::index(void)
+{
+    unsigned int num_slots = SYM_MIN_SLOTS;
+
+    this->str_hash.reserve(this->strs.size());
+    for(unsigned int id = this->str_hash.size(); id < this->strs.size(); ++id)
+        this->str_hash.push_back(source_hash(this->strs[id]));
+    while(num_slots < 2 * this->strs.size())
+        num_slots *= 2;
+    this->rehash(num_slots);
+}
+
+/*
+ * hashOf()
+ * Hash of a string, whether or not it has been indexed
+ */
+uint32_t StringPool::hashOf(const StrId id) const
+{
+    return (id < this->str_hash.size()) ? this->str_hash[id] : source_hash(this->strs[id]);
+}
+
+/*
+ * insert()
+ * Find or add a string whose hash is already known
+ */
+StrId StringPool::insert(const std::string_view& s, const uint32_t h)
+{
+    if(this->str_hash.size() != this->strs.size())
+        this->index();
+
+    uint32_t mask = this->slots.size() - 1;
+    uint32_t slot = h & mask;
+
+    while(this->slots[slot] != -1)
+    {
+        int32_t id = this->slots[slot];
+        if(this->str_hash[id] == h && this->strs[id] == s)
+            return id;
+        slot = (slot + 1) & mask;
+    }
+
+    StrId id = this->strs.size();
+    this->strs.push_back(this->store(s));
+    this->str_hash.push_back(h);
+    // keep the load factor at or below 1/2 
+    if(2 * this->strs.size() > this->slots.size())
+        this->rehash(2 * this->slots.size());
+    else
+        this->slots[slot] = id;
+
+    return id;
+}
+
+/*
+ * merge()
+ * Add all the strings from another pool. Returns the id each of 
+ * that pool's strings has in this one.
+ */
+std::vector<StrId> StringPool::merge(const StringPool& that)
+{
+    std::vector<StrId> remap(that.strs.size());
+
+    remap[STR_ID_EMPTY] = STR_ID_EMPTY;
+    for(unsigned int id = 1; id < that.strs.size(); ++id)
+        remap[id] = this->insert(that.strs[id], that.hashOf(id));
+
+    return remap;
+}
+
+/*
+ * get()
+ * Text of a string. Unknown ids give the empty string.
+ */
+std::string_view StringPool::get(const StrId id) const
+{
+    return (id < this->strs.size()) ? this->strs[id] : std::string_view();
+}
+
+unsigned int StringPool::size(void) const
+{
+    return this->strs.size();
+}
+
+/*
+ * numBytes()
+ * Bytes held in blocks (text in the source isn't counted)
+ */
+size_t StringPool::numBytes(void) const
+{
+    size_t n = 0;
+
+    for(unsigned int id = 1; id < this->strs.size(); ++id)
+    {
+        if(this->src.size() == 0 || this->strs[id].data() < this->src.data() ||
+           this->strs[id].data() >= this->src.data() + this->src.size())
+            n += this->strs[id].size();
+    }
+
+    return n;
+}
+
+/*
+ * setSource()
+ * Strings inside text are referred to rather than copied. The
+ * text must outlive the pool.
+ */
+void StringPool::setSource(const std::string_view& text)
+{
+    this->src = text;
+}
+
 /*
  * SYMBOLTABLE 
  */
-SymbolTable::SymbolTable() {} 
+SymbolTable::SymbolTable() 
+{
+    this->num_ids = 0;
+    this->slots.assign(SYM_MIN_SLOTS, SYM_ID_NONE);
+} 
+
 SymbolTable::~SymbolTable() {} 
 
+/*
+ * hashLabel()
+ */
+uint32_t SymbolTable::hashLabel(const std::string_view& label) const
+{
+    return source_hash(label);
+}
+
+/*
+ * insert()
+ * Put symbol idx into the index, unless its label is already there
+ */
+void SymbolTable::insert(const unsigned int idx)
+{
+    uint32_t mask = this->slots.size() - 1;
+    uint32_t s    = this->sym_hash[idx] & mask;
+
+    while(this->slots[s] != SYM_ID_NONE)
+    {
+        int32_t id = this->slots[s];
+        if(this->sym_hash[id] == this->sym_hash[idx] && 
+           this->syms[id].label == this->syms[idx].label)
+            return;
+        s = (s + 1) & mask;
+    }
+    this->slots[s] = idx;
+    this->num_ids++;
+}
+
+/*
+ * rehash()
+ * Rebuild the index with a new number of slots (a power of 2)
+ */
+void SymbolTable::rehash(const unsigned int num_slots)
+{
+    this->slots.assign(num_slots, SYM_ID_NONE);
+    this->num_ids = 0;
+    for(unsigned int idx = 0; idx < this->syms.size(); ++idx)
+        this->insert(idx);
+}
+
 void SymbolTable::add(const Symbol& s)
 {
     this->syms.push_back(s);
+    this->sym_hash.push_back(this->hashLabel(s.label));
+    // keep the load factor at or below 1/2 
+    if(2 * (this->num_ids + 1) > this->slots.size())
+        this->rehash(2 * this->slots.size());
+    else
+        this->insert(this->syms.size() - 1);
+}
+
+/*
+ * build()
+ * Replace the contents of the table with a list of symbols, 
+ * sizing the index once up front
+ */
+void SymbolTable::build(const std::vector<Symbol>& s)
+{
+    this->syms = s;
+    this->sym_hash.resize(s.size());
+    for(unsigned int idx = 0; idx < s.size(); ++idx)
+        this->sym_hash[idx] = this->hashLabel(s[idx].label);
+    unsigned int num_slots = SYM_MIN_SLOTS;
+    while(num_slots < 2 * s.size())
+        num_slots *= 2;
+    this->rehash(num_slots);
+}
+
+/*
+ * reserve()
+ * Make room for n symbols without rehashing
+ */
+void SymbolTable::reserve(const unsigned int n)
+{
+    this->syms.reserve(n);
+    this->sym_hash.reserve(n);
+    unsigned int num_slots = this->slots.size();
+    while(num_slots < 2 * n)
+        num_slots *= 2;
+    if(num_slots != this->slots.size())
+        this->rehash(num_slots);
 }
 
 void SymbolTable::update(const unsigned int idx, const Symbol& s)
 {
     //if(idx > this->syms.size())
     //    return;
+    bool relabel = (s.label != this->syms[idx].label);
     this->syms[idx] = s;
+    if(relabel)
+    {
+        this->sym_hash[idx] = this->hashLabel(s.label);
+        this->rehash(this->slots.size());
+    }
 }
 
 Symbol SymbolTable::get(const unsigned int idx) const
@@ -33,19 +568,53 @@ Symbol SymbolTable::get(const unsigned int idx) const
     return this->syms[idx];
 }
 
-// TODO: Currently implemented as linear search,
-// change to map or something
-uint16_t SymbolTable::getAddr(const std::string& s) const
+/*
+ * getId()
+ * Interned id of a label (the index of its first definition), 
+ * or SYM_ID_NONE if the label isn't in the table
+ */
+int SymbolTable::getId(const std::string_view& label) const
 {
-    uint16_t addr;
-    unsigned int idx;
+    uint32_t h    = this->hashLabel(label);
+    uint32_t mask = this->slots.size() - 1;
+    uint32_t s    = h & mask;
 
-    for(idx = 0; idx < this->syms.size(); idx++)
+    while(this->slots[s] != SYM_ID_NONE)
     {
-        if(s == this->syms[idx].label)
-            return this->syms[idx].addr;
+        int32_t id = this->slots[s];
+        if(this->sym_hash[id] == h && this->syms[id].label == label)
+            return id;
+        s = (s + 1) & mask;
     }
-    addr = 0;
+
+    return SYM_ID_NONE;
+}
+
+/*
+ * find()
+ * Look up the address of a label. Returns false if the label
+ * isn't in the table, in which case addr is not changed.
+ */
+bool SymbolTable::find(const std::string_view& label, uint16_t& addr) const
+{
+    int id = this->getId(label);
+    if(id == SYM_ID_NONE)
+        return false;
+    addr = this->syms[id].addr;
+
+    return true;
+}
+
+/*
+ * getAddr()
+ * Address of a label, or 0 if the label isn't in the table. Use
+ * find() to tell a missing label from one at address 0.
+ */
+uint16_t SymbolTable::getAddr(const std::string_view& s) const
+{
+    uint16_t addr = 0;
+
+    this->find(s, addr);
 
     return addr;
 }
@@ -53,6 +622,9 @@ uint16_t SymbolTable::getAddr(const std::string& s) const
 void SymbolTable::init(void)
 {
     this->syms.clear();
+    this->sym_hash.clear();
+    this->slots.assign(SYM_MIN_SLOTS, SYM_ID_NONE);
+    this->num_ids = 0;
 }
 
 unsigned int SymbolTable::getNumSyms(void) const
@@ -60,6 +632,16 @@ unsigned int SymbolTable::getNumSyms(void) const
     return this->syms.size();
 }
 
+unsigned int SymbolTable::getNumIds(void) const
+{
+    return this->num_ids;
+}
+
+void SymbolTable::setSource(const std::shared_ptr<const SourceBuffer>& buf)
+{
+    this->src_buf = buf;
+}
+
 // TODO (debug) dump all symbols to console 
 void SymbolTable::dump(void)
 {
@@ -73,17 +655,13 @@ void SymbolTable::dump(void)
 // LineInfo
 void initLineInfo(LineInfo& l)
 {
-    l.line_num = 0;
-    l.addr     = 0;
-    l.symbol   = "\0";
-    l.label    = "\0";
-    l.errstr   = "\0";
-    l.opcode   = {0x0, "DEFAULT"},
-    l.arg1     = 0;
-    l.arg2     = 0;
-    l.arg3     = 0;
-    l.imm      = 0;
-    l.flags    = 0;
+    std::memset(&l, 0, sizeof(l));
+    l.symbol   = STR_ID_EMPTY;
+    l.label    = STR_ID_EMPTY;
+    l.mnemonic = STR_ID_EMPTY;
+    l.err_arg  = STR_ID_EMPTY;
+    l.err_code = LINE_ERR_NONE;
+    l.handler  = LINE_H_NONE;
     l.is_imm   = false;
     l.is_label = false;
     l.error    = false;
@@ -92,17 +670,17 @@ void initLineInfo(LineInfo& l)
 
 /*
  * compLineInfo()
- * Compare two LineInfo objects. errstr isn't checked here 
+ * Compare two LineInfo objects. The error message isn't checked here 
  */
-bool compLineInfo(const LineInfo& a, const LineInfo& b)
+bool compLineInfo(const SourceInfo& sa, const LineInfo& a, const SourceInfo& sb, const LineInfo& b)
 {
-    if(a.symbol != b.symbol)
+    if(sa.getStr(a.symbol) != sb.getStr(b.symbol))
         return false;
-    if(a.label != b.label)
+    if(sa.getStr(a.label) != sb.getStr(b.label))
         return false;
-    if(a.opcode.opcode != b.opcode.opcode)
+    if(a.opcode != b.opcode)
         return false;
-    if(a.opcode.mnemonic != b.opcode.mnemonic)
+    if(sa.getStr(a.mnemonic) != sb.getStr(b.mnemonic))
         return false;
     if(a.line_num != b.line_num)
         return false;
@@ -130,16 +708,16 @@ bool compLineInfo(const LineInfo& a, const LineInfo& b)
     return true;
 }
 
-void printLineDiff(const LineInfo& a, const LineInfo& b)
+void printLineDiff(const SourceInfo& sa, const LineInfo& a, const SourceInfo& sb, const LineInfo& b)
 {
-    if(a.symbol != b.symbol)
-        std::cout << "a.symbol [" << a.symbol << "] != b.symbol [" << b.symbol << "]" << std::endl;
-    if(a.label != b.label)
-        std::cout << "a.label [" << a.label << "] != b.label [" << b.label << "]" << std::endl;
-    if(a.opcode.opcode != b.opcode.opcode)
-        std::cout << "a.opcode [" << a.opcode.opcode << "] != b.opcode [" << b.opcode.opcode << "]" << std::endl;
-    if(a.opcode.mnemonic != b.opcode.mnemonic)
-        std::cout << "a.mnemonic [" << a.opcode.mnemonic << "] != b.mnemonic [" << b.opcode.mnemonic << "]" << std::endl;
+    if(sa.getStr(a.symbol) != sb.getStr(b.symbol))
+        std::cout << "a.symbol [" << sa.getStr(a.symbol) << "] != b.symbol [" << sb.getStr(b.symbol) << "]" << std::endl;
+    if(sa.getStr(a.label) != sb.getStr(b.label))
+        std::cout << "a.label [" << sa.getStr(a.label) << "] != b.label [" << sb.getStr(b.label) << "]" << std::endl;
+    if(a.opcode != b.opcode)
+        std::cout << "a.opcode [" << a.opcode << "] != b.opcode [" << b.opcode << "]" << std::endl;
+    if(sa.getStr(a.mnemonic) != sb.getStr(b.mnemonic))
+        std::cout << "a.mnemonic [" << sa.getStr(a.mnemonic) << "] != b.mnemonic [" << sb.getStr(b.mnemonic) << "]" << std::endl;
     if(a.line_num != b.line_num)
         std::cout << "a.line_num [" << a.line_num << "] != b.line_num [" << b.line_num << "]" << std::endl;
     if(a.addr != b.addr)
@@ -166,13 +744,157 @@ void printLineDiff(const LineInfo& a, const LineInfo& b)
 /*
  * SOURCEINFO 
  */
+// Messages for each LINE_ERR_* code. In these %s is the token the
+// error is about, %m the mnemonic, %u the argument number and %l 
+// the line number.
+static const char* line_err_fmt[LINE_ERR_MAX] = {
+    "",
+    "Argument %u of opcode %m invalid",
+    "Invalid opcode <%s>",
+    "Failed to parse %m argument <%s>",
+    "Invalid jump opcode %m",
+    "Failed to parse JSR immediate <%s>",
+    "Failed to parse %m argument <%s> (destination register)",
+    "Failed to parse %m argument <%s> (source register)",
+    "Failed to parse %m argument <%s> (base register)",
+    "Failed to parse %m argument <%s> (offset6)",
+    "Not a valid TRAP psuedo-op <%s>",
+    "No implementation for opcode <%s>",
+    "Opcode <%s> not a valid assembler directive",
+    "Token <%m> is not a valid assembler directive",
+    "No valid instruction after label <%s>",
+    "(line %l) Invalid label token",
+    "Invalid literal <%s>",
+    "Literal <%s> does not fit in a %u bit field"
+};
+
 SourceInfo::SourceInfo()
 {
-    this->error = false;
+    this->error   = false;
+    this->strings = std::make_shared<StringPool>();
 }
 
 SourceInfo::~SourceInfo() {} 
 
+SourceInfo::SourceInfo(SourceInfo&& that) noexcept
+{
+    this->line_info = std::move(that.line_info);
+    this->error     = that.error;
+    this->src_buf   = std::move(that.src_buf);
+    this->strings   = std::move(that.strings);
+    this->file_buf  = std::move(that.file_buf);
+    that.line_info.clear();
+    that.error      = false;
+    that.strings    = std::make_shared<StringPool>();
+}
+
+SourceInfo& SourceInfo::operator=(SourceInfo&& that) noexcept
+{
+    if(this != &that)
+    {
+        this->line_info = std::move(that.line_info);
+        this->error     = that.error;
+        this->src_buf   = std::move(that.src_buf);
+        this->strings   = std::move(that.strings);
+        this->file_buf  = std::move(that.file_buf);
+        that.line_info.clear();
+        that.error      = false;
+        that.strings    = std::make_shared<StringPool>();
+    }
+
+    return *this;
+}
+
+/*
+ * intern()
+ * Id for a string used by a line of this source
+ */
+StrId SourceInfo::intern(const std::string_view& s)
+{
+    this->ownStrings();
+    return this->strings->intern(s);
+}
+
+/*
+ * ownStrings()
+ * Copy the string pool if another SourceInfo shares it, before 
+ * changing it
+ */
+void SourceInfo::ownStrings(void)
+{
+    if(this->strings.use_count() > 1)
+        this->strings = this->strings->clone();
+}
+
+std::string_view SourceInfo::getStr(const StrId id) const
+{
+    return this->strings->get(id);
+}
+
+/*
+ * getErrStr()
+ * Format the error message for a line
+ */
+std::string SourceInfo::getErrStr(const LineInfo& l) const
+{
+    std::string out;
+
+    if(!l.error || l.err_code >= LINE_ERR_MAX)
+        return out;
+    for(const char* f = line_err_fmt[l.err_code]; *f != '\0'; ++f)
+    {
+        if(*f != '%' || *(f + 1) == '\0')
+        {
+            out += *f;
+            continue;
+        }
+        f++;
+        switch(*f)
+        {
+            case 's':
+                out += this->getStr(l.err_arg);
+                break;
+            case 'm':
+                out += this->getStr(l.mnemonic);
+                break;
+            case 'u':
+                out += std::to_string(l.err_num);
+                break;
+            case 'l':
+                out += std::to_string(l.line_num);
+                break;
+            default:
+                out += *f;
+                break;
+        }
+    }
+
+    return out;
+}
+
+/*
+ * mergeStrings()
+ * Take all the strings from another SourceInfo, returning the 
+ * new id of each of them
+ */
+std::vector<StrId> SourceInfo::mergeStrings(const SourceInfo& that)
+{
+    if(this->strings == that.strings)
+    {
+        std::vector<StrId> remap(that.strings->size());
+        for(unsigned int id = 0; id < remap.size(); ++id)
+            remap[id] = id;
+        return remap;
+    }
+    this->ownStrings();
+    return this->strings->merge(*that.strings);
+}
+
+unsigned int SourceInfo::numStrings(void) const
+{
+    return this->strings->size();
+}
+
 /* 
  * line_to_string
  * Pretty-print a LineInfo struct
@@ -200,8 +922,8 @@ std::string SourceInfo::line_to_string(const LineInfo& l)
         oss << ".";
     oss << "] ";
     oss << std::left << "0x" << std::hex << std::setw(4) << std::setfill('0') << l.addr << " ";
-    oss << std::left << std::setw(12) << std::setfill(' ') << l.opcode.mnemonic;
-    oss << "0x" << std::hex << std::setw(4) << std::setfill('0') << l.opcode.opcode << "   ";
+    oss << std::left << std::setw(12) << std::setfill(' ') << this->getStr(l.mnemonic);
+    oss << "0x" << std::hex << std::setw(4) << std::setfill('0') << l.opcode << "   ";
     // Insert flag chars
     if(l.flags & LC3_FLAG_N)
         oss << "n";
@@ -224,8 +946,8 @@ std::string SourceInfo::line_to_string(const LineInfo& l)
 
     // (Next line) Text 
     oss << std::endl;
-    oss << "Label [" << std::left << std::setw(16) << std::setfill(' ') << l.label << "] ";
-    oss << "Symbol[" << std::left << std::setw(16) << std::setfill(' ') << l.symbol << "] ";
+    oss << "Label [" << std::left << std::setw(16) << std::setfill(' ') << this->getStr(l.label) << "] ";
+    oss << "Symbol[" << std::left << std::setw(16) << std::setfill(' ') << this->getStr(l.symbol) << "] ";
 
     oss << std::endl;
     
@@ -237,6 +959,24 @@ void SourceInfo::add(const LineInfo& l)
     this->line_info.push_back(l);
 }
 
+/*
+ * replace()
+ * Replace num lines starting at idx with some other lines
+ */
+void SourceInfo::replace(const unsigned int idx, const unsigned int num, const std::vector<LineInfo>& lines)
+{
+    if(idx > this->line_info.size())
+        return;
+    unsigned int n = std::min((size_t) num, this->line_info.size() - idx);
+    unsigned int common = std::min(n, (unsigned int) lines.size());
+
+    std::copy(lines.begin(), lines.begin() + common, this->line_info.begin() + idx);
+    if(n > common)
+        this->line_info.erase(this->line_info.begin() + idx + common, this->line_info.begin() + idx + n);
+    else
+        this->line_info.insert(this->line_info.begin() + idx + common, lines.begin() + common, lines.end());
+}
+
 void SourceInfo::update(const unsigned int idx, const LineInfo& l)
 {
     if(idx > this->line_info.size())
@@ -244,6 +984,36 @@ void SourceInfo::update(const unsigned int idx, const LineInfo& l)
     this->line_info[idx] = l;
 }
 
+/*
+ * at()
+ * Reference to a line, without the copy that get() makes. The 
+ * index must be in range and the reference is only good until 
+ * the lines are next changed.
+ */
+const LineInfo& SourceInfo::at(const unsigned int idx) const
+{
+    return this->line_info[idx];
+}
+
+SourceInfo::const_iterator SourceInfo::begin(void) const
+{
+    return this->line_info.begin();
+}
+
+SourceInfo::const_iterator SourceInfo::end(void) const
+{
+    return this->line_info.end();
+}
+
+/*
+ * reserve()
+ * Make room for n lines
+ */
+void SourceInfo::reserve(const unsigned int n)
+{
+    this->line_info.reserve(n);
+}
+
 LineInfo SourceInfo::get(const unsigned int idx) const
 {
     if(idx < this->line_info.size())
@@ -251,7 +1021,7 @@ LineInfo SourceInfo::get(const unsigned int idx) const
     else
     {
         LineInfo l;
-        l.line_num = 0;
+        initLineInfo(l);
         
         return l;
     }
@@ -293,7 +1063,7 @@ unsigned int SourceInfo::numInstance(const uint16_t& op) const
 
     for(idx = 0; idx < this->line_info.size(); idx++)
     {
-        if(this->line_info[idx].opcode.opcode == op)
+        if(this->line_info[idx].opcode == op)
             n++;
     }
 
@@ -313,7 +1083,7 @@ unsigned int SourceInfo::numInstance(const std::string& m) const
     // Could replace linear search here later...
     for(idx = 0; idx < this->line_info.size(); idx++)
     {
-        if(this->line_info[idx].opcode.mnemonic == m)
+        if(this->getStr(this->line_info[idx].mnemonic) == m)
             n++;
     }
 
@@ -330,24 +1100,261 @@ void SourceInfo::setError(const bool e)
     this->error = e;
 }
 
-// Save/load data 
-// TODO : may need a serialization library here 
-int SourceInfo::write(const std::string& filename)
+/*
+ * setSource()
+ * Hold on to the source text that the symbols and labels in 
+ * this SourceInfo refer to.
+ */
+void SourceInfo::setSource(const std::shared_ptr<const SourceBuffer>& buf)
+{
+    if(buf == this->src_buf)
+        return;
+    this->src_buf = buf;
+    if(buf != nullptr)
+    {
+        this->ownStrings();
+        this->strings->setSource(buf->view());
+    }
+}
+
+std::shared_ptr<const SourceBuffer> SourceInfo::getSource(void) const
+{
+    return this->src_buf;
+}
+
+/*
+ * hashSource()
+ * FNV-1a, a word at a time
+ */
+uint64_t hashSource(const std::string_view& text)
 {
-    int status = 0;
-    //uint32_t num_records, sym_len, label_len;
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t h = 0xCBF29CE484222325ull;
+    size_t pos = 0;
 
-    //num_records = this->line_info.size();
+    for(; pos + 8 <= text.size(); pos += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, text.data() + pos, 8);
+        h = (h ^ w) * prime;
+    }
+    for(; pos < text.size(); ++pos)
+        h = (h ^ (uint8_t) text[pos]) * prime;
 
-    return status;
+    return h;
 }
 
-// TODO : May need serialization library here
-int SourceInfo::read(const std::string& filename)
+/*
+ * src_file_align()
+ * Round an offset up to the start of the next section
+ */
+static uint64_t src_file_align(const uint64_t off)
+{
+    return (off + SRC_FILE_ALIGN - 1) & ~((uint64_t) SRC_FILE_ALIGN - 1);
+}
+
+/*
+ * line_data_valid()
+ * Check a LineInfo in a file before it is loaded. A bool that isn't
+ * 0 or 1 can't be loaded at all, and the handler and error code are 
+ * used as indexes.
+ */
+static inline bool line_data_valid(const uint8_t* p)
 {
-    int status = 0;
+    uint8_t bools = p[offsetof(LineInfo, is_imm)] | p[offsetof(LineInfo, is_label)] |
+                    p[offsetof(LineInfo, is_directive)] | p[offsetof(LineInfo, error)];
+
+    return (bools <= 1 && p[offsetof(LineInfo, handler)] < LINE_H_MAX &&
+            p[offsetof(LineInfo, err_code)] < LINE_ERR_MAX) ? true : false;
+}
+
+/*
+ * write()
+ * Write the lines, strings and (if given) symbols to filename.
+ * Returns -1 if the file can't be written.
+ */
+int SourceInfo::write(const std::string& filename, const SymbolTable* sym_table) const
+{
+    SourceFileHeader hdr;
+    std::vector<uint32_t> str_offs;
+    std::vector<SourceFileSym> syms;
+    std::string text;
+    unsigned int num_syms;
+
+    // Strings, then labels, all in one block of text
+    str_offs.reserve(this->strings->size() + 1);
+    for(unsigned int id = 0; id < this->strings->size(); ++id)
+    {
+        str_offs.push_back(text.size());
+        text += this->strings->get(id);
+    }
+    str_offs.push_back(text.size());
+    num_syms = (sym_table != nullptr) ? sym_table->getNumSyms() : 0;
+    syms.resize(num_syms);
+    for(unsigned int idx = 0; idx < num_syms; ++idx)
+    {
+        Symbol s = sym_table->get(idx);
+        syms[idx].label_off = text.size();
+        syms[idx].label_len = s.label.size();
+        syms[idx].addr      = s.addr;
+        syms[idx].pad       = 0;
+        text += s.label;
+    }
+
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.magic     = SRC_FILE_MAGIC;
+    hdr.version   = SRC_FILE_VERSION;
+    hdr.line_size = sizeof(LineInfo);
+    hdr.flags     = this->error ? SRC_FILE_ERROR : 0;
+    hdr.num_lines = this->line_info.size();
+    hdr.num_strs  = this->strings->size();
+    hdr.num_syms  = num_syms;
+    hdr.text_size = text.size();
+    if(this->src_buf != nullptr)
+    {
+        hdr.src_size = this->src_buf->length();
+        hdr.src_hash = hashSource(this->src_buf->view());
+    }
+    hdr.lines_off = src_file_align(sizeof(hdr));
+    hdr.strs_off  = src_file_align(hdr.lines_off + hdr.num_lines * sizeof(LineInfo));
+    hdr.syms_off  = src_file_align(hdr.strs_off + str_offs.size() * sizeof(uint32_t));
+    hdr.text_off  = src_file_align(hdr.syms_off + num_syms * sizeof(SourceFileSym));
+
+    std::ofstream outfile(filename, std::ios::binary | std::ios::trunc);
+    if(!outfile.good())
+    {
+        std::cerr << "[" << __FUNCTION__ << "] failed to open file " << filename << std::endl;
+        return -1;
+    }
+    const char pad[SRC_FILE_ALIGN] = {0};
+    uint64_t pos = 0;
+    auto put = [&](const uint64_t off, const void* data, const size_t len)
+    {
+        outfile.write(pad, off - pos);
+        outfile.write((const char*) data, len);
+        pos = off + len;
+    };
+    put(0, &hdr, sizeof(hdr));
+    put(hdr.lines_off, this->line_info.data(), hdr.num_lines * sizeof(LineInfo));
+    put(hdr.strs_off, str_offs.data(), str_offs.size() * sizeof(uint32_t));
+    put(hdr.syms_off, syms.data(), num_syms * sizeof(SourceFileSym));
+    put(hdr.text_off, text.data(), text.size());
+    outfile.close();
+    if(outfile.fail())
+    {
+        std::cerr << "[" << __FUNCTION__ << "] failed to write file " << filename << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * read()
+ * Replace the lines and strings (and symbols, if sym_table is given)
+ * with the ones in a file from write(). The only work is a copy of
+ * the lines and indexing the strings and labels, which stay in the 
+ * mapped file. Returns -1 if the file can't be read, isn't valid, or
+ * doesn't match src.
+ */
+int SourceInfo::read(const std::string& filename, SymbolTable* sym_table,
+        const std::shared_ptr<const SourceBuffer>& src)
+{
+    SourceFileHeader hdr;
+    std::shared_ptr<SourceBuffer> buf = std::make_shared<SourceBuffer>();
+
+    if(buf->load(filename) < 0)
+        return -1;
+    std::string_view data = buf->view();
+    if(data.size() < sizeof(hdr))
+    {
+        std::cerr << "[" << __FUNCTION__ << "] file " << filename << " is too short" << std::endl;
+        return -1;
+    }
+    std::memcpy(&hdr, data.data(), sizeof(hdr));
+    if(hdr.magic != SRC_FILE_MAGIC || hdr.version != SRC_FILE_VERSION || 
+       hdr.line_size != sizeof(LineInfo))
+    {
+        std::cerr << "[" << __FUNCTION__ << "] file " << filename 
+            << " is not a version " << SRC_FILE_VERSION << " source file" << std::endl;
+        return -1;
+    }
+    // Every section has to fit in the file
+    if(hdr.lines_off + (uint64_t) hdr.num_lines * sizeof(LineInfo) > data.size() ||
+       hdr.strs_off + ((uint64_t) hdr.num_strs + 1) * sizeof(uint32_t) > data.size() ||
+       hdr.syms_off + (uint64_t) hdr.num_syms * sizeof(SourceFileSym) > data.size() ||
+       hdr.text_off + (uint64_t) hdr.text_size > data.size() || hdr.num_strs == 0)
+    {
+        std::cerr << "[" << __FUNCTION__ << "] file " << filename << " is truncated" << std::endl;
+        return -1;
+    }
+    // Lines from some other text aren't an error, just no use
+    if(src != nullptr && (hdr.src_size != src->length() || hdr.src_hash != hashSource(src->view())))
+        return -1;
+
+    std::string_view text = data.substr(hdr.text_off, hdr.text_size);
+    std::vector<uint32_t> str_offs(hdr.num_strs + 1);
+    std::memcpy(str_offs.data(), data.data() + hdr.strs_off, str_offs.size() * sizeof(uint32_t));
+    std::vector<Symbol> syms(hdr.num_syms);
+    for(unsigned int idx = 0; idx < hdr.num_syms; ++idx)
+    {
+        SourceFileSym fs;
+        std::memcpy(&fs, data.data() + hdr.syms_off + idx * sizeof(SourceFileSym), sizeof(fs));
+        if((uint64_t) fs.label_off + fs.label_len > text.size())
+        {
+            std::cerr << "[" << __FUNCTION__ << "] bad symbol " << idx << " in file " << filename << std::endl;
+            return -1;
+        }
+        syms[idx].addr  = fs.addr;
+        syms[idx].label = text.substr(fs.label_off, fs.label_len);
+    }
+
+    // The strings are all in the mapped text, so none are copied. 
+    // They were distinct when written, so they keep their ids, and
+    // they aren't hashed until something adds a string to the pool.
+    for(unsigned int id = 1; id < hdr.num_strs; ++id)
+    {
+        if(str_offs[id] > str_offs[id + 1] || str_offs[id + 1] > text.size())
+        {
+            std::cerr << "[" << __FUNCTION__ << "] bad string " << id << " in file " << filename << std::endl;
+            return -1;
+        }
+    }
+    std::shared_ptr<StringPool> pool = std::make_shared<StringPool>();
+    pool->assign(text, str_offs);
+
+    // Lines are copied a block at a time, and the fields that can't
+    // hold just any value (the bools, and the codes used as indexes)
+    // are checked in the copy while it is still in cache, before any 
+    // of them is used. A bad string id just reads as an empty string
+    // (see StringPool::get()).
+    std::vector<LineInfo> lines(hdr.num_lines);
+    for(unsigned int first = 0; first < hdr.num_lines; first += SRC_FILE_BLOCK)
+    {
+        unsigned int num = std::min(hdr.num_lines - first, (uint32_t) SRC_FILE_BLOCK);
+        const uint8_t* block = (const uint8_t*) (lines.data() + first);
+        std::memcpy(lines.data() + first, data.data() + hdr.lines_off + first * sizeof(LineInfo), num * sizeof(LineInfo));
+        for(unsigned int idx = 0; idx < num; ++idx)
+        {
+            if(!line_data_valid(block + idx * sizeof(LineInfo)))
+            {
+                std::cerr << "[" << __FUNCTION__ << "] bad line " << first + idx << " in file " << filename << std::endl;
+                return -1;
+            }
+        }
+    }
+    this->line_info.swap(lines);
+    this->error    = (hdr.flags & SRC_FILE_ERROR) ? true : false;
+    this->strings  = pool;
+    this->file_buf = buf;
+    this->src_buf  = src;
+    if(sym_table != nullptr)
+    {
+        sym_table->build(syms);
+        sym_table->setSource(buf);
+    }
 
-    return status;
+    return 0;
 }
 
 void SourceInfo::printLine(const unsigned int idx)
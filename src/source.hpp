@@ -8,6 +8,10 @@
 #define __SOURCE_HPP
 
 #include <string>
+#include <string_view>
+#include <memory>
+#include <type_traits>
+#include <vector>
 #include <cstdint>
 #include "opcode.hpp"
 
@@ -15,61 +19,284 @@
 #define LC3_FLAG_Z 0x02
 #define LC3_FLAG_N 0x04
 
+#define SRC_MIN_GAP 4096        // smallest gap replace() leaves
+
+/*
+ * SourceBuffer
+ * The text of an assembly source. This is either a read-only
+ * mapping of a file, a copy of a string, or a buffer owned by 
+ * the caller. Anything lexed from the buffer refers to the text 
+ * in place, so lexer output holds a reference to the SourceBuffer
+ * to keep it alive. Caller-owned buffers must outlive that output.
+ *
+ * A copy that is edited with replace() keeps a gap at the last 
+ * edit, so the next edit only moves the text between the two. The
+ * gap is moved out of the way when the text is looked at, which 
+ * doesn't change the text, but means an edited buffer can't be 
+ * read from more than one thread at once.
+ */
+class SourceBuffer
+{
+    private:
+        const char* data;
+        size_t      size;           // length of the text (not the gap)
+        void*       map_addr;       // start of the mapping (if mapped)
+        size_t      map_size;
+        mutable std::string copy;   // holds the text if it was copied
+        mutable size_t gap_start;   // gap in copy left by replace()
+        mutable size_t gap_len;
+        void        release(void);
+        void        moveGap(const size_t pos) const;
+        void        growGap(const size_t len);
+
+    public:
+        SourceBuffer();
+        ~SourceBuffer();
+        SourceBuffer(const SourceBuffer& that) = delete;
+        SourceBuffer& operator=(const SourceBuffer& that) = delete;
+
+        int              load(const std::string& filename);
+        void             assign(const char* buf, const size_t len);
+        void             assignCopy(const std::string& text);
+        void             replace(const size_t pos, const size_t len, const std::string_view& text);
+        std::string_view view(void) const;
+        std::string_view prefix(const size_t len) const;
+        size_t           length(void) const;
+        bool             isMapped(void) const;
+};
+
 typedef struct 
 {
-    uint16_t addr;
-    std::string label;
+    uint16_t         addr;
+    std::string_view label;     // slice of the source text
 }Symbol;
 
+#define SYM_ID_NONE   -1         // id of a label that isn't in the table
+#define SYM_MIN_SLOTS 16
+
+/*
+ * SymbolTable
+ * Symbols in the order they were added, plus an open addressing 
+ * (linear probe) hash index over the label text. Each distinct 
+ * label is interned to an id, which is the position of its first
+ * definition. Looking up a label gives its id, and the id gives the
+ * symbol, both in constant time. If a label is defined more than
+ * once the first definition is the one that is found.
+ */
 class SymbolTable
 {
     private:
-        std::vector<Symbol> syms;
+        std::vector<Symbol>   syms;
+        std::vector<uint32_t> sym_hash;     // hash of each label
+        std::vector<int32_t>  slots;        // id in each slot, or SYM_ID_NONE
+        unsigned int          num_ids;      // number of distinct labels
+        std::shared_ptr<const SourceBuffer> src_buf;   // keeps labels valid
+
+    private:
+        uint32_t     hashLabel(const std::string_view& label) const;
+        void         insert(const unsigned int idx);
+        void         rehash(const unsigned int num_slots);
+
     public:
         SymbolTable();
         ~SymbolTable();
+        SymbolTable(const SymbolTable& that) = default;
+        SymbolTable(SymbolTable&& that) = default;
+        SymbolTable& operator=(const SymbolTable& that) = default;
+        SymbolTable& operator=(SymbolTable&& that) = default;
         void         add(const Symbol& s);
+        void         build(const std::vector<Symbol>& s);
+        void         reserve(const unsigned int n);
         void         update(const unsigned int idx, const Symbol& s);
         Symbol       get(const unsigned int idx) const;
-        uint16_t     getAddr(const std::string& label) const;
+        int          getId(const std::string_view& label) const;
+        bool         find(const std::string_view& label, uint16_t& addr) const;
+        uint16_t     getAddr(const std::string_view& label) const;
         void         init(void);
         unsigned int getNumSyms(void) const;
+        unsigned int getNumIds(void) const;
+        void         setSource(const std::shared_ptr<const SourceBuffer>& buf);
         // debug 
         void         dump(void);
 };
 
+/*
+ * StringPool
+ * Append-only store of distinct strings, each of which gets a small
+ * integer id. Strings that lie inside the source text are referred
+ * to in place. Anything else is copied into fixed size blocks, so
+ * a view of a string stays valid as the pool grows. A pool that is
+ * filled with assign() isn't hashed until a string is added to it.
+ */
+typedef uint32_t StrId;
+#define STR_ID_EMPTY   0        // id of the empty string
+#define STR_BLOCK_SIZE 4096
+
+class StringPool
+{
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char*                         cur_block;    // block being filled
+        size_t                        block_used;   // bytes used in cur_block
+        std::vector<std::string_view> strs;         // text of each id
+        std::vector<uint32_t>         str_hash;     // (only up to the last id indexed)
+        std::vector<int32_t>          slots;        // id in each slot, or -1
+        std::string_view              src;          // text we can refer into
+
+    private:
+        std::string_view store(const std::string_view& s);
+        StrId            insert(const std::string_view& s, const uint32_t h);
+        void             rehash(const unsigned int num_slots);
+        void             index(void);
+        uint32_t         hashOf(const StrId id) const;
+
+    public:
+        StringPool();
+        ~StringPool();
+        StringPool(const StringPool& that) = delete;
+        StringPool& operator=(const StringPool& that) = delete;
+
+        std::shared_ptr<StringPool> clone(void) const;
+        void             assign(const std::string_view& text, const std::vector<uint32_t>& offs);
+        StrId            intern(const std::string_view& s);
+        std::vector<StrId> merge(const StringPool& that);
+        std::string_view get(const StrId id) const;
+        unsigned int     size(void) const;
+        size_t           numBytes(void) const;
+        void             setSource(const std::string_view& text);
+};
+
+// Line errors. The message for a line is only formatted when 
+// something asks for it (see SourceInfo::getErrStr())
+#define LINE_ERR_NONE       0
+#define LINE_ERR_ARG        1
+#define LINE_ERR_OPCODE     2
+#define LINE_ERR_PARSE_ARG  3
+#define LINE_ERR_JUMP       4
+#define LINE_ERR_JSR_IMM    5
+#define LINE_ERR_DST_REG    6
+#define LINE_ERR_SRC_REG    7
+#define LINE_ERR_BASE_REG   8
+#define LINE_ERR_OFFSET6    9
+#define LINE_ERR_TRAP       10
+#define LINE_ERR_TRAP_IMPL  11
+#define LINE_ERR_DIRECTIVE  12
+#define LINE_ERR_DIR_IMPL   13
+#define LINE_ERR_NO_INSTR   14
+#define LINE_ERR_LABEL      15
+#define LINE_ERR_LITERAL    16
+#define LINE_ERR_RANGE      17      // err_num is the field width
+#define LINE_ERR_MAX        18
+
+// Line handlers. The lexer tags each line with the encoder the
+// assembler should use for it, so the assembler never has to look
+// at the mnemonic to decide what a line is.
+#define LINE_H_NONE         0       // nothing to encode (.END, errors)
+#define LINE_H_ADD          1
+#define LINE_H_AND          2
+#define LINE_H_BR           3
+#define LINE_H_JSR          4
+#define LINE_H_LEA          5
+#define LINE_H_LD           6
+#define LINE_H_LDR          7
+#define LINE_H_STR          8
+#define LINE_H_TRAP         9
+#define LINE_H_BLKW         10
+#define LINE_H_FILL         11
+#define LINE_H_ORIG         12
+#define LINE_H_STRINGZ      13
+#define LINE_H_INVALID      14      // an opcode the assembler can't encode
+#define LINE_H_MAX          15
+
 // NOTE: This is a LC3 specific lineinfo
 // structure. Consider generalizing in
 // future
+// The strings for a line (symbol, label, mnemonic and the token 
+// an error refers to) are ids in the StringPool of the SourceInfo
+// the line belongs to. Lines are plain data and can be copied
+// with memcpy.
 typedef struct{
-    std::string  symbol;     //char* symbol // <- faster?;
-    std::string  label;     //char* label // <- faster?;
-    std::string  errstr;
-    Opcode       opcode;
-    unsigned int line_num;
-    unsigned int addr;
-    uint8_t      flags;
+    StrId        symbol;
+    StrId        label;
+    StrId        mnemonic;
+    StrId        err_arg;       // token the error is about
+    uint32_t     line_num;
+    uint16_t     addr;
+    uint16_t     opcode;
     uint16_t     arg1;
     uint16_t     arg2;
     uint16_t     arg3;
     uint16_t     imm;
+    uint8_t      flags;
+    uint8_t      err_code;      // one of LINE_ERR_*
+    uint8_t      err_num;       // argument number (LINE_ERR_ARG)
+    uint8_t      handler;       // one of LINE_H_*
     bool         is_imm;
     bool         is_label;
     bool         is_directive;
     bool         error;
 } LineInfo;
 
+static_assert(std::is_trivially_copyable<LineInfo>::value, "LineInfo must be plain data");
+
 /*
  * initLineInfo()
  * Reset a lineinfo struct
  */
 void initLineInfo(LineInfo& l);
+
 /*
- * compLineInfo()
- * Compare two LineInfo structs
+ * Binary format for SourceInfo::write() and read(). Lines are 
+ * stored exactly as they are in memory, and every section starts
+ * on an 8 byte boundary, so a mapped file can be used as it is.
+ *
+ *   SourceFileHeader
+ *   LineInfo[num_lines]
+ *   uint32_t[num_strs + 1]     where each string starts in the text
+ *   SourceFileSym[num_syms]
+ *   char[text_size]            strings, then labels
+ *
+ * Files are in the byte order of the machine that wrote them, and 
+ * one with a different magic, version or LineInfo size is rejected.
+ */
+#define SRC_FILE_MAGIC   0x53334C43     // "LC3S"
+#define SRC_FILE_VERSION 2
+#define SRC_FILE_ALIGN   8
+#define SRC_FILE_ERROR   0x01           // the lines have errors
+#define SRC_FILE_BLOCK   256            // lines read() checks at a time
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t line_size;     // sizeof(LineInfo)
+    uint32_t flags;         // SRC_FILE_*
+    uint32_t num_lines;
+    uint32_t num_strs;
+    uint32_t num_syms;
+    uint32_t text_size;
+    uint64_t src_size;      // size and hash of the text that was 
+    uint64_t src_hash;      // lexed (both 0 if there wasn't any)
+    uint64_t lines_off;     // offset of each section from the start
+    uint64_t strs_off;
+    uint64_t syms_off;
+    uint64_t text_off;
+} SourceFileHeader;
+
+typedef struct
+{
+    uint32_t label_off;     // in the text section
+    uint32_t label_len;
+    uint16_t addr;
+    uint16_t pad;
+} SourceFileSym;
+
+/*
+ * hashSource()
+ * Hash of some source text, to tell whether a file written by 
+ * SourceInfo::write() came from it
  */
-bool compLineInfo(const LineInfo& a, const LineInfo& b);
-void printLineDiff(const LineInfo& a, const LineInfo& b);
+uint64_t hashSource(const std::string_view& text);
 
 /* 
  * SourceInfo
@@ -80,15 +307,43 @@ class SourceInfo
     private:
         std::vector <LineInfo> line_info;
         std::string line_to_string(const LineInfo& l);
+        void        ownStrings(void);
         bool error;
+        std::shared_ptr<const SourceBuffer> src_buf;   // text the lines refer to
+        // Strings for the lines. This is shared by copies of the 
+        // SourceInfo, which keeps copying a SourceInfo down to copying
+        // lines. A copy that adds strings first takes its own pool
+        // (see ownStrings()), so the others never see it change.
+        std::shared_ptr<StringPool> strings;
+        // File the lines and strings were read from, if they were
+        std::shared_ptr<const SourceBuffer> file_buf;
         
+    public:
+        typedef std::vector<LineInfo>::const_iterator const_iterator;
+
     public:
         SourceInfo();
         ~SourceInfo();
+        SourceInfo(const SourceInfo& that) = default;
+        SourceInfo& operator=(const SourceInfo& that) = default;
+        // Moving takes the lines and strings, leaving that empty
+        SourceInfo(SourceInfo&& that) noexcept;
+        SourceInfo& operator=(SourceInfo&& that) noexcept;
+        // Strings
+        StrId            intern(const std::string_view& s);
+        std::string_view getStr(const StrId id) const;
+        std::string      getErrStr(const LineInfo& l) const;
+        std::vector<StrId> mergeStrings(const SourceInfo& that);
+        unsigned int     numStrings(void) const;
         // Add/remove lines
         void         add(const LineInfo& l);
+        void         replace(const unsigned int idx, const unsigned int num, const std::vector<LineInfo>& lines);
         void         update(const unsigned int idx, const LineInfo& l);
         LineInfo     get(const unsigned int idx) const;
+        const LineInfo& at(const unsigned int idx) const;
+        const_iterator  begin(void) const;
+        const_iterator  end(void) const;
+        void         reserve(const unsigned int n);
         unsigned int getLineNum(const unsigned int idx) const;
         unsigned int getNumLines(void) const;
         unsigned int getNumError(void) const;
@@ -96,14 +351,30 @@ class SourceInfo
         unsigned int numInstance(const std::string& m) const;
         bool         hasError(void) const;
         void         setError(const bool e);
+        // Source text 
+        void         setSource(const std::shared_ptr<const SourceBuffer>& buf);
+        std::shared_ptr<const SourceBuffer> getSource(void) const;
 
-        // Save/load data
-        int          write(const std::string& filename);
-        int          read(const std::string& filename);
+        // Save/load the lines, strings and symbols (see SRC_FILE_*).
+        // Reading maps the file, and the strings and labels are used 
+        // in place. If src is given, read() fails unless the file was
+        // written from lines lexed from that text, and the lines then
+        // refer to it as their source.
+        int          write(const std::string& filename, const SymbolTable* sym_table = nullptr) const;
+        int          read(const std::string& filename, SymbolTable* sym_table = nullptr,
+                          const std::shared_ptr<const SourceBuffer>& src = nullptr);
 
         // String / display 
         void         printLine(const unsigned int idx);
         std::string  lineToString(const unsigned int idx);
 }; 
 
+/*
+ * compLineInfo()
+ * Compare two LineInfo structs, each with the SourceInfo it 
+ * belongs to (for the strings)
+ */
+bool compLineInfo(const SourceInfo& sa, const LineInfo& a, const SourceInfo& sb, const LineInfo& b);
+void printLineDiff(const SourceInfo& sa, const LineInfo& a, const SourceInfo& sb, const LineInfo& b);
+
 #endif /*__SOURCE_HPP*/
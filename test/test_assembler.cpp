@@ -16,6 +16,7 @@
 #include "lc3.hpp"      // for op_table helper function
 #include "source.hpp"
 #include "binary.hpp"
+#include "corpus.hpp"
 
 #define TEST_NUM_OPS 11
 
@@ -321,6 +322,290 @@ Program get_stringz_test_program(void)
     return prog;
 }
 
+// Assembling from the lexer stream gives the same program
+// as lexing everything first
+TEST_F(TestAssembler, test_asm_stream)
+{
+    std::vector<std::string> src_files = {
+        "data/add_test.asm",
+        "data/sentinel.asm",
+        "data/pow10.asm"
+    };
+
+    for(const std::string& src_filename : src_files)
+    {
+        Lexer batch_lexer(this->op_table, src_filename);
+        SourceInfo lex_output = batch_lexer.lex();
+        Assembler batch_as(lex_output);
+        batch_as.setContOnError(true);
+        batch_as.assemble();
+
+        Lexer stream_lexer(this->op_table, src_filename);
+        Assembler stream_as;
+        stream_as.setVerbose(this->verbose);
+        stream_as.setContOnError(true);
+        stream_as.assemble(stream_lexer);
+
+        std::cout << "Comparing streamed output for " << src_filename 
+            << " (" << stream_as.getNumFixups() << " fixups)" << std::endl;
+        ASSERT_EQ(batch_as.getNumErr(), stream_as.getNumErr());
+        std::vector<Instr> batch_instrs  = batch_as.getInstrs();
+        std::vector<Instr> stream_instrs = stream_as.getInstrs();
+        ASSERT_EQ(batch_instrs.size(), stream_instrs.size());
+        for(unsigned int i = 0; i < batch_instrs.size(); ++i)
+        {
+            ASSERT_EQ(batch_instrs[i].adr, stream_instrs[i].adr);
+            ASSERT_EQ(batch_instrs[i].ins, stream_instrs[i].ins);
+        }
+    }
+
+    // Only the forward references (FirstVal, Done) are held back
+    Lexer lexer(this->op_table, "data/sentinel.asm");
+    Assembler as;
+    as.assemble(lexer);
+    ASSERT_EQ(0, as.getNumErr());
+    ASSERT_EQ(2, as.getNumFixups());
+    Program ex_prog = get_sentinel_expected_program();
+    std::vector<Instr> as_instructions = as.getInstrs();
+    std::vector<Instr> ex_instructions = ex_prog.getInstr();
+    for(unsigned int i = 0; i < ex_instructions.size(); ++i)
+    {
+        ASSERT_EQ(ex_instructions[i].adr, as_instructions[i].adr);
+        ASSERT_EQ(ex_instructions[i].ins, as_instructions[i].ins);
+    }
+}
+
+// Compare the one pass assembler against lex() then assemble()
+static void test_comp_stream(const OpcodeTable& op_table, const std::string& text, const bool verbose)
+{
+    Lexer batch_lexer(op_table);
+    batch_lexer.loadBuffer(text);
+    Assembler batch_as(batch_lexer.lex());
+    batch_as.setContOnError(true);
+    batch_as.assemble();
+
+    Lexer stream_lexer(op_table);
+    stream_lexer.loadBuffer(text);
+    Assembler stream_as;
+    stream_as.setContOnError(true);
+    stream_as.assemble(stream_lexer);
+    if(verbose)
+    {
+        std::cout << stream_as.getNumFixups() << " fixups, " 
+            << stream_as.getNumErr() << " errors" << std::endl;
+    }
+
+    ASSERT_EQ(batch_as.getNumErr(), stream_as.getNumErr());
+    ASSERT_EQ(batch_as.getLog(), stream_as.getLog());
+    std::vector<Instr> batch_instrs  = batch_as.getInstrs();
+    std::vector<Instr> stream_instrs = stream_as.getInstrs();
+    ASSERT_EQ(batch_instrs.size(), stream_instrs.size());
+    for(unsigned int i = 0; i < batch_instrs.size(); ++i)
+    {
+        ASSERT_EQ(batch_instrs[i].adr, stream_instrs[i].adr) << "instr " << i;
+        ASSERT_EQ(batch_instrs[i].ins, stream_instrs[i].ins) << "instr " << i;
+    }
+}
+
+// Forward references are patched when their label is defined
+TEST_F(TestAssembler, test_asm_backpatch)
+{
+    LC3 machine;
+    CorpusParams p;
+    initCorpusParams(p);
+    p.num_lines = 5000;
+
+    // All forward, all backward, and a mix, with several references 
+    // waiting on the same label
+    unsigned int fwd[] = {100, 0, 50};
+    for(const unsigned int f : fwd)
+    {
+        CorpusStats stats;
+        p.fwd_percent = f;
+        p.ref_percent = 60;
+        p.label_every = 16;
+        std::string text = genCorpus(p, &stats);
+        test_comp_stream(machine.getOpTable(), text, this->verbose);
+
+        Lexer lexer(machine.getOpTable());
+        lexer.loadBuffer(text);
+        Assembler as;
+        as.assemble(lexer);
+        ASSERT_EQ(0u, as.getNumErr());
+        ASSERT_EQ(stats.num_fwd_refs, as.getNumFixups());
+    }
+
+    // A forward reference that turns out to be too far away, one to
+    // a label that is defined twice, and one to a label that never is
+    std::string text = 
+        "    .ORIG x3000\n"
+        "    BRz FAR\n"
+        "    LEA R0, TWICE\n"
+        "    LD R1, NOWHERE\n"
+        "    .BLKW #300\n"
+        "FAR ADD R1, R1, #1\n"
+        "TWICE ADD R2, R2, #1\n"
+        "TWICE ADD R3, R3, #1\n"
+        "    .END\n";
+    test_comp_stream(machine.getOpTable(), text, this->verbose);
+
+    Lexer lexer(machine.getOpTable());
+    lexer.loadBuffer(text);
+    Assembler as;
+    as.setContOnError(true);
+    as.assemble(lexer);
+    ASSERT_EQ(3u, as.getNumFixups());
+    ASSERT_NE(std::string::npos, as.getLog().find("BR offset too large"));
+}
+
+// Assemble straight into memory, and check that memory ends up as
+// it would from loading the program
+TEST_F(TestAssembler, test_asm_mem)
+{
+    LC3 machine;
+    CorpusParams p;
+    initCorpusParams(p);
+    p.num_lines   = CORPUS_SEG_LINES - 1;      // one .ORIG, so no overlap
+    p.ref_percent = 60;
+    p.label_every = 16;
+    std::string text = genCorpus(p);
+
+    Lexer prog_lexer(machine.getOpTable());
+    prog_lexer.loadBuffer(text);
+    Assembler prog_as;
+    prog_as.assemble(prog_lexer);
+    ASSERT_EQ(0u, prog_as.getNumErr());
+    std::vector<Instr> instrs = prog_as.getInstrs();
+    std::vector<uint16_t> exp_mem(LC3_MEM_SIZE, 0xDEAD);
+    for(const Instr& i : instrs)
+        exp_mem[i.adr] = i.ins;
+
+    Lexer lexer(machine.getOpTable());
+    lexer.loadBuffer(text);
+    Assembler as;
+    AsmImage image;
+    std::vector<uint16_t> mem(LC3_MEM_SIZE, 0xDEAD);
+    ASSERT_EQ(0, as.assemble(lexer, mem.data(), mem.size(), image));
+    ASSERT_GT(as.getNumFixups(), 0u);
+    ASSERT_EQ(0u, as.getProgram().getNumInstr());
+    ASSERT_EQ(exp_mem, mem);
+    ASSERT_EQ(instrs.size(), image.num_words);
+    ASSERT_EQ(0x3000, image.entry);
+
+    const SymbolTable& exp_syms = prog_lexer.getSymTable();
+    ASSERT_GT(exp_syms.getNumSyms(), 0u);
+    ASSERT_EQ(exp_syms.getNumSyms(), image.sym_table.getNumSyms());
+    for(unsigned int idx = 0; idx < exp_syms.getNumSyms(); ++idx)
+    {
+        Symbol s = exp_syms.get(idx);
+        ASSERT_EQ(s.addr, image.sym_table.getAddr(s.label)) << s.label;
+    }
+
+    // Words that don't fit are errors, and the rest is still written
+    text = 
+        "    .ORIG x3000\n"
+        "    ADD R1, R1, #1\n"
+        "    .FILL #7\n"
+        "    .FILL #8\n"
+        "    .FILL #9\n"
+        "    .END\n";
+    Lexer small_lexer(machine.getOpTable());
+    small_lexer.loadBuffer(text);
+    Assembler small_as;
+    small_as.setContOnError(true);
+    std::vector<uint16_t> small_mem(0x3002, 0xDEAD);
+    ASSERT_EQ(-1, small_as.assemble(small_lexer, small_mem.data(), small_mem.size(), image));
+    ASSERT_EQ(2u, small_as.getNumErr());
+    ASSERT_NE(std::string::npos, small_as.getLog().find("outside memory"));
+    ASSERT_EQ(0x1261, small_mem[0x3000]);
+    ASSERT_EQ(0x0007, small_mem[0x3001]);
+    ASSERT_EQ(2u, image.num_words);
+}
+
+// Assemble text in parallel and serially, and check that the results
+// are the same
+static void test_comp_parallel(const OpcodeTable& op_table, const std::string& text,
+        const bool cont_on_error, const unsigned int chunk_lines, const bool verbose)
+{
+    Lexer lexer(op_table);
+    lexer.loadBuffer(text);
+    lexer.setContOnError(true);
+    SourceInfo src = lexer.lex();
+
+    Assembler serial_as(src);
+    serial_as.setContOnError(cont_on_error);
+    serial_as.assemble();
+    Assembler par_as(src);
+    par_as.setContOnError(cont_on_error);
+    par_as.assembleParallel(4, chunk_lines);
+    if(verbose)
+    {
+        std::cout << src.getNumLines() << " lines in chunks of " << chunk_lines << ", " 
+            << par_as.getNumErr() << " errors" << std::endl;
+    }
+
+    ASSERT_EQ(serial_as.getNumErr(), par_as.getNumErr());
+    ASSERT_EQ(serial_as.getLog(), par_as.getLog());
+    std::vector<Instr> serial_instrs = serial_as.getInstrs();
+    std::vector<Instr> par_instrs    = par_as.getInstrs();
+    ASSERT_EQ(serial_instrs.size(), par_instrs.size());
+    for(unsigned int i = 0; i < serial_instrs.size(); ++i)
+    {
+        ASSERT_EQ(serial_instrs[i].adr, par_instrs[i].adr) << "instr " << i;
+        ASSERT_EQ(serial_instrs[i].ins, par_instrs[i].ins) << "instr " << i;
+    }
+}
+
+TEST_F(TestAssembler, test_asm_parallel)
+{
+    LC3 machine;
+    CorpusParams p;
+    initCorpusParams(p);
+    unsigned int chunk_lines[] = {1, 7, 100, 1000, 100000};
+
+    for(const unsigned int n : {10u, 3000u})
+    {
+        p.num_lines = n;
+        p.dir_percent = 30;
+        std::string text = genCorpus(p);
+        for(const unsigned int c : chunk_lines)
+            test_comp_parallel(machine.getOpTable(), text, false, c, this->verbose);
+
+        // Lines the assembler can't encode and lines the lexer 
+        // couldn't make sense of, with and without carrying on
+        std::string bad_text;
+        size_t pos = 0;
+        for(unsigned int line = 0; pos < text.size(); ++line)
+        {
+            size_t end = text.find('\n', pos) + 1;
+            bad_text += text.substr(pos, end - pos);
+            pos = end;
+            if(line % 400 == 150)
+                bad_text += "    NOT R1, R2\n";
+            if(line % 900 == 450)
+                bad_text += "    ADD R1, R2\n";
+        }
+        for(const unsigned int c : chunk_lines)
+        {
+            test_comp_parallel(machine.getOpTable(), bad_text, false, c, this->verbose);
+            test_comp_parallel(machine.getOpTable(), bad_text, true, c, this->verbose);
+        }
+    }
+
+    // The programs in asm/ 
+    std::vector<std::string> src_files = {
+        "data/add_test.asm",
+        "data/sentinel.asm",
+        "data/pow10.asm"
+    };
+    for(const std::string& src_filename : src_files)
+    {
+        Lexer lexer(machine.getOpTable(), src_filename);
+        std::string text(lexer.getSource()->view());
+        test_comp_parallel(machine.getOpTable(), text, true, 3, this->verbose);
+    }
+}
+
 // Test the assembly of the STRINGZ psuedo-op
 TEST_F(TestAssembler, test_asm_stringz)
 {
@@ -380,8 +665,9 @@ SourceInfo get_offset_error_source(void)
     initLineInfo(line);
     line.addr            = 0x3000;
     line.line_num        = 1;
-    line.opcode.opcode   = LC3_LD;
-    line.opcode.mnemonic = "LD";
+    line.opcode   = LC3_LD;
+    line.handler  = LINE_H_LD;
+    line.mnemonic = source.intern("LD");
     line.arg1            = 1;
     line.imm             = 0x3050;
     source.add(line);
@@ -390,8 +676,9 @@ SourceInfo get_offset_error_source(void)
     initLineInfo(line);
     line.addr            = 0x3001;
     line.line_num        = 2;
-    line.opcode.opcode   = LC3_LD;
-    line.opcode.mnemonic = "LD";
+    line.opcode   = LC3_LD;
+    line.handler  = LINE_H_LD;
+    line.mnemonic = source.intern("LD");
     line.arg1            = 1;
     line.imm             = 0xEF00;
     source.add(line);
@@ -399,8 +686,9 @@ SourceInfo get_offset_error_source(void)
     initLineInfo(line);
     line.addr            = 0x3002;
     line.line_num        = 3;
-    line.opcode.opcode   = LC3_BR;
-    line.opcode.mnemonic = "BR";
+    line.opcode   = LC3_BR;
+    line.handler  = LINE_H_BR;
+    line.mnemonic = source.intern("BR");
     line.flags           = 0x1;  // p flag
     line.imm             = 0xEF00;
     source.add(line);
@@ -0,0 +1,59 @@
+/* TEST_CHARCLASS
+ * Test the lexer character class table
+ *
+ * Stefan Wong 2018
+ */
+
+#include <cctype>
+#include <gtest/gtest.h>
+// Modules under test
+#include "charclass.hpp"
+
+class TestCharClass : public ::testing::Test
+{
+    protected:
+        TestCharClass() {}
+        virtual ~TestCharClass() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// The table is built at compile time
+static_assert(lex_char_is('A', LEX_CC_SYM_START), "'A' should start a symbol");
+static_assert(lex_char_is(';', LEX_CC_TOKEN_END), "';' should end a token");
+static_assert(!lex_char_is('#', LEX_CC_TOKEN_END), "'#' should not end a token");
+
+// Check every entry against <cctype>
+TEST_F(TestCharClass, test_ctype)
+{
+    for(int c = 0; c < 256; ++c)
+    {
+        char ch = (char) c;
+        ASSERT_EQ(isdigit(c) ? true : false, lex_char_is(ch, LEX_CC_DIGIT)) << "char " << c;
+        ASSERT_EQ(isxdigit(c) ? true : false, lex_char_is(ch, LEX_CC_HEX)) << "char " << c;
+        ASSERT_EQ((isalpha(c) || c == '_') ? true : false, lex_char_is(ch, LEX_CC_SYM_START)) << "char " << c;
+        ASSERT_EQ((isalnum(c) || c == '_') ? true : false, lex_char_is(ch, LEX_CC_SYM_BODY)) << "char " << c;
+    }
+}
+
+TEST_F(TestCharClass, test_token_end)
+{
+    const char ends[] = {' ', '\t', '\r', '\n', ',', ':', ';'};
+
+    for(const char c : ends)
+        ASSERT_TRUE(lex_char_is(c, LEX_CC_TOKEN_END));
+    ASSERT_TRUE(lex_char_is('\n', LEX_CC_NEWLINE));
+    ASSERT_FALSE(lex_char_is('\n', LEX_CC_SPACE));
+    ASSERT_FALSE(lex_char_is('#', LEX_CC_TOKEN_END));
+    ASSERT_FALSE(lex_char_is('x', LEX_CC_TOKEN_END));
+    ASSERT_FALSE(lex_char_is('\0', LEX_CC_TOKEN_END));
+    // High characters have no class
+    ASSERT_EQ(0, lex_char_class((char) 0xE9));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+/* TEST_CORPUS
+ * Test the synthetic source generator
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <string>
+#include <gtest/gtest.h>
+// Modules under test
+#include "corpus.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+
+class TestCorpus : public ::testing::Test
+{
+    protected:
+        TestCorpus() {}
+        virtual ~TestCorpus() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+static unsigned int test_count_lines(const std::string& text)
+{
+    unsigned int n = 0;
+
+    for(const char c : text)
+        n += (c == '\n');
+
+    return n;
+}
+
+TEST_F(TestCorpus, test_deterministic)
+{
+    CorpusParams p;
+    initCorpusParams(p);
+    p.num_lines = 5000;
+
+    std::string a = genCorpus(p);
+    std::string b = genCorpus(p);
+    ASSERT_EQ(a, b);
+    p.seed++;
+    std::string c = genCorpus(p);
+    ASSERT_NE(a, c);
+}
+
+TEST_F(TestCorpus, test_num_lines)
+{
+    CorpusParams p;
+    initCorpusParams(p);
+    unsigned int sizes[] = {0, 1, 2, 3, 100, CORPUS_SEG_LINES, CORPUS_SEG_LINES + 1, 10000};
+
+    for(const unsigned int n : sizes)
+    {
+        CorpusStats stats;
+        p.num_lines = n;
+        std::string text = genCorpus(p, &stats);
+        ASSERT_EQ(n, test_count_lines(text)) << n << " lines";
+        ASSERT_EQ(n, stats.num_lines);
+        if(n > 1)
+        {
+            ASSERT_EQ(n - 1 - stats.num_segments, stats.num_instrs + stats.num_directives);
+        }
+    }
+}
+
+// Different mixes all lex and assemble cleanly, with the labels
+// and references asked for
+TEST_F(TestCorpus, test_assemble)
+{
+    LC3 machine;
+    CorpusParams p;
+    initCorpusParams(p);
+    p.num_lines = 20000;
+    // label_every, ref_percent, fwd_percent, dir_percent, comment_percent
+    unsigned int mixes[][5] = {
+        {8, 20, 50, 10, 10},
+        {1, 100, 100, 0, 0},
+        {3, 50, 0, 50, 100},
+        {0, 50, 50, 10, 0},
+        {64, 90, 50, 5, 0},
+    };
+
+    for(const auto& m : mixes)
+    {
+        CorpusStats stats;
+        p.label_every     = m[0];
+        p.ref_percent     = m[1];
+        p.fwd_percent     = m[2];
+        p.dir_percent     = m[3];
+        p.comment_percent = m[4];
+        std::string text = genCorpus(p, &stats);
+        if(this->verbose)
+        {
+            std::cout << stats.num_labels << " labels, " << stats.num_refs << " refs ("
+                << stats.num_fwd_refs << " forward), " << stats.num_directives
+                << " directives" << std::endl;
+        }
+
+        Lexer lexer(machine.getOpTable());
+        lexer.loadBuffer(text);
+        const SourceInfo& src = lexer.lex();
+        ASSERT_FALSE(src.hasError());
+        ASSERT_EQ(stats.num_labels, lexer.getSymTable().getNumSyms());
+        if(m[0] == 0)
+        {
+            ASSERT_EQ(0u, stats.num_refs);
+        }
+        if(m[0] == 1 && m[1] == 100)
+        {
+            ASSERT_EQ(stats.num_instrs, stats.num_refs);
+        }
+        // References only go the other way when there is nothing
+        // to refer to in the direction asked for
+        if(m[2] == 0)
+        {
+            ASSERT_LT(stats.num_fwd_refs, stats.num_refs / 20);
+        }
+        if(m[2] == 100)
+        {
+            ASSERT_LT(stats.num_refs - stats.num_fwd_refs, stats.num_refs / 20);
+        }
+
+        Assembler as(lexer.takeSrcInfo());
+        as.assemble();
+        ASSERT_EQ(0u, as.getNumErr());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+/* TEST_DFA
+ * Test the table driven scanner
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <gtest/gtest.h>
+// Modules under test
+#include "dfa.hpp"
+#include "scan.hpp"
+
+class TestDfa : public ::testing::Test
+{
+    protected:
+        TestDfa() {}
+        virtual ~TestDfa() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// The table is built at compile time, so scans can run there too
+static_assert(lex_dfa_run("  ADD R1", 0, LEX_DFA_TOKEN).tok_start == 2, "token should start after the blanks");
+static_assert(lex_dfa_run("  ADD R1", 0, LEX_DFA_TOKEN).tok_end == 5, "token should end at the blank");
+static_assert(lex_dfa_run("R1, R2", 0, LEX_DFA_TOKEN).pos == 3, "the separator after a token is eaten");
+static_assert(lex_dfa_run(" \n\n ; x\nA", 0, LEX_DFA_LINE).lines == 3, "lines are counted on the way");
+
+// Random text made mostly of the characters the scans care about
+static std::string test_make_text(const size_t len, const unsigned int seed)
+{
+    const char alphabet[] = "  \t\r\n\n,:;\"abcR1#x.";
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, sizeof(alphabet) - 2);
+    std::string text;
+
+    for(size_t i = 0; i < len; ++i)
+        text += alphabet[dist(gen)];
+    text[len / 2] = '\0';
+
+    return text;
+}
+
+// Characters that end a token
+static bool test_token_end(const char c)
+{
+    return (lex_char_is(c, LEX_CC_TOKEN_END) || c == '\0') ? true : false;
+}
+
+TEST_F(TestDfa, test_table)
+{
+    // Every transition is to a real state, and states past the 
+    // end of the spec just stop
+    for(int s = 0; s < LEX_DFA_NUM_STATES; ++s)
+    {
+        for(int c = 0; c < LEX_DFA_NUM_CLASSES; ++c)
+        {
+            uint8_t next = lex_dfa_table.next[s][c] & LEX_DFA_STATE_MASK;
+            ASSERT_LE(next, LEX_DFA_STOP);
+            if(s >= LEX_DFA_STOP)
+            {
+                ASSERT_EQ(LEX_DFA_STOP, lex_dfa_table.next[s][c]);
+            }
+        }
+    }
+    ASSERT_EQ(LEX_DFA_C_SPACE, lex_dfa_table.cls[(uint8_t) '\t']);
+    ASSERT_EQ(LEX_DFA_C_NEWLINE, lex_dfa_table.cls[(uint8_t) '\n']);
+    ASSERT_EQ(LEX_DFA_C_SEP, lex_dfa_table.cls[(uint8_t) ':']);
+    ASSERT_EQ(LEX_DFA_C_COMMENT, lex_dfa_table.cls[(uint8_t) ';']);
+    ASSERT_EQ(LEX_DFA_C_QUOTE, lex_dfa_table.cls[(uint8_t) '"']);
+    ASSERT_EQ(LEX_DFA_C_NUL, lex_dfa_table.cls[0]);
+    ASSERT_EQ(LEX_DFA_C_OTHER, lex_dfa_table.cls[(uint8_t) '#']);
+    ASSERT_EQ(LEX_DFA_C_OTHER, lex_dfa_table.cls[0xFF]);
+}
+
+// Blanks and comments agree with the bulk scans
+TEST_F(TestDfa, test_blank_comment)
+{
+    for(unsigned int seed = 0; seed < 8; ++seed)
+    {
+        std::string text = test_make_text(1000, seed);
+        for(size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            bool on_nl = (pos < text.size() && text[pos] == '\n');
+            unsigned int exp_lines = 0;
+            size_t exp = lex_scan_blank_scalar(text.data(), pos, text.size(), false, exp_lines);
+            LexDfaScan r = lex_dfa_run(text, pos, LEX_DFA_BLANK);
+            ASSERT_EQ(exp, r.pos) << "seed " << seed << " pos " << pos;
+            ASSERT_EQ(exp_lines - on_nl, r.lines) << "seed " << seed << " pos " << pos;
+
+            exp = lex_scan_line_end_scalar(text.data(), pos, text.size());
+            r   = lex_dfa_run(text, pos, LEX_DFA_COMMENT);
+            ASSERT_EQ(exp, r.pos) << "seed " << seed << " pos " << pos;
+            ASSERT_EQ((exp > pos && exp < text.size() && text[exp] == '\n') ? 1u : 0u, r.lines);
+        }
+    }
+}
+
+TEST_F(TestDfa, test_token)
+{
+    for(unsigned int seed = 0; seed < 8; ++seed)
+    {
+        std::string text = test_make_text(1000, seed);
+        for(size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            unsigned int exp_lines = 0;
+            size_t start = lex_scan_blank_scalar(text.data(), pos, text.size(), true, exp_lines);
+            size_t end = start;
+            while(end < text.size() && !test_token_end(text[end]))
+                end++;
+            size_t stop = end;
+            if(stop < text.size() && lex_char_is(text[stop], LEX_CC_SEPARATOR))
+                stop++;
+            if(stop > pos && stop < text.size() && text[stop] == '\n')
+                exp_lines++;
+            if(pos < text.size() && text[pos] == '\n')
+                exp_lines--;
+
+            LexDfaScan r = lex_dfa_run(text, pos, LEX_DFA_TOKEN);
+            ASSERT_EQ(start, r.tok_start) << "seed " << seed << " pos " << pos;
+            ASSERT_EQ(end, r.tok_end) << "seed " << seed << " pos " << pos;
+            ASSERT_EQ(stop, r.pos) << "seed " << seed << " pos " << pos;
+            ASSERT_EQ(exp_lines, r.lines) << "seed " << seed << " pos " << pos;
+        }
+    }
+}
+
+TEST_F(TestDfa, test_string)
+{
+    typedef struct
+    {
+        const char*  text;
+        const char*  token;
+        size_t       pos;
+        unsigned int lines;
+    } StrCase;
+    StrCase cases[] = {
+        {"  \"Hello\" ; c",   "Hello",     9,  0},
+        {"\"a, b; c\"\n",     "a, b; c",   9,  1},
+        {"  \"open\n  x",     "open",      7,  1},
+        {"\"\"x",             "",          2,  0},
+        {"no quote",          "",          8,  0},
+        {"\n\"x\"",           "x",         4,  0},
+        {" \n \"x\"",         "x",         6,  1},
+    };
+
+    for(const StrCase& c : cases)
+    {
+        std::string_view text = c.text;
+        LexDfaScan r = lex_dfa_run(text, 0, LEX_DFA_STRING);
+        if(this->verbose)
+            std::cout << "[" << text.substr(r.tok_start, r.tok_end - r.tok_start) << "]" << std::endl;
+        ASSERT_EQ(c.token, text.substr(r.tok_start, r.tok_end - r.tok_start)) << c.text;
+        ASSERT_EQ(c.pos, r.pos) << c.text;
+        ASSERT_EQ(c.lines, r.lines) << c.text;
+    }
+}
+
+TEST_F(TestDfa, test_line)
+{
+    std::string_view text = "  ; comment\n\n\t; another\n   LOOP ADD R1";
+    LexDfaScan r = lex_dfa_run(text, 0, LEX_DFA_LINE);
+
+    ASSERT_EQ(text.find("LOOP"), r.pos);
+    ASSERT_EQ(3u, r.lines);
+    // Already on a line
+    r = lex_dfa_run(text, r.pos, LEX_DFA_LINE);
+    ASSERT_EQ(text.find("LOOP"), r.pos);
+    ASSERT_EQ(0u, r.lines);
+    // Only comments to the end
+    r = lex_dfa_run("; x\n;y", 0, LEX_DFA_LINE);
+    ASSERT_EQ(6u, r.pos);
+    ASSERT_EQ(1u, r.lines);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
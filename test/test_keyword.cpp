@@ -0,0 +1,89 @@
+/* TEST_KEYWORD
+ * Test the keyword perfect hash
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <string>
+#include <gtest/gtest.h>
+// Modules under test
+#include "keyword.hpp"
+#include "lc3.hpp"
+#include "lexer.hpp"
+
+class TestKeyword : public ::testing::Test
+{
+    protected:
+        TestKeyword() {}
+        virtual ~TestKeyword() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// Lookup works in a constant expression
+static_assert(lex_keyword_find("ADD") != LEX_KW_NONE, "ADD should be a keyword");
+static_assert(lex_keyword_find("loop") == LEX_KW_NONE, "loop should not be a keyword");
+
+static std::string test_lower(const std::string_view& s)
+{
+    std::string out(s);
+    for(char& c : out)
+        c = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    return out;
+}
+
+// Check that every entry in an opcode list is found with the right kind
+static void test_check_list(const Opcode* list, const unsigned int n, const uint8_t kind)
+{
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        if(list[i].mnemonic == ".INVALID")
+            continue;
+        int id = lex_keyword_find(list[i].mnemonic);
+        ASSERT_NE(LEX_KW_NONE, id) << list[i].mnemonic;
+        ASSERT_EQ(list[i].mnemonic, std::string(lex_keyword(id).name));
+        ASSERT_EQ(kind, lex_keyword(id).kind);
+        ASSERT_EQ(list[i].opcode, lex_keyword(id).opcode);
+        // Case is ignored
+        ASSERT_EQ(id, lex_keyword_find(test_lower(list[i].mnemonic)));
+    }
+}
+
+TEST_F(TestKeyword, test_lists)
+{
+    unsigned int num_ops  = sizeof(lc3_op_list) / sizeof(lc3_op_list[0]);
+    unsigned int num_trap = sizeof(lc3_psuedo_op_list) / sizeof(lc3_psuedo_op_list[0]);
+    unsigned int num_dir  = sizeof(LEX_ASM_DIRECTIVE_OPCODES) / sizeof(LEX_ASM_DIRECTIVE_OPCODES[0]);
+
+    if(this->verbose)
+        std::cout << "\t Keyword hash seed : " << lex_keyword_hash.seed << std::endl;
+
+    test_check_list(lc3_op_list, num_ops, LEX_KW_OP);
+    test_check_list(lc3_psuedo_op_list, num_trap, LEX_KW_TRAP);
+    test_check_list(LEX_ASM_DIRECTIVE_OPCODES, num_dir, LEX_KW_DIR);
+    // Nothing in the keyword list that isn't in one of the lists
+    ASSERT_EQ(num_ops + num_trap + num_dir - 1, LEX_NUM_KEYWORDS);
+}
+
+TEST_F(TestKeyword, test_not_keyword)
+{
+    const char* tokens[] = {
+        "", "A", "AD", "ADDX", "XADD", "R1", "#10", "x3000", "LOOP",
+        ".ORIGX", ".ORI", "ORIG", ".INVALID", "BRpz", "STRINGZZZ", "HALT:"
+    };
+
+    for(const char* tok : tokens)
+        ASSERT_EQ(LEX_KW_NONE, lex_keyword_find(tok)) << tok;
+    // A token that is a slice of a longer string
+    std::string_view line = "ADDR1";
+    ASSERT_EQ(LEX_KW_NONE, lex_keyword_find(line));
+    ASSERT_NE(LEX_KW_NONE, lex_keyword_find(line.substr(0, 3)));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
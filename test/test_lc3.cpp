@@ -100,6 +100,155 @@ TEST_F(TestLC3, test_sentinel)
     ASSERT_EQ(0, m_status);       // fail (possibly) AFTER printing the trace
 }
 
+TEST_F(TestLC3, test_run_stats)
+{
+    unsigned int max_cycles = 20;
+    std::string src_filename = "data/add_test.asm";
+    LC3 machine;
+
+    Lexer lexer(machine.getOpTable(), src_filename);
+    SourceInfo src_info = lexer.lex();
+    Assembler as(src_info);
+    as.assemble();
+    machine.loadMemProgram(as.getProgram());
+    machine.enable();
+
+    // Counters are optional - the run must work either way
+    bool have_perf = machine.setPerf(true);
+    ASSERT_EQ(have_perf, machine.getPerf());
+
+    int stop = machine.run(max_cycles);
+    ASSERT_EQ(LC3_STOP_HALT, stop);
+
+    // LD, LD, ADD, HALT
+    LC3Stats stats = machine.getStats();
+    ASSERT_EQ(4, stats.instr_retired);
+    ASSERT_EQ(2, stats.opcode_count[LC3_LD]);
+    ASSERT_EQ(1, stats.opcode_count[LC3_ADD]);
+    ASSERT_EQ(1, stats.opcode_count[LC3_TRAP]);
+    ASSERT_EQ(0, stats.opcode_count[LC3_ST]);
+    ASSERT_EQ(1, stats.traps);
+    // Two loads plus the trap vector read, and the trap
+    // clears the clock enable in the MCR
+    ASSERT_EQ(3, stats.mem_reads);
+    ASSERT_EQ(1, stats.mem_writes);
+    ASSERT_EQ(0, stats.mmio_reads);
+    ASSERT_EQ(1, stats.mmio_writes);
+    ASSERT_GT(stats.wall_time, 0.0);
+    ASSERT_GT(stats.mips(), 0.0);
+    ASSERT_EQ(have_perf, stats.perf.anyValid());
+    std::cout << stats.toString();
+
+    // Once halted there is nothing more to run 
+    ASSERT_EQ(LC3_STOP_HALT, machine.run(max_cycles));
+    ASSERT_EQ(4, machine.getStats().instr_retired);
+
+    machine.resetStats();
+    stats = machine.getStats();
+    ASSERT_EQ(0, stats.instr_retired);
+    ASSERT_EQ(0, stats.opcode_count[LC3_LD]);
+    ASSERT_EQ(0, stats.mem_reads);
+    ASSERT_EQ(0.0, stats.wall_time);
+    ASSERT_EQ(0.0, stats.mips());
+}
+
+// Assemble straight into the machine and run, which should be the
+// same as loading the assembled program
+TEST_F(TestLC3, test_asm_run)
+{
+    unsigned int max_cycles = 20;
+    std::string src_filename = "data/add_test.asm";
+    LC3 prog_machine;
+    LC3 machine;
+
+    Lexer prog_lexer(prog_machine.getOpTable(), src_filename);
+    SourceInfo src_info = prog_lexer.lex();
+    Assembler prog_as(src_info);
+    prog_as.assemble();
+    prog_machine.loadMemProgram(prog_as.getProgram());
+    prog_machine.enable();
+    ASSERT_EQ(LC3_STOP_HALT, prog_machine.run(max_cycles));
+
+    Lexer lexer(machine.getOpTable(), src_filename);
+    Assembler as;
+    AsmImage image;
+    ASSERT_EQ(0, as.assemble(lexer, machine, image));
+    ASSERT_EQ(0x3000, image.entry);
+    ASSERT_EQ(6, image.num_words);
+    ASSERT_EQ(0x3004, image.sym_table.getAddr("Val1"));
+    machine.enable(image.entry);
+    ASSERT_EQ(LC3_STOP_HALT, machine.run(max_cycles));
+
+    ASSERT_EQ(prog_machine.dumpMem(), machine.dumpMem());
+    LC3Proc exp_state = prog_machine.getProcState();
+    LC3Proc state     = machine.getProcState();
+    for(int r = 0; r < 8; ++r)
+        ASSERT_EQ(exp_state.gpr[r], state.gpr[r]) << "R" << r;
+    ASSERT_EQ(exp_state.pc, state.pc);
+}
+
+TEST_F(TestLC3, test_breakpoint)
+{
+    unsigned int max_cycles = 20;
+    std::string src_filename = "data/add_test.asm";
+    LC3 machine;
+
+    Lexer lexer(machine.getOpTable(), src_filename);
+    SourceInfo src_info = lexer.lex();
+    Assembler as(src_info);
+    as.assemble();
+    machine.loadMemProgram(as.getProgram());
+    machine.enable();
+
+    // Stop before the ADD executes
+    machine.setBreakpoint(0x3002);
+    ASSERT_EQ(true, machine.isBreakpoint(0x3002));
+    ASSERT_EQ(false, machine.isBreakpoint(0x3001));
+    ASSERT_EQ(LC3_STOP_BREAK, machine.run(max_cycles));
+    ASSERT_EQ(0x3002, machine.getProcState().pc);
+    ASSERT_EQ(0x3002, machine.getStopAddr());
+    ASSERT_EQ(2, machine.getStats().instr_retired);
+
+    // Running again steps over the breakpoint
+    ASSERT_EQ(LC3_STOP_HALT, machine.run(max_cycles));
+    ASSERT_EQ(4, machine.getStats().instr_retired);
+}
+
+TEST_F(TestLC3, test_watchpoint)
+{
+    unsigned int max_cycles = 20;
+    std::string src_filename = "data/add_test.asm";
+    LC3 machine;
+
+    Lexer lexer(machine.getOpTable(), src_filename);
+    SourceInfo src_info = lexer.lex();
+    Assembler as(src_info);
+    as.assemble();
+
+    // The first LD reads Val1
+    uint16_t ld_adr = lexer.getSymTable().getAddr("Val1");
+    ASSERT_EQ(0x3004, ld_adr);
+
+    // A write watch on that address never triggers
+    machine.loadMemProgram(as.getProgram());
+    machine.enable();
+    machine.setWatchWrite(ld_adr);
+    ASSERT_EQ(LC3_STOP_HALT, machine.run(max_cycles));
+    ASSERT_EQ(4, machine.getStats().instr_retired);
+
+    // A read watch stops after the LD
+    machine.clearDebug();
+    machine.resetCPU();
+    machine.loadMemProgram(as.getProgram());
+    machine.enable();
+    machine.resetStats();
+    machine.setWatchRead(ld_adr);
+    ASSERT_EQ(LC3_STOP_WATCH_RD, machine.run(max_cycles));
+    ASSERT_EQ(ld_adr, machine.getStopAddr());
+    ASSERT_EQ(0x3001, machine.getProcState().pc);
+    ASSERT_EQ(1, machine.getProcState().gpr[1]);
+    ASSERT_EQ(1, machine.getStats().instr_retired);
+}
 
 // Test the simple add program 
 //TEST_F(TestLC3, test_simple_add)
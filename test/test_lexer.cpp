@@ -4,9 +4,14 @@
  * Stefan Wong 2018
  * */
 
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
 #include <string>
 #include <gtest/gtest.h>
 // Modules under test 
@@ -16,6 +21,49 @@
 
 //#define DUMP_SOURCE
 
+// Count calls to operator new, so that tests can check how much 
+// the lexer allocates
+static std::atomic<uint64_t> test_num_alloc(0);
+
+void* operator new(std::size_t size)
+{
+    test_num_alloc.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc((size > 0) ? size : 1);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+// GCC sees free() of something that came from new, not knowing
+// that this is the new it came from
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+#pragma GCC diagnostic pop
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t size) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t size) noexcept
+{
+    operator delete(p);
+}
+
 // TODO: move this to util function?
 // Helper function to build op table for testing lexer
 OpcodeTable test_build_op_table(void)
@@ -87,8 +135,8 @@ void TestLexer::SetUp(void)
 TEST_F(TestLexer, test_init)
 {
     Lexer l(this->op_table, this->src_file);
-    // +1 on length is due to inserting a NULL at the end 
-    ASSERT_EQ(this->src_length+1, l.getSrcLength());
+    // The source is lexed in place, so the length is the file size
+    ASSERT_EQ(this->src_length, l.getSrcLength());
     ASSERT_EQ(this->src_file, l.getFilename());
 
     // Also test that we can create a 'blank' lexer 
@@ -115,8 +163,8 @@ SourceInfo get_add_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 6;
     line.addr            = 0x3000-1;
-    line.opcode.mnemonic = ".ORIG";
-    line.opcode.opcode   = 0;
+    line.mnemonic = info.intern(".ORIG");
+    line.opcode   = 0;
     line.imm             = 0x3000;
     line.is_directive    = true;
     info.add(line);
@@ -124,28 +172,28 @@ SourceInfo get_add_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 7;
     line.addr            = 0x3000;
-    line.opcode.mnemonic = "LD";
-    line.opcode.opcode   = 0x02;
+    line.mnemonic = info.intern("LD");
+    line.opcode   = 0x02;
     line.arg1            = 0x01;
     line.imm             = 0x3004;
-    line.symbol          = "Val1";
+    line.symbol          = info.intern("Val1");
     info.add(line);
     // Line 8 (LD,R2,Val2)
     initLineInfo(line);
     line.line_num        = 8;
     line.addr            = 0x3001;
-    line.opcode.mnemonic = "LD";
-    line.opcode.opcode   = 0x02;
+    line.mnemonic = info.intern("LD");
+    line.opcode   = 0x02;
     line.arg1            = 0x02;
     line.imm             = 0x3005;
-    line.symbol          = "Val2";
+    line.symbol          = info.intern("Val2");
     info.add(line);
     // Line 9 (ADD R3,R1,R2)
     initLineInfo(line);
     line.line_num        = 9;
     line.addr            = 0x3002;
-    line.opcode.mnemonic = "ADD";
-    line.opcode.opcode   = 0x01;
+    line.mnemonic = info.intern("ADD");
+    line.opcode   = 0x01;
     line.arg1            = 0x03;
     line.arg2            = 0x01;
     line.arg3            = 0x02;
@@ -154,17 +202,17 @@ SourceInfo get_add_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 10;
     line.addr            = 0x3003;
-    line.opcode.opcode   = 0x0F;
-    line.opcode.mnemonic = "TRAP";
+    line.opcode   = 0x0F;
+    line.mnemonic = info.intern("TRAP");
     line.imm             = 0x25;
     info.add(line);
     // Line 11 (Val1 .FILL #1)
     initLineInfo(line);
     line.line_num        = 11;
     line.addr            = 0x3004;
-    line.opcode.opcode   = 0x0;
-    line.opcode.mnemonic = ".FILL";
-    line.label           = "Val1";
+    line.opcode   = 0x0;
+    line.mnemonic = info.intern(".FILL");
+    line.label           = info.intern("Val1");
     line.imm             = 1;
     line.is_label        = true;
     line.is_directive    = true;
@@ -173,9 +221,9 @@ SourceInfo get_add_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 12;
     line.addr            = 0x3005;
-    line.opcode.opcode   = 0x0;
-    line.opcode.mnemonic = ".FILL";
-    line.label           = "Val2";
+    line.opcode   = 0x0;
+    line.mnemonic = info.intern(".FILL");
+    line.label           = info.intern("Val2");
     line.imm             = 2;
     line.is_label        = true;
     line.is_directive    = true;
@@ -184,8 +232,8 @@ SourceInfo get_add_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 13;
     line.addr            = 0x3006;
-    line.opcode.opcode   = 0x0;
-    line.opcode.mnemonic = ".END";
+    line.opcode   = 0x0;
+    line.mnemonic = info.intern(".END");
     line.is_directive    = true;
     info.add(line);
 
@@ -201,8 +249,8 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 6;
     line.addr            = 0x3000-1;
-    line.opcode.mnemonic = ".ORIG";
-    line.opcode.opcode   = 0;
+    line.mnemonic = info.intern(".ORIG");
+    line.opcode   = 0;
     line.imm             = 0x3000;
     line.is_directive    = true;
     info.add(line);
@@ -210,18 +258,18 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 7;
     line.addr            = 0x3000;
-    line.opcode.mnemonic = "LEA";
-    line.opcode.opcode   = 0xE;
+    line.mnemonic = info.intern("LEA");
+    line.opcode   = 0xE;
     line.arg1            = 0x01;
     line.imm             = 0x3009;
-    line.symbol          = "FirstVal";
+    line.symbol          = info.intern("FirstVal");
     info.add(line);
     // Line 8 (AND R3,R3,#0)
     initLineInfo(line);
     line.line_num        = 8;
     line.addr            = 0x3001;
-    line.opcode.mnemonic = "AND";
-    line.opcode.opcode   = 0x05;
+    line.mnemonic = info.intern("AND");
+    line.opcode   = 0x05;
     line.arg1            = 3;
     line.arg2            = 3;
     line.imm             = 0;
@@ -231,8 +279,8 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 9;
     line.addr            = 0x3002;
-    line.opcode.mnemonic = "LDR";
-    line.opcode.opcode   = 0x06;
+    line.mnemonic = info.intern("LDR");
+    line.opcode   = 0x06;
     line.arg1            = 4;
     line.arg2            = 1;
     line.imm             = 0;
@@ -242,11 +290,11 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 10;
     line.addr            = 0x3003;
-    line.opcode.mnemonic = "BRn";
+    line.mnemonic = info.intern("BRn");
     line.flags           = 0x4;     // negative flag
-    line.opcode.opcode   = 0x0;
-    line.symbol          = "Done";
-    line.label           = "TestEnd";
+    line.opcode   = 0x0;
+    line.symbol          = info.intern("Done");
+    line.label           = info.intern("TestEnd");
     line.is_label        = true;
     line.imm             = 0x3008;  // addr of 'Done'
     info.add(line);
@@ -254,8 +302,8 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 11;
     line.addr            = 0x3004;
-    line.opcode.mnemonic = "ADD";
-    line.opcode.opcode   = 0x01;
+    line.mnemonic = info.intern("ADD");
+    line.opcode   = 0x01;
     line.arg1            = 3;
     line.arg2            = 3;
     line.arg3            = 4;
@@ -264,8 +312,8 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 12;
     line.addr            = 0x3005;
-    line.opcode.mnemonic = "ADD";
-    line.opcode.opcode   = 0x01;
+    line.mnemonic = info.intern("ADD");
+    line.opcode   = 0x01;
     line.arg1            = 1;
     line.arg2            = 1;
     line.imm             = 1;
@@ -275,8 +323,8 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 13;
     line.addr            = 0x3006;
-    line.opcode.mnemonic = "LDR";
-    line.opcode.opcode   = 0x06;
+    line.mnemonic = info.intern("LDR");
+    line.opcode   = 0x06;
     line.arg1            = 4;
     line.arg2            = 1;
     line.imm             = 0;
@@ -286,30 +334,30 @@ SourceInfo get_sentinel_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 14;
     line.addr            = 0x3007;
-    line.opcode.mnemonic = "BRnzp";
+    line.mnemonic = info.intern("BRnzp");
     line.flags           = 0x7;     // all flags
-    line.opcode.opcode   = 0x0;
-    line.symbol          = "TestEnd";
+    line.opcode   = 0x0;
+    line.symbol          = info.intern("TestEnd");
     line.imm             = 0x3003;
     info.add(line);
     // Line 16 (Done: Halt)
     initLineInfo(line);
     line.line_num        = 16;
     line.addr            = 0x3008;
-    line.opcode.mnemonic = "TRAP";
-    line.opcode.opcode   = 0xF;
+    line.mnemonic = info.intern("TRAP");
+    line.opcode   = 0xF;
     line.imm             = 0x25;
-    line.label           = "Done";
+    line.label           = info.intern("Done");
     line.is_label        = true;
     info.add(line);
     // Line 17 (FirstVal: .FILL #64)
     initLineInfo(line);
     line.line_num        = 17;
     line.addr            = 0x3009;
-    line.opcode.mnemonic = ".FILL";
-    line.opcode.opcode   = 0x0;
+    line.mnemonic = info.intern(".FILL");
+    line.opcode   = 0x0;
     line.imm             = 64;
-    line.label           = "FirstVal";
+    line.label           = info.intern("FirstVal");
     line.is_label        = true;
     line.is_directive    = true;
     info.add(line);
@@ -352,7 +400,7 @@ TEST_F(TestLexer, test_lex_add)
         LineInfo lex_line = lsource.get(idx);
         LineInfo exp_line = expected_info.get(idx);
         std::cout << "Checking line " << idx+1 << "(source line " << std::dec << lex_line.line_num << ") ...";
-        ASSERT_EQ(true, compLineInfo(lex_line, exp_line));
+        ASSERT_EQ(true, compLineInfo(lsource, lex_line, expected_info, exp_line));
         std::cout << " done" << std::endl;
     }
 }
@@ -392,9 +440,9 @@ TEST_F(TestLexer, test_lex_sentinel)
         LineInfo lex_line = lsource.get(idx);
         LineInfo exp_line = expected_info.get(idx);
         std::cout << "Checking line " << idx+1 << "(source line " << std::dec << lex_line.line_num << ") ...";
-        std::cout << "<" << lex_line.opcode.mnemonic << ">";
-        printLineDiff(lex_line, exp_line);
-        ASSERT_EQ(true, compLineInfo(lex_line, exp_line));
+        std::cout << "<" << lsource.getStr(lex_line.mnemonic) << ">";
+        printLineDiff(lsource, lex_line, expected_info, exp_line);
+        ASSERT_EQ(true, compLineInfo(lsource, lex_line, expected_info, exp_line));
         std::cout << " done" << std::endl;
     }
 }
@@ -408,8 +456,8 @@ SourceInfo get_stringz_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 7;
     line.addr            = 0x3010 - 1;
-    line.opcode.mnemonic = ".ORIG";
-    line.opcode.opcode   = 0;
+    line.mnemonic = info.intern(".ORIG");
+    line.opcode   = 0;
     line.imm             = 0x3010;
     line.is_directive    = true;
     info.add(line);
@@ -417,10 +465,10 @@ SourceInfo get_stringz_test_source_info(void)
     initLineInfo(line);
     line.line_num        = 8;
     line.addr            = 0x3010;
-    line.opcode.mnemonic = ".STRINGZ";
-    line.opcode.opcode   = 0;
-    line.symbol          = "Hello, World!";
-    line.label           = "HELLO";
+    line.mnemonic = info.intern(".STRINGZ");
+    line.opcode   = 0;
+    line.symbol          = info.intern("Hello, World!");
+    line.label           = info.intern("HELLO");
     line.is_label        = true;
     line.is_directive    = true;
     info.add(line);
@@ -428,6 +476,443 @@ SourceInfo get_stringz_test_source_info(void)
     return info;
 }
 
+TEST_F(TestLexer, test_lex_buffer)
+{
+    std::string asm_src_filename = "data/add_test.asm";
+    std::ifstream infile(asm_src_filename);
+    std::string text((std::istreambuf_iterator<char>(infile)),
+                      std::istreambuf_iterator<char>());
+    SourceInfo expected_info = get_add_test_source_info();
+
+    // Lex a buffer that we own 
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    ASSERT_EQ(text.size(), lexer.getSrcLength());
+    SourceInfo lsource = lexer.lex();
+    ASSERT_EQ(false, lsource.hasError());
+    ASSERT_EQ(expected_info.getNumLines(), lsource.getNumLines());
+    for(unsigned int idx = 0; idx < expected_info.getNumLines(); ++idx)
+    {
+        LineInfo lex_line = lsource.get(idx);
+        ASSERT_EQ(true, compLineInfo(lsource, lex_line, expected_info, expected_info.get(idx)));
+        // Symbols and labels point into the buffer rather than
+        // being copied out of it
+        std::string_view symbol = lsource.getStr(lex_line.symbol);
+        std::string_view label  = lsource.getStr(lex_line.label);
+        if(symbol.size() > 0)
+        {
+            ASSERT_GE(symbol.data(), text.data());
+            ASSERT_LT(symbol.data(), text.data() + text.size());
+        }
+        if(label.size() > 0)
+        {
+            ASSERT_GE(label.data(), text.data());
+            ASSERT_LT(label.data(), text.data() + text.size());
+        }
+    }
+}
+
+TEST_F(TestLexer, test_lex_source_lifetime)
+{
+    SourceInfo lsource;
+    SymbolTable sym_table;
+
+    // The lexed output keeps the mapped file alive after the
+    // lexer is gone
+    {
+        Lexer lexer(this->op_table, "data/add_test.asm");
+        lsource   = lexer.lex();
+        sym_table = lexer.dumpSymTable();
+        ASSERT_EQ(true, lsource.getSource()->isMapped());
+    }
+    SourceInfo expected_info = get_add_test_source_info();
+    for(unsigned int idx = 0; idx < expected_info.getNumLines(); ++idx)
+        ASSERT_EQ(true, compLineInfo(lsource, lsource.get(idx), expected_info, expected_info.get(idx)));
+    ASSERT_EQ(2, sym_table.getNumSyms());
+    ASSERT_EQ("Val1", sym_table.get(0).label);
+    ASSERT_EQ("Val2", sym_table.get(1).label);
+}
+
+TEST_F(TestLexer, test_lex_stream)
+{
+    Lexer batch_lexer(this->op_table, "data/sentinel.asm");
+    SourceInfo lsource = batch_lexer.lex();
+    ASSERT_EQ(false, lsource.hasError());
+
+    // Lines come out of the stream one at a time, with labels
+    // left for the caller to look up
+    Lexer lexer(this->op_table, "data/sentinel.asm");
+    const SourceInfo& ssource = lexer.getSourceInfo();
+    LineInfo line;
+    uint16_t addr;
+    unsigned int num_lines = 0;
+
+    lexer.begin();
+    // Done is a forward reference, so isn't known yet
+    ASSERT_EQ(false, lexer.findSymbol("Done", addr));
+    while(lexer.nextLine(line))
+    {
+        LineInfo exp_line = lsource.get(num_lines);
+        ASSERT_EQ(exp_line.line_num, line.line_num);
+        ASSERT_EQ(exp_line.addr, line.addr);
+        ASSERT_EQ(exp_line.opcode, line.opcode);
+        ASSERT_EQ(lsource.getStr(exp_line.mnemonic), ssource.getStr(line.mnemonic));
+        ASSERT_EQ(lsource.getStr(exp_line.symbol), ssource.getStr(line.symbol));
+        num_lines++;
+    }
+    ASSERT_EQ(lsource.getNumLines(), num_lines);
+    ASSERT_EQ(false, lexer.nextLine(line));
+    ASSERT_EQ(true, lexer.findSymbol("Done", addr));
+    ASSERT_EQ(0x3008, addr);
+}
+
+// Compare the output of two lexers line by line 
+static void test_comp_source(const SourceInfo& a, const SymbolTable& sa,
+        const SourceInfo& b, const SymbolTable& sb)
+{
+    ASSERT_EQ(a.hasError(), b.hasError());
+    ASSERT_EQ(a.getNumLines(), b.getNumLines());
+    for(unsigned int idx = 0; idx < a.getNumLines(); ++idx)
+    {
+        LineInfo la = a.get(idx);
+        LineInfo lb = b.get(idx);
+        if(!compLineInfo(a, la, b, lb))
+        {
+            std::cout << "Line " << idx << " differs" << std::endl;
+            printLineDiff(a, la, b, lb);
+        }
+        ASSERT_EQ(true, compLineInfo(a, la, b, lb));
+    }
+    ASSERT_EQ(sa.getNumSyms(), sb.getNumSyms());
+    for(unsigned int idx = 0; idx < sa.getNumSyms(); ++idx)
+    {
+        ASSERT_EQ(sa.get(idx).label, sb.get(idx).label);
+        ASSERT_EQ(sa.get(idx).addr, sb.get(idx).addr);
+    }
+}
+
+TEST_F(TestLexer, test_lex_parallel)
+{
+    std::string text = "\n";
+    std::vector<std::string> src_files = {
+        "data/pow10.asm", "data/sentinel.asm", "data/add_test.asm"
+    };
+    for(const std::string& src_filename : src_files)
+    {
+        std::ifstream infile(src_filename);
+        text.append((std::istreambuf_iterator<char>(infile)),
+                     std::istreambuf_iterator<char>());
+        // Lines with no .ORIG before them in their chunk 
+        text += "\n\n    .BLKW #4\nMore ADD R1, R1, #1\n\n  \n    BRnzp More\n";
+    }
+
+    Lexer seq_lexer(this->op_table);
+    seq_lexer.loadBuffer(text);
+    SourceInfo seq_source = seq_lexer.lex();
+    SymbolTable seq_syms  = seq_lexer.dumpSymTable();
+    ASSERT_EQ(false, seq_source.hasError());
+
+    // Chunks from a few lines up to the whole source 
+    std::vector<size_t> chunk_sizes = {1, 7, 16, 61, 200, 1024, text.size()};
+    for(size_t chunk_size : chunk_sizes)
+    {
+        std::cout << "Checking chunk size " << std::dec << chunk_size << std::endl;
+        Lexer par_lexer(this->op_table);
+        par_lexer.loadBuffer(text);
+        SourceInfo par_source = par_lexer.lexParallel(4, chunk_size);
+        test_comp_source(seq_source, seq_syms, par_source, par_lexer.dumpSymTable());
+    }
+
+    // A label on its own line carries on to the next line, so this
+    // has to fall back to lexing in one go
+    std::string label_text = "    .ORIG x3000\nStart\n    ADD R1, R1, #1\n    BRnzp Start\n";
+    Lexer label_seq(this->op_table);
+    label_seq.loadBuffer(label_text);
+    SourceInfo label_source = label_seq.lex();
+    for(size_t chunk_size : chunk_sizes)
+    {
+        Lexer par_lexer(this->op_table);
+        par_lexer.loadBuffer(label_text);
+        SourceInfo par_source = par_lexer.lexParallel(4, chunk_size);
+        test_comp_source(label_source, label_seq.dumpSymTable(), par_source, par_lexer.dumpSymTable());
+    }
+    // Lexing stops at the first error in either case 
+    std::string err_text = text.substr(0, text.size() / 2) + "\n    .BOGUS x10\n" + text;
+    Lexer err_seq(this->op_table);
+    err_seq.loadBuffer(err_text);
+    SourceInfo err_source = err_seq.lex();
+    ASSERT_EQ(true, err_source.hasError());
+    for(size_t chunk_size : chunk_sizes)
+    {
+        Lexer par_lexer(this->op_table);
+        par_lexer.loadBuffer(err_text);
+        SourceInfo par_source = par_lexer.lexParallel(4, chunk_size);
+        test_comp_source(err_source, err_seq.dumpSymTable(), par_source, par_lexer.dumpSymTable());
+    }
+}
+
+TEST_F(TestLexer, test_lex_edit)
+{
+    std::string text;
+    std::vector<std::string> src_files = {
+        "data/add_test.asm", "data/sentinel.asm", "data/pow10.asm"
+    };
+    for(const std::string& src_filename : src_files)
+    {
+        std::ifstream infile(src_filename);
+        text.append((std::istreambuf_iterator<char>(infile)),
+                     std::istreambuf_iterator<char>());
+    }
+    std::vector<std::string> insert_lines = {
+        "    ADD R2, R2, #3\n",
+        "    BRnzp Val1\n",
+        "    .BLKW #2\n",
+        "; a comment\n",
+        "\n",
+        "    .ORIG x4000\n",
+        "    LD R1, Val2\n",
+        "    HALT\n"
+    };
+
+    // The lexer keeps its own copy to edit, the buffer it was
+    // given has to stay as it is
+    std::string orig_text = text;
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(orig_text);
+    lexer.lex();
+    ASSERT_EQ(false, lexer.getSourceInfo().hasError());
+
+    // A small edit inside one line only lexes that line again
+    size_t reg = text.find("R1", text.find("ADD"));
+    LexEdit e = lexer.edit(reg, 2, "R3");
+    text.replace(reg, 2, "R3");
+    ASSERT_EQ(false, e.relex_all);
+    ASSERT_EQ(1, e.num_removed);
+    ASSERT_EQ(1, e.num_added);
+    ASSERT_EQ(0, e.line_delta);
+    ASSERT_EQ(0, e.addr_delta);
+    ASSERT_EQ(false, e.relabel);
+
+    // Lots of edits of different kinds, each checked against lexing
+    // the edited text from scratch 
+    std::mt19937 gen(1234);
+    unsigned int num_labels = 0;
+    for(unsigned int n = 0; n < 400; ++n)
+    {
+        // Start of some line
+        size_t pos = gen() % text.size();
+        pos = (pos == 0) ? 0 : text.rfind('\n', pos - 1) + 1;
+        size_t line_end = text.find('\n', pos);
+        line_end = (line_end == std::string::npos) ? text.size() : line_end + 1;
+        std::string ins;
+        size_t len = 0;
+
+        switch(gen() % 5)
+        {
+            case 0:     // new line
+                ins = insert_lines[gen() % insert_lines.size()];
+                break;
+            case 1:     // new label, or a branch to one
+                if(num_labels > 0 && gen() % 2)
+                    ins = "    BRz Lbl" + std::to_string(gen() % num_labels) + "\n";
+                else
+                    ins = "Lbl" + std::to_string(num_labels++) + " AND R4, R4, #0\n";
+                break;
+            case 2:     // remove a line
+                len = line_end - pos;
+                break;
+            case 3:     // change a register
+                pos = text.find(" R", pos);
+                if(pos == std::string::npos || pos + 2 >= text.size())
+                    continue;
+                pos += 2;
+                len = 1;
+                ins = std::to_string(gen() % 8);
+                break;
+            case 4:     // add to a comment
+                pos = text.find(';', pos);
+                if(pos == std::string::npos)
+                    continue;
+                ins = "; more";
+                break;
+        }
+        e = lexer.edit(pos, len, ins);
+        text.replace(pos, len, ins);
+
+        Lexer full_lexer(this->op_table);
+        full_lexer.loadBuffer(text);
+        SourceInfo full_source = full_lexer.lex();
+        test_comp_source(full_source, full_lexer.dumpSymTable(), 
+                lexer.getSourceInfo(), lexer.getSymTable());
+        if(::testing::Test::HasFatalFailure())
+        {
+            std::cout << "Edit " << n << " at " << pos << " (" << len 
+                << " chars) failed" << std::endl;
+            return;
+        }
+    }
+
+    // Edits that come one after another, without the output being 
+    // looked at in between, leave the lines after them to be moved 
+    // when it is
+    for(unsigned int n = 0; n < 100; ++n)
+    {
+        for(unsigned int m = 0; m < 1 + n % 4; ++m)
+        {
+            size_t pos = gen() % text.size();
+            pos = (pos == 0) ? 0 : text.rfind('\n', pos - 1) + 1;
+            size_t line_end = text.find('\n', pos);
+            line_end = (line_end == std::string::npos) ? text.size() : line_end + 1;
+            std::string ins;
+            size_t len = 0;
+
+            switch(gen() % 3)
+            {
+                case 0:     // new line
+                    ins = insert_lines[gen() % insert_lines.size()];
+                    break;
+                case 1:     // blank line at the end of a line
+                    pos = line_end - ((line_end > pos && text[line_end - 1] == '\n') ? 1 : 0);
+                    ins = "\n";
+                    break;
+                case 2:     // remove a line
+                    len = line_end - pos;
+                    break;
+            }
+            lexer.edit(pos, len, ins);
+            text.replace(pos, len, ins);
+        }
+
+        Lexer full_lexer(this->op_table);
+        full_lexer.loadBuffer(text);
+        SourceInfo full_source = full_lexer.lex();
+        test_comp_source(full_source, full_lexer.dumpSymTable(), 
+                lexer.getSourceInfo(), lexer.getSymTable());
+        if(::testing::Test::HasFatalFailure())
+        {
+            std::cout << "Edits up to " << n << " failed" << std::endl;
+            return;
+        }
+        ASSERT_EQ(text, lexer.dumpSrc());
+    }
+
+    // Lexing an edited source in chunks gives the same as lexing it 
+    // in one go, and it can still be edited after
+    Lexer seq_lexer(this->op_table);
+    Lexer par_lexer(this->op_table);
+    seq_lexer.loadBuffer(orig_text);
+    par_lexer.loadBuffer(orig_text);
+    seq_lexer.lex();
+    par_lexer.lex();
+    text = orig_text;
+    for(unsigned int n = 0; n < 4; ++n)
+    {
+        size_t pos = text.rfind('\n', gen() % text.size()) + 1;
+        seq_lexer.edit(pos, 0, insert_lines[0]);
+        par_lexer.edit(pos, 0, insert_lines[0]);
+        text.insert(pos, insert_lines[0]);
+    }
+    SourceInfo seq_source = seq_lexer.lex();
+    SourceInfo par_source = par_lexer.lexParallel(4, 64);
+    ASSERT_EQ(false, seq_source.hasError());
+    test_comp_source(seq_source, seq_lexer.dumpSymTable(), 
+            par_source, par_lexer.dumpSymTable());
+
+    size_t pos = text.rfind('\n', text.size() / 2) + 1;
+    seq_lexer.edit(pos, 0, insert_lines[6]);
+    par_lexer.edit(pos, 0, insert_lines[6]);
+    test_comp_source(seq_lexer.getSourceInfo(), seq_lexer.getSymTable(), 
+            par_lexer.getSourceInfo(), par_lexer.getSymTable());
+}
+
+TEST_F(TestLexer, test_lex_no_newline)
+{
+    // Source that ends in a comment with no trailing newline
+    std::string text = "    .ORIG x3000\n    HALT\n; no newline at the end";
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    SourceInfo lsource = lexer.lex();
+
+    ASSERT_EQ(false, lsource.hasError());
+    ASSERT_EQ(2, lsource.getNumLines());
+}
+
+TEST_F(TestLexer, test_lex_case)
+{
+    // Mnemonics and directives are not case sensitive
+    std::string text = "    .orig x3000\nloop add r1, r1, #1\n    brNZ loop\n    halt\n    .End\n";
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    SourceInfo lsource = lexer.lex();
+
+    ASSERT_EQ(false, lsource.hasError());
+    ASSERT_EQ(5, lsource.getNumLines());
+
+    LineInfo line = lsource.get(0);
+    ASSERT_EQ(true, line.is_directive);
+    ASSERT_EQ(".ORIG", lsource.getStr(line.mnemonic));
+    ASSERT_EQ(0x3000, line.imm);
+    line = lsource.get(1);
+    ASSERT_EQ(true, line.is_label);
+    ASSERT_EQ("ADD", lsource.getStr(line.mnemonic));
+    ASSERT_EQ(LC3_ADD, line.opcode);
+    line = lsource.get(2);
+    ASSERT_EQ("BRnz", lsource.getStr(line.mnemonic));
+    ASSERT_EQ(LC3_FLAG_N | LC3_FLAG_Z, line.flags);
+    line = lsource.get(3);
+    ASSERT_EQ(LC3_TRAP, line.opcode);
+    ASSERT_EQ(0x25, line.imm);
+    line = lsource.get(4);
+    ASSERT_EQ(".END", lsource.getStr(line.mnemonic));
+}
+
+// Each line is tagged with the encoder the assembler should use
+TEST_F(TestLexer, test_lex_handler)
+{
+    std::string text = 
+        "    .ORIG x3000\n"
+        "top ADD R1, R1, #1\n"
+        "    AND R2, R2, R3\n"
+        "    BRz top\n"
+        "    jsrr R3\n"
+        "    LEA R0, msg\n"
+        "    LD R4, top\n"
+        "    LDR R5, R4, #0\n"
+        "    STR R5, R4, #0\n"
+        "    NOT R1, R2\n"
+        "    TRAP x25\n"
+        "    puts\n"
+        "    .FILL #7\n"
+        "    .BLKW #2\n"
+        "msg .STRINGZ \"hi\"\n"
+        "    .END\n";
+    uint8_t exp_handlers[] = {
+        LINE_H_ORIG, LINE_H_ADD, LINE_H_AND, LINE_H_BR, LINE_H_JSR, LINE_H_LEA,
+        LINE_H_LD, LINE_H_LDR, LINE_H_STR, LINE_H_INVALID, LINE_H_TRAP, LINE_H_TRAP,
+        LINE_H_FILL, LINE_H_BLKW, LINE_H_STRINGZ, LINE_H_NONE
+    };
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    SourceInfo lsource = lexer.lex();
+
+    ASSERT_EQ(false, lsource.hasError());
+    ASSERT_EQ(sizeof(exp_handlers), lsource.getNumLines());
+    for(unsigned int idx = 0; idx < lsource.getNumLines(); ++idx)
+    {
+        ASSERT_EQ(exp_handlers[idx], lsource.get(idx).handler) << "line " << idx + 1;
+    }
+
+    // Lines that fail to lex have nothing to encode
+    Lexer err_lexer(this->op_table);
+    err_lexer.loadBuffer("    .ORIG x3000\n    FOO R1\n    .BOGUS #1\n");
+    err_lexer.setContOnError(true);
+    const SourceInfo& err_source = err_lexer.lex();
+    ASSERT_EQ(true, err_source.hasError());
+    ASSERT_EQ(3, err_source.getNumLines());
+    ASSERT_EQ(LINE_H_NONE, err_source.get(1).handler);
+    ASSERT_EQ(LINE_H_NONE, err_source.get(2).handler);
+}
+
 // STRINGZ test 
 TEST_F(TestLexer, test_stringz)
 {
@@ -464,13 +949,355 @@ TEST_F(TestLexer, test_stringz)
         LineInfo lex_line = lsource.get(idx);
         LineInfo exp_line = expected_info.get(idx);
         std::cout << "Checking line " << idx+1 << "(source line " << std::dec << lex_line.line_num << ") ...";
-        std::cout << "<" << lex_line.opcode.mnemonic << ">";
-        printLineDiff(lex_line, exp_line);
-        ASSERT_EQ(true, compLineInfo(lex_line, exp_line));
+        std::cout << "<" << lsource.getStr(lex_line.mnemonic) << ">";
+        printLineDiff(lsource, lex_line, expected_info, exp_line);
+        ASSERT_EQ(true, compLineInfo(lsource, lex_line, expected_info, exp_line));
         std::cout << " done" << std::endl;
     }
 }
 
+// Source with num_lines instructions, with a label on every
+// label_every'th one (or none if label_every is 0)
+static std::string test_make_source(const unsigned int num_lines, const unsigned int label_every)
+{
+    std::ostringstream oss;
+
+    oss << "    .ORIG x3000" << std::endl;
+    for(unsigned int n = 0; n < num_lines; ++n)
+    {
+        if(label_every > 0 && n % label_every == 0)
+            oss << "L" << n << " ADD R1, R1, #1" << std::endl;
+        else if(label_every > 0 && n % label_every == 1)
+            oss << "    BRp L" << n - 1 << "    ; loop" << std::endl;
+        else
+            oss << "    AND R2, R3, R4" << std::endl;
+    }
+    oss << "    .END" << std::endl;
+
+    return oss.str();
+}
+
+TEST_F(TestLexer, test_lex_allocs)
+{
+    unsigned int num_lines[] = {1000, 100000};
+    uint64_t num_alloc[2];
+    uint64_t before;
+
+    // Without labels the number of allocations doesn't depend on
+    // the size of the source, since the line arrays are sized 
+    // before lexing
+    for(unsigned int t = 0; t < 2; ++t)
+    {
+        std::string text = test_make_source(num_lines[t], 0);
+        Lexer lexer(this->op_table);
+        lexer.loadBuffer(text);
+
+        before = test_num_alloc.load();
+        const SourceInfo& lsource = lexer.lex();
+        num_alloc[t] = test_num_alloc.load() - before;
+        ASSERT_EQ(false, lsource.hasError());
+        ASSERT_EQ(num_lines[t] + 2, lsource.getNumLines());
+    }
+    ASSERT_EQ(num_alloc[0], num_alloc[1]);
+
+    // Labels grow the symbol table, which still comes to well under
+    // one allocation per line
+    for(unsigned int t = 0; t < 2; ++t)
+    {
+        std::string text = test_make_source(num_lines[t], 4);
+        Lexer lexer(this->op_table);
+        lexer.loadBuffer(text);
+
+        before = test_num_alloc.load();
+        const SourceInfo& lsource = lexer.lex();
+        num_alloc[t] = test_num_alloc.load() - before;
+        ASSERT_EQ(false, lsource.hasError());
+        ASSERT_EQ(num_lines[t] + 2, lsource.getNumLines());
+        if(this->verbose)
+        {
+            std::cout << "Lexing " << std::dec << lsource.getNumLines() 
+                << " lines took " << num_alloc[t] << " allocations" << std::endl;
+        }
+        ASSERT_LE(num_alloc[t], lsource.getNumLines() / 10);
+
+        // Taking the output doesn't copy it. The lexer only gets
+        // a new (empty) string pool.
+        before = test_num_alloc.load();
+        SourceInfo taken = lexer.takeSrcInfo();
+        ASSERT_LE(test_num_alloc.load() - before, 4);
+        ASSERT_EQ(num_lines[t] + 2, taken.getNumLines());
+        ASSERT_EQ(0, lexer.getSourceInfo().getNumLines());
+
+        // With nothing left to reuse, an edit lexes everything again
+        LexEdit e = lexer.edit(0, 0, "; header\n");
+        ASSERT_EQ(true, e.relex_all);
+        ASSERT_EQ(taken.getNumLines(), lexer.getSourceInfo().getNumLines());
+    }
+}
+
+TEST_F(TestLexer, test_lex_cont_on_error)
+{
+    std::string text = 
+        "    .ORIG x3000\n"
+        "    ADD R1, R2, R3\n"
+        "    ADD R1, Q2, R3     ; bad register\n"
+        "LOOP AND R1, R1, #0\n"
+        "    LDR R1, Q8, #2\n"
+        "    BRp LOOP\n"
+        "  FOO BAR\n"
+        "    NOT R2, R3\n"
+        "    HALT\n"
+        "    .END\n";
+
+    // By default lexing stops at the first error
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    ASSERT_EQ(false, lexer.getContOnError());
+    const SourceInfo& first_source = lexer.lex();
+    ASSERT_EQ(true, first_source.hasError());
+    ASSERT_EQ(3, first_source.getNumLines());
+    ASSERT_EQ(1, lexer.getErrors().size());
+    ASSERT_EQ(3, lexer.getErrors()[0].line_num);
+
+    // Otherwise every error is found in one pass
+    Lexer rec_lexer(this->op_table);
+    rec_lexer.loadBuffer(text);
+    rec_lexer.setContOnError(true);
+    const SourceInfo& rec_source = rec_lexer.lex();
+    ASSERT_EQ(true, rec_source.hasError());
+    ASSERT_EQ(10, rec_source.getNumLines());
+    ASSERT_EQ(3, rec_source.getNumError());
+
+    const std::vector<LexError>& errors = rec_lexer.getErrors();
+    unsigned int exp_line_num[] = {3, 5, 7};
+    unsigned int exp_col[]      = {5, 5, 3};
+    uint8_t      exp_code[]     = {LINE_ERR_ARG, LINE_ERR_BASE_REG, LINE_ERR_NO_INSTR};
+    ASSERT_EQ(3, errors.size());
+    for(unsigned int n = 0; n < errors.size(); ++n)
+    {
+        const LineInfo& err_line = rec_source.at(errors[n].line_idx);
+        if(this->verbose)
+        {
+            std::cout << "line " << std::dec << errors[n].line_num << ":" << errors[n].col 
+                << " " << rec_source.getErrStr(err_line) << std::endl;
+        }
+        ASSERT_EQ(exp_line_num[n], errors[n].line_num);
+        ASSERT_EQ(exp_col[n], errors[n].col);
+        ASSERT_EQ(exp_code[n], errors[n].err_code);
+        ASSERT_EQ(true, err_line.error);
+        ASSERT_EQ(exp_line_num[n], err_line.line_num);
+    }
+    ASSERT_EQ("Failed to parse LDR argument <Q8> (base register)", 
+            rec_source.getErrStr(rec_source.at(errors[1].line_idx)));
+
+    // Lines after an error are lexed as normal, and labels still resolve
+    LineInfo br_line = rec_source.get(5);
+    ASSERT_EQ(6, br_line.line_num);
+    ASSERT_EQ(0x3004, br_line.addr);
+    ASSERT_EQ(0x3002, br_line.imm);
+    LineInfo not_line = rec_source.get(7);
+    ASSERT_EQ(8, not_line.line_num);
+    ASSERT_EQ(0x3006, not_line.addr);
+    ASSERT_EQ(false, not_line.error);
+
+    // Lexing in chunks finds the same errors
+    for(size_t chunk_size : {16, 40, 100})
+    {
+        Lexer par_lexer(this->op_table);
+        par_lexer.loadBuffer(text);
+        par_lexer.setContOnError(true);
+        const SourceInfo& par_source = par_lexer.lexParallel(4, chunk_size);
+        test_comp_source(rec_source, rec_lexer.getSymTable(), par_source, par_lexer.getSymTable());
+        ASSERT_EQ(errors.size(), par_lexer.getErrors().size());
+        for(unsigned int n = 0; n < errors.size(); ++n)
+        {
+            ASSERT_EQ(errors[n].line_idx, par_lexer.getErrors()[n].line_idx);
+            ASSERT_EQ(errors[n].line_num, par_lexer.getErrors()[n].line_num);
+            ASSERT_EQ(errors[n].col, par_lexer.getErrors()[n].col);
+            ASSERT_EQ(errors[n].err_code, par_lexer.getErrors()[n].err_code);
+        }
+    }
+}
+
+TEST_F(TestLexer, test_lex_literals)
+{
+    std::string text = 
+        "    .ORIG x3000\n"
+        "    ADD R1, R1, #-16\n"
+        "    AND R2, R2, x0F\n"
+        "    ADD R3, R3, b101\n"
+        "    LDR R4, R5, #-32\n"
+        "    BRz x3000\n"
+        "    LEA R0, #12290\n"
+        "    ADD R1, R1, #16\n"
+        "    STR R4, R5, x20\n"
+        "    ADD R1, R1, #1Z\n"
+        "    .FILL x10000\n"
+        "    .FILL #-1\n"
+        "    .END\n";
+    Lexer lexer(this->op_table);
+    lexer.loadBuffer(text);
+    lexer.setContOnError(true);
+    const SourceInfo& lsource = lexer.lex();
+    ASSERT_EQ(13, lsource.getNumLines());
+
+    // Literals in any base
+    uint16_t exp_imm[] = {0xFFF0, 0x000F, 0x0005, 0xFFE0, 0x3000, 0x3002};
+    for(unsigned int n = 0; n < 6; ++n)
+    {
+        const LineInfo& line = lsource.at(n + 1);
+        ASSERT_EQ(false, line.error) << "line " << line.line_num;
+        ASSERT_EQ(exp_imm[n], line.imm) << "line " << line.line_num;
+    }
+    ASSERT_EQ(true, lsource.at(2).is_imm);
+    ASSERT_EQ(STR_ID_EMPTY, lsource.at(5).symbol);
+    ASSERT_EQ(0xFFFF, lsource.at(11).imm);
+
+    // Literals that don't fit say which field they were for
+    const std::vector<LexError>& errors = lexer.getErrors();
+    ASSERT_EQ(4, errors.size());
+    ASSERT_EQ(8, errors[0].line_num);
+    ASSERT_EQ(LINE_ERR_RANGE, errors[0].err_code);
+    ASSERT_EQ("Literal <#16> does not fit in a 5 bit field", 
+            lsource.getErrStr(lsource.at(errors[0].line_idx)));
+    ASSERT_EQ(9, errors[1].line_num);
+    ASSERT_EQ("Literal <x20> does not fit in a 6 bit field", 
+            lsource.getErrStr(lsource.at(errors[1].line_idx)));
+    ASSERT_EQ(10, errors[2].line_num);
+    ASSERT_EQ("Invalid literal <#1Z>", 
+            lsource.getErrStr(lsource.at(errors[2].line_idx)));
+    ASSERT_EQ(11, errors[3].line_num);
+    ASSERT_EQ("Literal <x10000> does not fit in a 16 bit field", 
+            lsource.getErrStr(lsource.at(errors[3].line_idx)));
+}
+
+/*
+ * test_comp_cores()
+ * Lex text with both scanning cores and check they agree
+ */
+static void test_comp_cores(const OpcodeTable& op_table, const std::string& text)
+{
+    Lexer scan_lexer(op_table);
+    Lexer dfa_lexer(op_table);
+
+    scan_lexer.loadBuffer(text);
+    scan_lexer.setContOnError(true);
+    dfa_lexer.loadBuffer(text);
+    dfa_lexer.setContOnError(true);
+    dfa_lexer.setCore(LEX_CORE_DFA);
+    const SourceInfo& scan_source = scan_lexer.lex();
+    const SourceInfo& dfa_source  = dfa_lexer.lex();
+    test_comp_source(scan_source, scan_lexer.getSymTable(), dfa_source, dfa_lexer.getSymTable());
+
+    const std::vector<LexError>& scan_errors = scan_lexer.getErrors();
+    const std::vector<LexError>& dfa_errors  = dfa_lexer.getErrors();
+    ASSERT_EQ(scan_errors.size(), dfa_errors.size());
+    for(unsigned int n = 0; n < scan_errors.size(); ++n)
+    {
+        ASSERT_EQ(scan_errors[n].line_idx, dfa_errors[n].line_idx);
+        ASSERT_EQ(scan_errors[n].line_num, dfa_errors[n].line_num);
+        ASSERT_EQ(scan_errors[n].col, dfa_errors[n].col);
+        ASSERT_EQ(scan_errors[n].err_code, dfa_errors[n].err_code);
+    }
+}
+
+TEST_F(TestLexer, test_lex_dfa_core)
+{
+    std::vector<std::string> src_files = {
+        "data/add_test.asm", "data/sentinel.asm", "data/pow10.asm",
+        "data/char_count.asm", "data/crypto.asm"
+    };
+    std::string all_text;
+    for(const std::string& src_filename : src_files)
+    {
+        std::ifstream infile(src_filename);
+        std::string text((std::istreambuf_iterator<char>(infile)),
+                std::istreambuf_iterator<char>());
+        test_comp_cores(this->op_table, text);
+        all_text += text;
+    }
+
+    Lexer scan_lexer(this->op_table);
+    ASSERT_EQ(LEX_CORE_SCAN, scan_lexer.getCore());
+    scan_lexer.loadBuffer(all_text);
+    scan_lexer.setContOnError(true);
+    const SourceInfo& scan_source = scan_lexer.lex();
+    // Chunks inherit the core
+    Lexer par_lexer(this->op_table);
+    par_lexer.loadBuffer(all_text);
+    par_lexer.setContOnError(true);
+    par_lexer.setCore(LEX_CORE_DFA);
+    const SourceInfo& par_source = par_lexer.lexParallel(4, 256);
+    test_comp_source(scan_source, scan_lexer.getSymTable(), par_source, par_lexer.getSymTable());
+
+    // Random sources, including the things that are easy to get 
+    // wrong: errors, strings, separators, comments and nulls
+    const char* pieces[] = {
+        "    ", "\t", "\n", "\n", "\n", "\r\n", ",", ", ", ":", "; comment", ";",
+        "ADD", "AND", "NOT", "LDR", "STR", "BRnzp", "JSR", "RET", "HALT", "PUTS",
+        "R1", "R2", "R7", "#1", "#-3", "x3000", "xF", "LOOP", "LOOP:", "DATA",
+        ".ORIG", ".FILL", ".BLKW", ".STRINGZ", ".END", "\"str\"", "\"a, b; c\"", "\"",
+        "    .ORIG x3000\n", "    ADD R1, R2, R3\n", "LOOP ADD R1, R1, #-1\n",
+        "    BRp LOOP\n", "    .STRINGZ \"Hello\"\n", std::string("\0", 1).c_str(),
+    };
+    const unsigned int num_pieces = sizeof(pieces) / sizeof(pieces[0]);
+    std::mt19937 gen(43);
+    std::uniform_int_distribution<unsigned int> piece_dist(0, num_pieces - 1);
+
+    // Errors are printed as they are found, there are a lot of them
+    std::ostringstream null_out;
+    std::streambuf* cout_buf = std::cout.rdbuf(null_out.rdbuf());
+    std::streambuf* cerr_buf = std::cerr.rdbuf(null_out.rdbuf());
+    for(unsigned int n = 0; n < 400; ++n)
+    {
+        std::string text = "    .ORIG x3000\n";
+        unsigned int num_tokens = 1 + gen() % 60;
+        for(unsigned int t = 0; t < num_tokens; ++t)
+        {
+            unsigned int p = piece_dist(gen);
+            // An empty c_str() stands for a null
+            if(pieces[p][0] == '\0')
+                text += '\0';
+            else
+                text += pieces[p];
+            if(gen() % 2)
+                text += ' ';
+        }
+        test_comp_cores(this->op_table, text);
+        if(this->HasFatalFailure())
+        {
+            std::cout.rdbuf(cout_buf);
+            std::cerr.rdbuf(cerr_buf);
+            std::cout << "Cores differ on source :" << std::endl << text << std::endl;
+            return;
+        }
+    }
+    std::cout.rdbuf(cout_buf);
+    std::cerr.rdbuf(cerr_buf);
+
+    // Edits lex the same way
+    Lexer edit_lexer(this->op_table);
+    edit_lexer.loadBuffer(all_text);
+    edit_lexer.setCore(LEX_CORE_DFA);
+    edit_lexer.lex();
+    std::string edit_text = all_text;
+    std::string insert = "\nMORE ADD R1, R1, #1 ; more\n";
+    for(unsigned int n = 0; n < 20; ++n)
+    {
+        unsigned int pos = edit_text.find('\n', (n * 997) % edit_text.size());
+        if(pos == std::string::npos)
+            pos = edit_text.size();
+        edit_lexer.edit(pos, 0, insert);
+        edit_text.insert(pos, insert);
+
+        Lexer fresh_lexer(this->op_table);
+        fresh_lexer.loadBuffer(edit_text);
+        const SourceInfo& fresh_source = fresh_lexer.lex();
+        test_comp_source(fresh_source, fresh_lexer.getSymTable(), 
+                edit_lexer.getSourceInfo(), edit_lexer.getSymTable());
+    }
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
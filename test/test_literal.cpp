@@ -0,0 +1,129 @@
+/* TEST_LITERAL
+ * Test parsing of numeric literals
+ *
+ * Stefan Wong 2018
+ */
+
+#include <string>
+#include <gtest/gtest.h>
+// Modules under test
+#include "literal.hpp"
+
+class TestLiteral : public ::testing::Test
+{
+    protected:
+        TestLiteral() {}
+        virtual ~TestLiteral() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// Literals can be parsed at compile time
+static_assert(lex_parse_literal("x3000").value == 0x3000, "x3000 should be 0x3000");
+static_assert(lex_parse_literal("#-16").value == -16, "#-16 should be -16");
+static_assert(lex_lit_fits(-16, LEX_LIT_IMM5) && !lex_lit_fits(16, LEX_LIT_IMM5), "imm5 is -16 to 15");
+
+TEST_F(TestLiteral, test_parse)
+{
+    typedef struct
+    {
+        const char* text;
+        int32_t     value;
+    } LitCase;
+    LitCase cases[] = {
+        {"#0",      0},
+        {"#15",     15},
+        {"#-16",    -16},
+        {"42",      42},
+        {"-7",      -7},
+        {"x3000",   0x3000},
+        {"XFFFF",   0xFFFF},
+        {"xabCD",   0xABCD},
+        {"x-10",    -16},
+        {"b0101",   5},
+        {"B1111111111111111", 0xFFFF},
+        {"b-1",     -1},
+        {"#65535",  65535},
+        {"#-32768", -32768},
+        {"#000000000000000000000012", 12},
+    };
+
+    for(const LitCase& c : cases)
+    {
+        LexLiteral lit = lex_parse_literal(c.text);
+        if(this->verbose)
+            std::cout << c.text << " -> " << lit.value << std::endl;
+        ASSERT_EQ(LEX_LIT_OK, lit.status) << c.text;
+        ASSERT_EQ(c.value, lit.value) << c.text;
+    }
+}
+
+TEST_F(TestLiteral, test_parse_error)
+{
+    // No digits
+    ASSERT_EQ(LEX_LIT_EMPTY, lex_parse_literal("").status);
+    ASSERT_EQ(LEX_LIT_EMPTY, lex_parse_literal("#").status);
+    ASSERT_EQ(LEX_LIT_EMPTY, lex_parse_literal("x").status);
+    ASSERT_EQ(LEX_LIT_EMPTY, lex_parse_literal("#-").status);
+    // Digits that don't belong to the base
+    ASSERT_EQ(LEX_LIT_DIGIT, lex_parse_literal("#1A").status);
+    ASSERT_EQ(LEX_LIT_DIGIT, lex_parse_literal("xFG").status);
+    ASSERT_EQ(LEX_LIT_DIGIT, lex_parse_literal("b012").status);
+    ASSERT_EQ(LEX_LIT_DIGIT, lex_parse_literal("#1-2").status);
+    // Too big for 16 bits, however many digits there are
+    ASSERT_EQ(LEX_LIT_OVERFLOW, lex_parse_literal("#65536").status);
+    ASSERT_EQ(LEX_LIT_OVERFLOW, lex_parse_literal("#-32769").status);
+    ASSERT_EQ(LEX_LIT_OVERFLOW, lex_parse_literal("x10000").status);
+    ASSERT_EQ(LEX_LIT_OVERFLOW, lex_parse_literal("#99999999999999999999999").status);
+    ASSERT_EQ(LEX_LIT_OVERFLOW, lex_parse_literal("xFFFFFFFFFFFFFFFFFFFF").status);
+}
+
+TEST_F(TestLiteral, test_is_literal)
+{
+    ASSERT_TRUE(lex_is_literal("#12"));
+    ASSERT_TRUE(lex_is_literal("#zz"));     // a literal, just not a valid one
+    ASSERT_TRUE(lex_is_literal("12"));
+    ASSERT_TRUE(lex_is_literal("-1"));
+    ASSERT_TRUE(lex_is_literal("x3000"));
+    ASSERT_TRUE(lex_is_literal("b101"));
+    // Hex or binary prefixes followed by anything else are labels
+    ASSERT_FALSE(lex_is_literal("xray"));
+    ASSERT_FALSE(lex_is_literal("b102"));
+    ASSERT_FALSE(lex_is_literal("bad"));
+    ASSERT_FALSE(lex_is_literal("x"));
+    ASSERT_FALSE(lex_is_literal("LOOP"));
+    ASSERT_FALSE(lex_is_literal(""));
+}
+
+TEST_F(TestLiteral, test_fits)
+{
+    typedef struct
+    {
+        unsigned int bits;
+        int32_t      min;
+        int32_t      max;
+    } FieldCase;
+    FieldCase fields[] = {
+        {LEX_LIT_IMM5,  -16,     15},
+        {LEX_LIT_OF6,   -32,     31},
+        {LEX_LIT_PC9,   -256,    255},
+        {LEX_LIT_PC11,  -1024,   1023},
+        {LEX_LIT_WORD,  -32768,  65535},
+    };
+
+    for(const FieldCase& f : fields)
+    {
+        ASSERT_TRUE(lex_lit_fits(f.min, f.bits)) << f.bits;
+        ASSERT_TRUE(lex_lit_fits(f.max, f.bits)) << f.bits;
+        ASSERT_TRUE(lex_lit_fits(0, f.bits)) << f.bits;
+        ASSERT_FALSE(lex_lit_fits(f.min - 1, f.bits)) << f.bits;
+        ASSERT_FALSE(lex_lit_fits(f.max + 1, f.bits)) << f.bits;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+/* TEST_LOG
+ * Test the asynchronous logger
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+// Modules under test
+#include "log.hpp"
+
+class TestLog : public ::testing::Test
+{
+    protected:
+        TestLog() {}
+        virtual ~TestLog() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// Count lines in some output
+static unsigned int test_count_lines(const std::string& s, const std::string& match)
+{
+    unsigned int count = 0;
+    std::istringstream iss(s);
+    std::string line;
+
+    while(std::getline(iss, line))
+    {
+        if(line.find(match) != std::string::npos)
+            count++;
+    }
+
+    return count;
+}
+
+TEST_F(TestLog, test_format)
+{
+    static const LogFormat fmt = {LOG_LEVEL_DEBUG, "test_func",
+        "(line %u) found <%s> at 0x%04x, offset %d, char %c%%"};
+    LogRecord r;
+
+    r.format   = &fmt;
+    r.num_args = 0;
+    r.str_len  = 0;
+    log_pack(r, 12, std::string("LABEL"), 0x30, -5, 'q');
+    ASSERT_EQ(5, r.num_args);
+    ASSERT_EQ(LOG_ARG_STR, r.arg_type[1]);
+    ASSERT_EQ("[test_func] (line 12) found <LABEL> at 0x0030, offset -5, char q%\n",
+            log_format(r));
+
+    // Too few arguments for the format
+    r.num_args = 1;
+    ASSERT_EQ("[test_func] (line 12) found <<?>> at 0x<?>, offset <?>, char <?>%\n",
+            log_format(r));
+
+    // Long strings are truncated to fit the record
+    std::string long_str(2 * LOG_STR_SIZE, 'a');
+    r.num_args = 0;
+    r.str_len  = 0;
+    log_pack(r, long_str.c_str());
+    ASSERT_EQ(1, r.num_args);
+    ASSERT_EQ(LOG_STR_SIZE - 1, std::string(&r.str[0]).length());
+
+    // Strings after the space is full are empty
+    static const LogFormat str_fmt = {LOG_LEVEL_DEBUG, "test_func", "<%s> <%s> <%s> %d"};
+    r.format   = &str_fmt;
+    r.num_args = 0;
+    r.str_len  = 0;
+    log_pack(r, long_str, std::string(LOG_STR_SIZE + 6, 'b'), "lit", 7);
+    ASSERT_EQ(4, r.num_args);
+    ASSERT_EQ(LOG_STR_SIZE, r.str_len);
+    ASSERT_EQ("[test_func] <" + std::string(LOG_STR_SIZE - 1, 'a') + "> <> <> 7\n",
+            log_format(r));
+
+    // String literals after other strings
+    r.num_args = 0;
+    r.str_len  = 0;
+    log_pack(r, std::string("s"), "lit", (const char*) "ptr", 1);
+    ASSERT_EQ("[test_func] <s> <lit> <ptr> 1\n", log_format(r));
+}
+
+TEST_F(TestLog, test_log_threads)
+{
+    std::ostringstream oss;
+    const unsigned int num_threads = 4;
+    const unsigned int num_records = 256;
+    std::vector<std::thread> threads;
+
+    logSetOutput(&oss);
+    uint64_t dropped = logNumDropped();
+    for(unsigned int t = 0; t < num_threads; ++t)
+    {
+        threads.push_back(std::thread([t]() {
+            for(unsigned int n = 0; n < num_records; ++n)
+                LOG_INFO("thread %u record %u", t, n);
+        }));
+    }
+    for(auto& th : threads)
+        th.join();
+    logFlush();
+    logSetOutput(nullptr);
+
+    ASSERT_EQ(dropped, logNumDropped());
+    ASSERT_EQ(num_threads * num_records, test_count_lines(oss.str(), "record"));
+    // Each thread's records come out in the order they were logged
+    for(unsigned int t = 0; t < num_threads; ++t)
+    {
+        std::string first = "thread " + std::to_string(t) + " record 0\n";
+        std::string last  = "thread " + std::to_string(t) + " record " +
+            std::to_string(num_records-1) + "\n";
+        ASSERT_NE(std::string::npos, oss.str().find(first));
+        ASSERT_LT(oss.str().find(first), oss.str().find(last));
+    }
+    if(this->verbose)
+        std::cout << oss.str();
+}
+
+TEST_F(TestLog, test_log_drop)
+{
+    std::ostringstream oss;
+    uint64_t dropped = logNumDropped();
+
+    // Fill a ring faster than the writer can possibly keep up with
+    // by logging from a thread with a fresh ring in a tight loop
+    logSetOutput(&oss);
+    std::thread th([]() {
+        for(unsigned int n = 0; n < 16 * LOG_RING_SIZE; ++n)
+            LOG_DEBUG("record %u", n);
+    });
+    th.join();
+    logFlush();
+    logSetOutput(nullptr);
+
+    uint64_t num_written = test_count_lines(oss.str(), "record");
+    ASSERT_EQ(16 * LOG_RING_SIZE, num_written + (logNumDropped() - dropped));
+}
+
+// The rings of threads that have exited are freed
+TEST_F(TestLog, test_log_ring_free)
+{
+    std::ostringstream oss;
+
+    logSetOutput(&oss);
+    logFlush();
+    unsigned int num_rings = logNumRings();
+    for(unsigned int t = 0; t < 8; ++t)
+    {
+        std::thread th([t]() {
+            LOG_INFO("thread %u", t);
+        });
+        th.join();
+    }
+    logFlush();
+    logSetOutput(nullptr);
+
+    ASSERT_EQ(num_rings, logNumRings());
+    ASSERT_EQ(8, test_count_lines(oss.str(), "thread"));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
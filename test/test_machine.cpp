@@ -29,6 +29,37 @@ class TestMachine : public ::testing::Test
 //    ASSERT_EQ(this->mem_size, m.getMemSize());
 //}
 
+TEST_F(TestMachine, test_addr_bitmap)
+{
+    AddrBitmap bitmap;
+
+    ASSERT_EQ(0, bitmap.numSet());
+    for(unsigned int a = 0; a < ADDR_BITMAP_BITS; ++a)
+        ASSERT_EQ(false, bitmap.test(a));
+
+    bitmap.set(0x0000);
+    bitmap.set(0x3000);
+    bitmap.set(0x303F);
+    bitmap.set(0xFFFF);
+    bitmap.set(0x3000);     // setting twice doesn't count twice
+    ASSERT_EQ(4, bitmap.numSet());
+    ASSERT_EQ(true, bitmap.test(0x0000));
+    ASSERT_EQ(true, bitmap.test(0x3000));
+    ASSERT_EQ(false, bitmap.test(0x3001));
+    ASSERT_EQ(true, bitmap.test(0x303F));
+    ASSERT_EQ(false, bitmap.test(0x3040));
+    ASSERT_EQ(true, bitmap.test(0xFFFF));
+
+    bitmap.clear(0x3000);
+    bitmap.clear(0x3001);   // wasn't set
+    ASSERT_EQ(3, bitmap.numSet());
+    ASSERT_EQ(false, bitmap.test(0x3000));
+
+    bitmap.clearAll();
+    ASSERT_EQ(0, bitmap.numSet());
+    ASSERT_EQ(false, bitmap.test(0xFFFF));
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -8,6 +8,12 @@
 #include <gtest/gtest.h>
 // Modules under test 
 #include "opcode.hpp"
+#include "lc3.hpp"
+
+// The shared tables are built at compile time
+static_assert(lc3_op_table.getNumOps() == sizeof(lc3_op_list) / sizeof(lc3_op_list[0]), "every op should be in the table");
+static_assert(lc3_op_table.getMnemonic(LC3_LEA) == "LEA", "LEA should be found by opcode");
+static_assert(lc3_psuedo_op_table.getMnemonic(LC3_HALT) == "HALT", "HALT should be found by opcode");
 
 /*
  *  TEST_OPCODE 
@@ -50,19 +56,80 @@ TEST_F(TestOpcode, test_init)
 
     Opcode out_op;
     op_table.get(test_op.mnemonic, out_op);
-    ASSERT_STREQ(test_op.mnemonic.c_str(), out_op.mnemonic.c_str());
+    ASSERT_EQ(test_op.mnemonic, out_op.mnemonic);
 
     // Test that we can get search opcodes by string
     Opcode search_op;           // results placed in here 
     op_table.get("AND", search_op);
     ASSERT_EQ(0x05, search_op.opcode);
-    ASSERT_STREQ("AND", search_op.mnemonic.c_str());
+    ASSERT_EQ("AND", search_op.mnemonic);
     op_table.get("NOT", search_op);
     ASSERT_EQ(0x09, search_op.opcode);
-    ASSERT_STREQ("NOT", search_op.mnemonic.c_str());
+    ASSERT_EQ("NOT", search_op.mnemonic);
 }
 
 
+TEST_F(TestOpcode, test_lookup)
+{
+    // Every opcode field has a mnemonic, apart from the reserved one,
+    // and it is the first entry for that opcode
+    for(uint16_t op = 0; op < OPCODE_NUM_FIELDS; ++op)
+    {
+        int idx = lc3_op_table.find(op);
+        if(op == LC3_RES || op == LC3_LDI)
+        {
+            ASSERT_EQ(OPCODE_NOT_FOUND, idx);
+            ASSERT_EQ(OPCODE_INVALID_MNEMONIC, lc3_op_table.getMnemonic(op));
+            continue;
+        }
+        ASSERT_NE(OPCODE_NOT_FOUND, idx) << "opcode " << op;
+        ASSERT_EQ(op, lc3_op_table.getIdx(idx).opcode);
+        for(int prev = 0; prev < idx; ++prev)
+        {
+            ASSERT_NE(op, lc3_op_table.getIdx(prev).opcode);
+        }
+        ASSERT_EQ(lc3_op_table.getIdx(idx).mnemonic, lc3_op_table.getMnemonic(op));
+    }
+    ASSERT_EQ("BR", lc3_op_table.getMnemonic(LC3_BR));
+    ASSERT_EQ("JMP", lc3_op_table.getMnemonic(LC3_JMP_RET));
+
+    // By mnemonic
+    for(const Opcode& op : lc3_op_list)
+    {
+        int idx = lc3_op_table.find(op.mnemonic);
+        ASSERT_NE(OPCODE_NOT_FOUND, idx) << op.mnemonic;
+        ASSERT_EQ(op.mnemonic, lc3_op_table.getIdx(idx).mnemonic);
+        ASSERT_EQ(op.opcode, lc3_op_table.getIdx(idx).opcode);
+    }
+    ASSERT_EQ(OPCODE_NOT_FOUND, lc3_op_table.find("HALT"));
+    ASSERT_EQ(OPCODE_NOT_FOUND, lc3_psuedo_op_table.find((uint16_t) 0x30));
+    Opcode o;
+    lc3_op_table.get("LOOP", o);
+    ASSERT_EQ(OPCODE_INVALID_MNEMONIC, o.mnemonic);
+
+    // Past the end of the table
+    o = lc3_op_table.getIdx(lc3_op_table.getNumOps());
+    ASSERT_EQ(0, o.opcode);
+    ASSERT_EQ(OPCODE_INVALID_MNEMONIC, o.mnemonic);
+    ASSERT_EQ(OPCODE_INVALID_MNEMONIC, lc3_op_table.getIdx(OPCODE_TABLE_MAX + 1).mnemonic);
+}
+
+TEST_F(TestOpcode, test_full)
+{
+    OpcodeTable op_table;
+    Opcode op = {0x0010, "OP"};
+
+    for(unsigned int n = 0; n < OPCODE_TABLE_MAX; ++n)
+    {
+        ASSERT_EQ(0, op_table.add(op));
+    }
+    ASSERT_EQ(-1, op_table.add(op));
+    ASSERT_EQ((unsigned int) OPCODE_TABLE_MAX, op_table.getNumOps());
+    op_table.init();
+    ASSERT_EQ(0u, op_table.getNumOps());
+    ASSERT_EQ(OPCODE_NOT_FOUND, op_table.find((uint16_t) 0x0010));
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
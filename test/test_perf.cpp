@@ -0,0 +1,75 @@
+/* TEST_PERF
+ * Test the host hardware counter wrapper
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <gtest/gtest.h>
+// Modules under test
+#include "perf.hpp"
+
+class TestPerf : public ::testing::Test
+{
+    protected:
+        TestPerf() {}
+        virtual ~TestPerf() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+TEST_F(TestPerf, test_sample)
+{
+    PerfSample a;
+    PerfSample b;
+
+    ASSERT_EQ(false, a.anyValid());
+    ASSERT_EQ(0.0, a.perInstr(PERF_CYCLES, 100));
+
+    b.count[PERF_CYCLES] = 400;
+    b.valid[PERF_CYCLES] = true;
+    a.accumulate(b);
+    a.accumulate(b);
+    ASSERT_EQ(true, a.anyValid());
+    ASSERT_EQ(800, a.count[PERF_CYCLES]);
+    ASSERT_EQ(false, a.valid[PERF_INSTRUCTIONS]);
+    ASSERT_DOUBLE_EQ(8.0, a.perInstr(PERF_CYCLES, 100));
+    // Nothing to normalize against
+    ASSERT_EQ(0.0, a.perInstr(PERF_CYCLES, 0));
+    std::cout << a.toString(100);
+}
+
+TEST_F(TestPerf, test_counters)
+{
+    PerfCounters counters;
+
+    if(!counters.isAvailable())
+    {
+        std::cout << "Host counters not available, checking that samples are invalid" << std::endl;
+        counters.start();
+        counters.stop();
+        ASSERT_EQ(false, counters.read().anyValid());
+        return;
+    }
+
+    volatile uint64_t sum = 0;
+    counters.start();
+    for(unsigned int i = 0; i < 100000; ++i)
+        sum = sum + i;
+    counters.stop();
+
+    PerfSample sample = counters.read();
+    ASSERT_EQ(true, sample.anyValid());
+    if(sample.valid[PERF_INSTRUCTIONS])
+    {
+        ASSERT_GT(sample.count[PERF_INSTRUCTIONS], 100000);
+    }
+    std::cout << sample.toString(100000);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,103 @@
+/* TEST_SCAN
+ * Test the bulk source scanning functions
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+// Modules under test
+#include "scan.hpp"
+
+class TestScan : public ::testing::Test
+{
+    protected:
+        TestScan() {}
+        virtual ~TestScan() {}
+        virtual void SetUp() {}
+        virtual void TearDown() {}
+        bool verbose = false;       // set to true for additional output
+};
+
+// Random text made mostly of the characters the scans care about
+static std::string test_make_text(const size_t len, const unsigned int seed)
+{
+    const char alphabet[] = "  \t\r\n\n,:;abcR1#x";
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, sizeof(alphabet) - 2);
+    std::string text;
+
+    for(size_t i = 0; i < len; ++i)
+        text += alphabet[dist(gen)];
+    // Runs of blanks longer than a vector
+    for(size_t i = 0; i + 80 < len; i += 200)
+        text.replace(i, 70, std::string(70, (i % 400) ? ' ' : '\n'));
+
+    return text;
+}
+
+TEST_F(TestScan, test_scan_blank)
+{
+    if(this->verbose)
+        std::cout << "\t Scan implementation : " << lex_scan_impl() << std::endl;
+
+    for(unsigned int seed = 0; seed < 8; ++seed)
+    {
+        std::string text = test_make_text(1000, seed);
+        for(size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            for(bool sep : {false, true})
+            {
+                unsigned int exp_lines = 0;
+                unsigned int lines = 0;
+                size_t exp = lex_scan_blank_scalar(text.data(), pos, text.size(), sep, exp_lines);
+                size_t out = lex_scan_blank(text.data(), pos, text.size(), sep, lines);
+                ASSERT_EQ(exp, out) << "seed " << seed << " pos " << pos;
+                ASSERT_EQ(exp_lines, lines) << "seed " << seed << " pos " << pos;
+            }
+        }
+    }
+}
+
+TEST_F(TestScan, test_scan_line_end)
+{
+    for(unsigned int seed = 0; seed < 8; ++seed)
+    {
+        std::string text = test_make_text(1000, seed);
+        // Some long lines and an embedded null
+        text.replace(100, 300, std::string(300, 'c'));
+        text[500] = '\0';
+        for(size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            size_t exp = lex_scan_line_end_scalar(text.data(), pos, text.size());
+            size_t out = lex_scan_line_end(text.data(), pos, text.size());
+            ASSERT_EQ(exp, out) << "seed " << seed << " pos " << pos;
+        }
+    }
+}
+
+TEST_F(TestScan, test_scan_short)
+{
+    unsigned int lines = 0;
+    std::string text = " \n\t\n, x";
+
+    ASSERT_EQ(4, lex_scan_blank(text.data(), 0, text.size(), false, lines));
+    ASSERT_EQ(2, lines);
+    lines = 0;
+    ASSERT_EQ(6, lex_scan_blank(text.data(), 0, text.size(), true, lines));
+    ASSERT_EQ(2, lines);
+    // Scanning stops at len
+    lines = 0;
+    ASSERT_EQ(3, lex_scan_blank(text.data(), 0, 3, false, lines));
+    ASSERT_EQ(1, lines);
+    ASSERT_EQ(1, lex_scan_line_end(text.data(), 0, text.size()));
+    ASSERT_EQ(7, lex_scan_line_end(text.data(), 4, text.size()));
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
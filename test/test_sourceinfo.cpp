@@ -4,6 +4,8 @@
  * Stefan Wong 2018
  */
 
+#include <cstddef>
+#include <cstring>
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -74,6 +76,351 @@ TEST_F(TestSourceInfo, test_init)
 }
 
 
+TEST_F(TestSourceInfo, test_source_buffer_edit)
+{
+    std::string text = "    .ORIG x3000\n    ADD R1, R1, #1\n    HALT\n";
+    SourceBuffer buf;
+
+    // Editing a buffer owned by the caller edits a copy
+    buf.assign(text.data(), text.size());
+    buf.replace(4, 0, "\n");
+    ASSERT_EQ("    .ORIG x3000\n    ADD R1, R1, #1\n    HALT\n", text);
+    std::string expected = text;
+    expected.replace(4, 0, "\n");
+    ASSERT_EQ(expected, buf.view());
+
+    // Edits anywhere, of any size, give the same text as editing a
+    // string, and a prefix is the start of that text
+    unsigned int seed = 7;
+    for(unsigned int n = 0; n < 500; ++n)
+    {
+        seed = seed * 1103515245 + 12345;
+        size_t pos = (seed >> 8) % (expected.size() + 1);
+        size_t len = (seed >> 4) % 8;
+        std::string ins((seed >> 12) % ((n % 50 == 0) ? 3 * SRC_MIN_GAP : 12), 'a' + n % 26);
+        buf.replace(pos, len, ins);
+        expected.replace(pos, std::min(len, expected.size() - pos), ins);
+        ASSERT_EQ(expected.size(), buf.length());
+        size_t p = (seed >> 16) % (expected.size() + 1);
+        ASSERT_EQ(expected.substr(0, p), buf.prefix(p));
+    }
+    ASSERT_EQ(expected, buf.view());
+}
+
+TEST_F(TestSourceInfo, test_symbol_table)
+{
+    SymbolTable sym_table;
+    std::vector<std::string> labels;
+    uint16_t addr;
+
+    // Label text must outlive the table
+    for(unsigned int n = 0; n < 20000; ++n)
+        labels.push_back("L" + std::to_string(n));
+    labels.push_back("Zero");
+    for(unsigned int n = 0; n < labels.size(); ++n)
+    {
+        Symbol s;
+        s.label = labels[n];
+        s.addr  = (labels[n] == "Zero") ? 0 : 0x3000 + n;
+        sym_table.add(s);
+    }
+    ASSERT_EQ(labels.size(), sym_table.getNumSyms());
+    ASSERT_EQ(labels.size(), sym_table.getNumIds());
+
+    for(unsigned int n = 0; n < 20000; ++n)
+    {
+        ASSERT_EQ(true, sym_table.find(labels[n], addr));
+        ASSERT_EQ(0x3000 + n, addr);
+        ASSERT_EQ((int) n, sym_table.getId(labels[n]));
+    }
+    // A label at address 0 is not the same as a missing label
+    ASSERT_EQ(true, sym_table.find("Zero", addr));
+    ASSERT_EQ(0, addr);
+    addr = 0xBEEF;
+    ASSERT_EQ(false, sym_table.find("Missing", addr));
+    ASSERT_EQ(0xBEEF, addr);
+    ASSERT_EQ(SYM_ID_NONE, sym_table.getId("Missing"));
+    ASSERT_EQ(0, sym_table.getAddr("Missing"));
+
+    // The first definition of a label wins
+    Symbol dup;
+    dup.label = labels[7];
+    dup.addr  = 0x4000;
+    sym_table.add(dup);
+    ASSERT_EQ(labels.size() + 1, sym_table.getNumSyms());
+    ASSERT_EQ(labels.size(), sym_table.getNumIds());
+    ASSERT_EQ(0x3007, sym_table.getAddr(labels[7]));
+
+    // Relabel a symbol
+    Symbol s = sym_table.get(1);
+    s.label = "Renamed";
+    sym_table.update(1, s);
+    ASSERT_EQ(SYM_ID_NONE, sym_table.getId(labels[1]));
+    ASSERT_EQ(1, sym_table.getId("Renamed"));
+
+    sym_table.init();
+    ASSERT_EQ(0, sym_table.getNumSyms());
+    ASSERT_EQ(false, sym_table.find(labels[0], addr));
+}
+
+TEST_F(TestSourceInfo, test_symbol_table_build)
+{
+    SymbolTable sym_table;
+    std::vector<std::string> labels;
+    std::vector<Symbol> syms;
+
+    for(unsigned int n = 0; n < 5000; ++n)
+        labels.push_back("label_" + std::to_string(n));
+    for(unsigned int n = 0; n < labels.size(); ++n)
+    {
+        Symbol s;
+        s.label = labels[n];
+        s.addr  = n;
+        syms.push_back(s);
+    }
+    sym_table.build(syms);
+    ASSERT_EQ(syms.size(), sym_table.getNumSyms());
+    for(unsigned int n = 0; n < labels.size(); ++n)
+    {
+        uint16_t addr;
+        ASSERT_EQ(true, sym_table.find(labels[n], addr));
+        ASSERT_EQ(n, addr);
+    }
+}
+
+TEST_F(TestSourceInfo, test_string_pool)
+{
+    StringPool pool;
+    std::string long_str(3 * STR_BLOCK_SIZE, 'x');
+
+    // Id 0 is always the empty string
+    ASSERT_EQ(1, pool.size());
+    ASSERT_EQ(STR_ID_EMPTY, pool.intern(""));
+    ASSERT_EQ("", pool.get(STR_ID_EMPTY));
+
+    StrId loop_id = pool.intern("LOOP");
+    StrId end_id  = pool.intern("END");
+    ASSERT_NE(loop_id, end_id);
+    ASSERT_EQ(loop_id, pool.intern(std::string("LOOP")));
+    ASSERT_EQ(3, pool.size());
+
+    // Views handed out stay valid as the pool grows
+    std::string_view loop = pool.get(loop_id);
+    for(int n = 0; n < 4096; ++n)
+        pool.intern("label_" + std::to_string(n));
+    ASSERT_EQ(loop.data(), pool.get(loop_id).data());
+    ASSERT_EQ("LOOP", pool.get(loop_id));
+    ASSERT_EQ("label_1234", pool.get(pool.intern("label_1234")));
+
+    StrId long_id = pool.intern(long_str);
+    ASSERT_EQ(long_str, pool.get(long_id));
+    // Unknown ids give back the empty string
+    ASSERT_EQ("", pool.get(pool.size() + 10));
+}
+
+TEST_F(TestSourceInfo, test_string_pool_source)
+{
+    std::string text = "LOOP ADD R1, R1, #1";
+    StringPool pool;
+
+    // Strings that are part of the source text are not copied
+    pool.setSource(text);
+    std::string_view loop(text.data(), 4);
+    StrId id = pool.intern(loop);
+    ASSERT_EQ(0, pool.numBytes());
+    ASSERT_EQ(text.data(), pool.get(id).data());
+    // Anything else is
+    pool.intern("BRnz");
+    ASSERT_EQ(4, pool.numBytes());
+}
+
+TEST_F(TestSourceInfo, test_line_info)
+{
+    SourceInfo si;
+    LineInfo line;
+
+    ASSERT_LE(sizeof(LineInfo), 48);
+    initLineInfo(line);
+    line.line_num = 12;
+    line.opcode   = LC3_ADD;
+    line.mnemonic = si.intern("ADD");
+    line.label    = si.intern("LOOP");
+    si.add(line);
+
+    // Copies of a SourceInfo share the strings
+    SourceInfo copy = si;
+    LineInfo c = copy.get(0);
+    ASSERT_EQ("ADD", copy.getStr(c.mnemonic));
+    ASSERT_EQ("LOOP", copy.getStr(c.label));
+    ASSERT_EQ(si.numStrings(), copy.numStrings());
+    ASSERT_EQ(true, compLineInfo(si, si.get(0), copy, c));
+    // but adding a string to one doesn't change the other
+    unsigned int num_strs = copy.numStrings();
+    StrId r9_id = si.intern("R9");
+    ASSERT_EQ(num_strs, copy.numStrings());
+    ASSERT_EQ("", copy.getStr(r9_id));
+    ASSERT_EQ("LOOP", si.getStr(line.label));
+    ASSERT_EQ(r9_id, copy.intern("R7"));
+    ASSERT_EQ("R9", si.getStr(r9_id));
+    ASSERT_EQ("R7", copy.getStr(r9_id));
+
+    // Error messages are built from the code when asked for
+    ASSERT_EQ("", si.getErrStr(line));
+    line.error    = true;
+    line.err_code = LINE_ERR_DST_REG;
+    line.err_arg  = si.intern("R9");
+    ASSERT_EQ("Failed to parse ADD argument <R9> (destination register)", si.getErrStr(line));
+    line.err_code = LINE_ERR_ARG;
+    line.err_num  = 2;
+    ASSERT_EQ("Argument 2 of opcode ADD invalid", si.getErrStr(line));
+    line.err_code = LINE_ERR_LABEL;
+    ASSERT_EQ("(line 12) Invalid label token", si.getErrStr(line));
+}
+
+TEST_F(TestSourceInfo, test_line_info_move)
+{
+    SourceInfo si;
+    LineInfo line;
+
+    initLineInfo(line);
+    line.mnemonic = si.intern("ADD");
+    for(unsigned int n = 0; n < 16; ++n)
+    {
+        line.line_num = n + 1;
+        si.add(line);
+    }
+
+    // Lines can be looked at in place
+    unsigned int n = 0;
+    for(const LineInfo& l : si)
+    {
+        ASSERT_EQ(&si.at(n), &l);
+        ASSERT_EQ(n + 1, l.line_num);
+        n++;
+    }
+    ASSERT_EQ(16, n);
+
+    // Moving takes the lines and strings without copying them
+    const LineInfo* lines = &si.at(0);
+    SourceInfo moved = std::move(si);
+    ASSERT_EQ(16, moved.getNumLines());
+    ASSERT_EQ(lines, &moved.at(0));
+    ASSERT_EQ("ADD", moved.getStr(moved.at(15).mnemonic));
+    ASSERT_EQ(0, si.getNumLines());
+    ASSERT_EQ(false, si.hasError());
+    ASSERT_EQ(1, si.numStrings());
+    ASSERT_EQ("", si.getStr(line.mnemonic));
+    // What's left can be used again without touching the moved lines
+    ASSERT_EQ(line.mnemonic, si.intern("AND"));
+    ASSERT_EQ("ADD", moved.getStr(line.mnemonic));
+}
+
+TEST_F(TestSourceInfo, test_write_read)
+{
+    const std::string out_filename = "data/test_source.lex";
+    std::vector<std::string> src_files = {
+        "data/pow10.asm", "data/sentinel.asm", "data/add_test.asm"
+    };
+
+    for(const std::string& src_filename : src_files)
+    {
+        SourceInfo  read_src;
+        SymbolTable read_syms;
+        {
+            Lexer lexer(this->op_table, src_filename);
+            const SourceInfo& lex_src = lexer.lex();
+            ASSERT_EQ(false, lex_src.hasError());
+            ASSERT_EQ(0, lex_src.write(out_filename, &lexer.getSymTable()));
+
+            ASSERT_EQ(0, read_src.read(out_filename, &read_syms, lexer.getSource()));
+            ASSERT_EQ(lex_src.getSource(), read_src.getSource());
+            ASSERT_EQ(lex_src.getNumLines(), read_src.getNumLines());
+            ASSERT_EQ(lex_src.numStrings(), read_src.numStrings());
+            for(unsigned int idx = 0; idx < lex_src.getNumLines(); ++idx)
+                ASSERT_EQ(true, compLineInfo(lex_src, lex_src.at(idx), read_src, read_src.at(idx)));
+            for(unsigned int id = 0; id < lex_src.numStrings(); ++id)
+                ASSERT_EQ(lex_src.getStr(id), read_src.getStr(id));
+            // Strings that were read are found again when the pool 
+            // is added to
+            unsigned int num_strs = read_src.numStrings();
+            for(unsigned int id = 0; id < num_strs; ++id)
+                ASSERT_EQ(id, read_src.intern(lex_src.getStr(id)));
+            ASSERT_EQ(num_strs, read_src.intern("not in any source"));
+            const SymbolTable& lex_syms = lexer.getSymTable();
+            ASSERT_EQ(lex_syms.getNumSyms(), read_syms.getNumSyms());
+            for(unsigned int idx = 0; idx < lex_syms.getNumSyms(); ++idx)
+            {
+                ASSERT_EQ(lex_syms.get(idx).label, read_syms.get(idx).label);
+                ASSERT_EQ(lex_syms.get(idx).addr, read_syms.get(idx).addr);
+            }
+        }
+        // Everything read is still there once the lexer (and the
+        // source it had) is gone
+        uint16_t addr;
+        for(unsigned int idx = 0; idx < read_syms.getNumSyms(); ++idx)
+        {
+            ASSERT_EQ(true, read_syms.find(read_syms.get(idx).label, addr));
+            if(this->verbose)
+                std::cout << read_syms.get(idx).label << " : " << std::hex << addr << std::endl;
+        }
+        for(const LineInfo& l : read_src)
+        {
+            if(this->verbose)
+                std::cout << read_src.getStr(l.mnemonic) << " " << read_src.getStr(l.symbol) << std::endl;
+            ASSERT_EQ(false, l.error);
+        }
+    }
+
+    // The file written last was from add_test.asm, so it doesn't 
+    // match any other source
+    Lexer other(this->op_table, "data/pow10.asm");
+    SourceInfo src;
+    ASSERT_EQ(-1, src.read(out_filename, nullptr, other.getSource()));
+    ASSERT_EQ(0, src.getNumLines());
+    ASSERT_EQ(0, src.read(out_filename));
+    ASSERT_LT(0, src.getNumLines());
+    ASSERT_EQ(nullptr, src.getSource());
+
+    // Files that aren't valid
+    std::string bytes;
+    {
+        std::ifstream infile(out_filename, std::ios::binary);
+        bytes.assign((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    }
+    std::vector<std::string> bad_files = {
+        bytes.substr(0, bytes.size() - 1),              // truncated
+        bytes.substr(0, sizeof(SourceFileHeader) - 1),  // not even a header
+        "LC3X" + bytes.substr(4),                       // wrong magic
+    };
+    SourceFileHeader hdr;
+    std::memcpy(&hdr, bytes.data(), sizeof(hdr));
+    hdr.version++;
+    bad_files.push_back(std::string((const char*) &hdr, sizeof(hdr)) + bytes.substr(sizeof(hdr)));
+    hdr.version--;
+    // Lines with a bool that isn't 0 or 1, or a code out of range
+    const size_t bad_fields[][2] = {
+        {offsetof(LineInfo, is_imm), 2}, {offsetof(LineInfo, error), 0xFF},
+        {offsetof(LineInfo, handler), LINE_H_MAX}, {offsetof(LineInfo, err_code), LINE_ERR_MAX}
+    };
+    ASSERT_LT(0, hdr.num_lines);
+    for(const auto& f : bad_fields)
+    {
+        std::string bad = bytes;
+        bad[hdr.lines_off + (hdr.num_lines - 1) * sizeof(LineInfo) + f[0]] = (char) f[1];
+        bad_files.push_back(bad);
+    }
+    for(const std::string& bad : bad_files)
+    {
+        std::ofstream outfile(out_filename, std::ios::binary | std::ios::trunc);
+        outfile << bad;
+        outfile.close();
+        SourceInfo bad_src;
+        ASSERT_EQ(-1, bad_src.read(out_filename));
+    }
+    SourceInfo none;
+    ASSERT_EQ(-1, none.read("data/no_such_file.lex"));
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
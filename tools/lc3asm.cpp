@@ -14,42 +14,36 @@
 #include "source.hpp"
 #include "lexer.hpp"
 #include "assembler.hpp"
+#include "log.hpp"
 
 // TODO : help output
 
-
-// TODO : the 'true' op table should come from an LC3 machine object 
-OpcodeTable test_build_op_table(void)
-{
-    OpcodeTable op_table;
-
-    // iterate over this in the C++ way
-    for(const Opcode &op : lc3_op_list)
-        op_table.add(op);
-
-    return op_table;
-}
-
 typedef struct 
 {
     std::string in_filename;
     std::string out_filename;
+    std::string cache_filename;
     int errors;
     bool verbose;
+    bool cont_on_error;
+    unsigned int num_threads;
 } AsmArgs;
 
 void init_cmd_args(AsmArgs& args)
 {
     args.in_filename = "\0";
     args.out_filename = "out.asm";
+    args.cache_filename = "";
     args.errors = 0;
     args.verbose = false;
+    args.cont_on_error = false;
+    args.num_threads = 1;
 }
 
 AsmArgs get_cmd_args(int argc, char *argv[])
 {
     AsmArgs args;
-    const char* const short_opts = "vhi:o:";
+    const char* const short_opts = "vhki:o:j:c:";
     const option long_opts[] = {};
     int argn = 0;
 
@@ -80,6 +74,18 @@ AsmArgs get_cmd_args(int argc, char *argv[])
                 args.out_filename = std::string(optarg);
                 break;
 
+            case 'j':
+                args.num_threads = std::stoi(optarg);
+                break;
+
+            case 'k':
+                args.cont_on_error = true;
+                break;
+
+            case 'c':
+                args.cache_filename = std::string(optarg);
+                break;
+
             default:
                 std::cout << "Unknown option " << std::string(optarg)
                     << " (arg " << argn << ") - would print help here " << std::endl;
@@ -111,23 +117,66 @@ int main(int argc, char *argv[])
     }
 
     // Get a lexer
-    OpcodeTable op_table = test_build_op_table();       // TODO : this should eventually come from machine
-    Lexer lexer(op_table, args.in_filename);
+    Lexer lexer(lc3_op_table, args.in_filename);
     lexer.setVerbose(args.verbose);
-    SourceInfo src;
 
     // TODO : handle errors between parts 
     
     if(args.verbose)
-        std::cout << "Lexing source file " << args.in_filename << std::endl;
-
-    src = lexer.lex();
+        std::cout << "Lexing and assembling source file " << args.in_filename << std::endl;
+
+    // If the cache holds the lexer output for this very source 
+    // there is no need to lex it again
+    Assembler assem;
+    bool use_cache = (args.cache_filename != "");
+    bool cached    = false;
+    if(use_cache)
+    {
+        SourceInfo cache_src;
+        if(cache_src.read(args.cache_filename, nullptr, lexer.getSource()) == 0)
+        {
+            if(args.verbose)
+                std::cout << "Using lexed source from " << args.cache_filename << std::endl;
+            assem  = Assembler(std::move(cache_src));
+            cached = true;
+        }
+    }
 
-    Assembler assem(src);
+    // Lines are assembled as the lexer produces them, unless the
+    // source is being lexed on several threads, we want every error
+    // in the source reported before giving up, or the output is
+    // going to the cache
+    bool lex_first = (args.num_threads > 1 || args.cont_on_error || use_cache);
+    if(lex_first && !cached)
+    {
+        lexer.setContOnError(args.cont_on_error);
+        const SourceInfo& src = (args.num_threads > 1) ? 
+            lexer.lexParallel(args.num_threads) : lexer.lex();
+        if(args.cont_on_error && src.hasError())
+        {
+            logFlush();
+            std::cout << lexer.getErrors().size() << " error(s) in source file " 
+                << args.in_filename << std::endl;
+            return -1;
+        }
+        if(use_cache && !src.hasError())
+        {
+            if(args.verbose)
+                std::cout << "Writing lexed source to " << args.cache_filename << std::endl;
+            src.write(args.cache_filename, &lexer.getSymTable());
+        }
+        assem = Assembler(lexer.takeSrcInfo());
+    }
     assem.setVerbose(args.verbose);
+    if(lex_first && args.num_threads > 1)
+        assem.assembleParallel(args.num_threads);
+    else if(lex_first)
+        assem.assemble();
+    else
+        assem.assemble(lexer);
+    logFlush();
     if(args.verbose)
-        std::cout << "Assembling to output file " << args.out_filename << std::endl;
-    assem.assemble();
+        std::cout << "Writing output file " << args.out_filename << std::endl;
     assem.write(args.out_filename);
 
     return 0;
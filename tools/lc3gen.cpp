@@ -0,0 +1,135 @@
+/* LC3GEN
+ * Write a synthetic LC3 assembly source of any size
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include "corpus.hpp"
+
+typedef struct
+{
+    std::string  out_filename;
+    CorpusParams params;
+    bool         verbose;
+} GenArgs;
+
+void init_cmd_args(GenArgs& args)
+{
+    args.out_filename = "";
+    initCorpusParams(args.params);
+    args.verbose = false;
+}
+
+void print_help(void)
+{
+    std::cout << "lc3gen [options]" << std::endl;
+    std::cout << "  -n <lines>    lines in the source" << std::endl;
+    std::cout << "  -l <n>        label one line in n (0 for no labels)" << std::endl;
+    std::cout << "  -r <percent>  instructions that refer to a label" << std::endl;
+    std::cout << "  -f <percent>  references that are forward" << std::endl;
+    std::cout << "  -d <percent>  lines that are directives" << std::endl;
+    std::cout << "  -c <percent>  lines with a comment" << std::endl;
+    std::cout << "  -s <seed>     random seed" << std::endl;
+    std::cout << "  -o <file>     output file (default stdout)" << std::endl;
+    std::cout << "  -v            print what was generated" << std::endl;
+}
+
+GenArgs get_cmd_args(int argc, char *argv[])
+{
+    GenArgs args;
+    const char* const short_opts = "vhn:l:r:f:d:c:s:o:";
+    const option long_opts[] = {};
+
+    init_cmd_args(args);
+
+    while(1)
+    {
+        const auto opt = getopt_long(argc, argv, short_opts, long_opts, nullptr);
+        if(opt == -1)
+            break;
+        switch(opt)
+        {
+            case 'v':
+                args.verbose = true;
+                break;
+
+            case 'h':
+                print_help();
+                exit(0);
+
+            case 'n':
+                args.params.num_lines = std::stoul(optarg);
+                break;
+
+            case 'l':
+                args.params.label_every = std::stoul(optarg);
+                break;
+
+            case 'r':
+                args.params.ref_percent = std::stoul(optarg);
+                break;
+
+            case 'f':
+                args.params.fwd_percent = std::stoul(optarg);
+                break;
+
+            case 'd':
+                args.params.dir_percent = std::stoul(optarg);
+                break;
+
+            case 'c':
+                args.params.comment_percent = std::stoul(optarg);
+                break;
+
+            case 's':
+                args.params.seed = std::stoul(optarg);
+                break;
+
+            case 'o':
+                args.out_filename = std::string(optarg);
+                break;
+
+            default:
+                print_help();
+                exit(-1);
+        }
+    }
+
+    return args;
+}
+
+int main(int argc, char *argv[])
+{
+    GenArgs args = get_cmd_args(argc, argv);
+    CorpusStats stats;
+    std::string text = genCorpus(args.params, &stats);
+
+    if(args.out_filename == "")
+        std::cout << text;
+    else
+    {
+        std::ofstream file(args.out_filename, std::ios::binary);
+        file.write(text.data(), text.size());
+        if(!file.good())
+        {
+            std::cerr << "Error: failed to write " << args.out_filename << std::endl;
+            return -1;
+        }
+    }
+
+    if(args.verbose)
+    {
+        std::cerr << stats.num_lines << " lines (" << text.size() << " bytes) in "
+            << stats.num_segments << " segment(s)" << std::endl;
+        std::cerr << stats.num_instrs << " instructions, " << stats.num_directives
+            << " directives, " << stats.num_labels << " labels" << std::endl;
+        std::cerr << stats.num_refs << " references (" << stats.num_fwd_refs
+            << " forward)" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* LC3RUN
+ * Assemble an LC3 source file and run it on the emulator
+ *
+ * Stefan Wong 2018
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <getopt.h>
+#include "lc3.hpp"
+#include "source.hpp"
+#include "lexer.hpp"
+#include "assembler.hpp"
+#include "log.hpp"
+
+#define LC3RUN_DEFAULT_CYCLES 4096
+
+typedef struct
+{
+    std::string  in_filename;
+    unsigned int max_cycles;
+    bool         perf;
+    bool         stats;
+    bool         verbose;
+} RunArgs;
+
+void init_cmd_args(RunArgs& args)
+{
+    args.in_filename = "\0";
+    args.max_cycles  = LC3RUN_DEFAULT_CYCLES;
+    args.perf        = false;
+    args.stats       = false;
+    args.verbose     = false;
+}
+
+void print_usage(void)
+{
+    std::cout << "lc3run -i <source.asm> [-c max_cycles] [-s] [-p] [-v]" << std::endl;
+    std::cout << "    -c  maximum number of instructions to run" << std::endl;
+    std::cout << "    -s  print run statistics" << std::endl;
+    std::cout << "    -p  measure host hardware counters (implies -s)" << std::endl;
+    std::cout << "    -v  verbose output" << std::endl;
+}
+
+RunArgs get_cmd_args(int argc, char *argv[])
+{
+    RunArgs args;
+    const char* const short_opts = "vhspi:c:";
+    const option long_opts[] = {};
+
+    init_cmd_args(args);
+
+    while(1)
+    {
+        const auto opt = getopt_long(argc, argv, short_opts, long_opts, nullptr);
+        if(opt == -1)
+            break;
+        switch(opt)
+        {
+            case 'v':
+                args.verbose = true;
+                break;
+
+            case 'h':
+                print_usage();
+                exit(0);
+
+            case 's':
+                args.stats = true;
+                break;
+
+            case 'p':
+                args.perf  = true;
+                args.stats = true;
+                break;
+
+            case 'i':
+                args.in_filename = std::string(optarg);
+                break;
+
+            case 'c':
+                args.max_cycles = std::atoi(optarg);
+                break;
+
+            default:
+                print_usage();
+                exit(-1);
+        }
+    }
+
+    return args;
+}
+
+int main(int argc, char *argv[])
+{
+    RunArgs args;
+    LC3 machine;
+
+    args = get_cmd_args(argc, argv);
+    if(args.in_filename == "\0")
+    {
+        std::cout << "Error: no input filename specified" << std::endl;
+        return -1;
+    }
+
+    // Assemble the program straight into the machine
+    Lexer lexer(machine.getOpTable(), args.in_filename);
+    lexer.setVerbose(args.verbose);
+    Assembler assem;
+    AsmImage image;
+    assem.setVerbose(args.verbose);
+    int status = assem.assemble(lexer, machine, image);
+    logFlush();
+    if(status < 0)
+    {
+        std::cout << "Error assembling source file " << args.in_filename << std::endl;
+        return -1;
+    }
+
+    // Run the program
+    machine.setVerbose(args.verbose);
+    machine.enable(image.entry);
+    if(args.perf && !machine.setPerf(true))
+        std::cout << "Warning: host hardware counters unavailable" << std::endl;
+
+    int stop = machine.run(args.max_cycles);
+    logFlush();
+    if(stop == LC3_STOP_HALT)
+        std::cout << "Machine halted" << std::endl;
+    else
+        std::cout << "Machine ran for " << std::dec << args.max_cycles << " cycles" << std::endl;
+
+    std::cout << machine.getProcState().toString();
+    if(args.stats)
+        std::cout << machine.getStats().toString();
+
+    return 0;
+}